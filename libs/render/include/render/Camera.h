@@ -1,12 +1,13 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
 
 namespace render {
 
-#if 0 // Placeholder - to be implemented later
-    /// Camera system for view and projection calculations
-    /// Handles camera positioning, orientation, and projection parameters
+    /// Perspective camera with an optional thin lens, owned by the Scene
+    /// Every change takes a new version from a process-wide counter so backends can cache per-camera data,
+    /// two cameras only share a version when one is a copy of the other in the same state
     class Camera {
     public:
         Camera();
@@ -15,27 +16,52 @@ namespace render {
         void setPosition(const glm::vec3& position);
         void setTarget(const glm::vec3& target);
         void setUp(const glm::vec3& up);
+        void lookAt(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up = glm::vec3(0.0f, 1.0f, 0.0f));
 
         // Projection parameters
-        void setPerspective(float fov, float aspect, float near, float far);
-        void setOrthographic(float left, float right, float bottom, float top, float near, float far);
+        void setFieldOfView(float degrees);     // Vertical
+        void setAperture(float radius);         // Lens radius in world units, 0 = pinhole
+        void setFocusDistance(float distance);  // Distance of the sharp plane along the view axis
 
-        // Matrix calculations
-        glm::mat4 getViewMatrix() const;
-        glm::mat4 getProjectionMatrix() const;
+        // Getters
+        const glm::vec3& getPosition() const { return m_position; }
+        const glm::vec3& getTarget() const { return m_target; }
+        const glm::vec3& getUp() const { return m_up; }
+        float getFieldOfView() const { return m_fov; }
+        float getAperture() const { return m_aperture; }
+        float getFocusDistance() const { return m_focusDistance; }
+        bool isThinLens() const { return m_aperture > 0.0f; }
 
-        // Ray generation for ray tracing
-        void generateRay(float x, float y, float width, float height, glm::vec3& origin, glm::vec3& direction) const;
+        // Orthonormal camera frame: x right, y up, z along the view direction
+        const glm::vec3& getRight() const { return m_right; }
+        const glm::vec3& getUpAxis() const { return m_upAxis; }
+        const glm::vec3& getForward() const { return m_forward; }
+
+        /// Normalized pinhole direction through a point on the image plane
+        /// ndc is in [-1, 1], +y up, x is scaled by the aspect ratio
+        glm::vec3 getRayDirection(const glm::vec2& ndc, float aspect) const;
+
+        // Change tracking
+        uint64_t getVersion() const { return m_version; }
+
+    private:
+        void updateFrame();
 
     private:
-        glm::vec3 m_position{0.0f, 0.0f, 5.0f};
-        glm::vec3 m_target{0.0f};
+        glm::vec3 m_position{0.0f, 0.0f, 0.0f};
+        glm::vec3 m_target{0.0f, 0.0f, 1.0f};
         glm::vec3 m_up{0.0f, 1.0f, 0.0f};
-        float m_fov = 45.0f;
-        float m_aspect = 1.0f;
-        float m_near = 0.1f;
-        float m_far = 100.0f;
+        float m_fov = 90.0f;
+        float m_aperture = 0.0f;
+        float m_focusDistance = 1.0f;
+
+        // Derived
+        glm::vec3 m_right{1.0f, 0.0f, 0.0f};
+        glm::vec3 m_upAxis{0.0f, 1.0f, 0.0f};
+        glm::vec3 m_forward{0.0f, 0.0f, 1.0f};
+        float m_tanHalfFov = 1.0f;
+
+        uint64_t m_version = 0;
     };
-#endif
 
-}
\ No newline at end of file
+}
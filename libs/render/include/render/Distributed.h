@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Camera.h"
+#include "PathTracer.h"
+#include "Types.h"
+
+namespace render
+{
+
+	class Scene;
+
+	/// What every worker renders, the scene itself is built by each worker process
+	struct DistributedJob
+	{
+		uint32_t width = 512;
+		uint32_t height = 512;
+		SamplerType sampler_type = SamplerType::Sobol;
+		uint32_t max_bounces = 8;
+		uint32_t russian_roulette_depth = 3;
+		uint32_t passes_per_update = 4; // Sample passes a worker renders between two updates
+		uint32_t target_samples = 0;	// Total samples per pixel over all workers, 0 = until stop()
+		bool split_by_region = false;	// Worker i renders band i of the frame's rows instead of sample stream i
+		uint32_t connect_timeout_ms = 60000; // start() fails when not every worker connected in time, 0 = wait forever
+		Camera camera;
+	};
+
+	struct DistributedWorkerStats
+	{
+		uint32_t stream_index = 0;		// Band index when the job is split by region
+		uint32_t sample_count = 0;		// Samples per pixel in the worker's latest update
+		double render_seconds = 0.0;	// Time the worker spent rendering them
+		double samples_per_second = 0.0; // Pixel samples per second
+		bool connected = false;
+	};
+
+	/// Accepts render workers, hands each a disjoint sample stream (or band of rows) of the same job and merges their float sums
+	/// Workers are separate processes (see run_render_worker) connected over "tcp://host:port" or "unix:///path"
+	class RenderCoordinator
+	{
+	public:
+		virtual ~RenderCoordinator() = default;
+
+		/// Starts listening on address, throws std::runtime_error when it cannot be bound
+		static std::unique_ptr<RenderCoordinator> create(const std::string &address);
+
+		/// Blocks until worker_count workers connected, then sends worker i stream i (or band i) of worker_count
+		/// Throws std::runtime_error when they did not connect within the job's timeout, workers that did are stopped
+		virtual void start(const DistributedJob &job, uint32_t worker_count) = 0;
+
+		/// Blocks until the target sample count is reached or stop() was called and every worker finished
+		virtual void wait() = 0;
+
+		/// Workers stop after their current batch of passes
+		virtual void stop() = 0;
+
+		// Samples per pixel merged so far, the least any band has when the job is split by region
+		virtual uint32_t get_sample_count() const = 0;
+		virtual std::vector<DistributedWorkerStats> get_worker_stats() const = 0;
+
+		/// Sum of the latest accumulation of every worker
+		virtual void get_accumulation(PathTracer::AccumulationSnapshot &snapshot) const = 0;
+
+		/// Merged accumulation resolved to RGBA8
+		virtual const PathTracer::RenderResult &get_render_result() = 0;
+	};
+
+	/// Connects to a coordinator and renders the jobs it sends on the given scene until told to stop
+	/// Returns false when the connection failed or broke before the coordinator ended the job.
+	/// Workers sharing a machine should split its cores through threading.thread_count
+	bool run_render_worker(const std::string &address, std::shared_ptr<Scene> scene, const ThreadingConfig &threading = {});
+
+} // namespace render
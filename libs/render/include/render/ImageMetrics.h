@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PathTracer.h"
+
+namespace render
+{
+
+	/// Error of a rendered image against a converged reference, over the RGB channels
+	struct ImageError
+	{
+		double rmse = 0.0;
+		double relative_mse = 0.0; // Squared error over reference^2 + epsilon, bright pixels do not dominate
+	};
+
+	/// Compares two interleaved float images with at least 3 channels per pixel, extra channels are ignored
+	ImageError compare_images(const float *image, uint32_t image_channels, const float *reference, uint32_t reference_channels,
+							  size_t pixel_count);
+
+	/// Per-pixel averages of an accumulation as interleaved RGB
+	void average_accumulation(const PathTracer::AccumulationSnapshot &snapshot, std::vector<float> &rgb);
+
+} // namespace render
@@ -1,9 +1,17 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <string>
 #include <string_view>
 #include <format>
 
+// Lowest level compiled in, calls below it vanish including their formatting.
+// Release builds of the render library define it to 2 (Info), see CMakeLists.txt
+#ifndef RENDER_LOG_MIN_LEVEL
+#define RENDER_LOG_MIN_LEVEL 0
+#endif
+
 namespace render {
 
 enum class LogLevel {
@@ -14,46 +22,60 @@ enum class LogLevel {
     Error = 4
 };
 
+inline constexpr LogLevel COMPILED_LOG_LEVEL = static_cast<LogLevel>(RENDER_LOG_MIN_LEVEL);
+
+// Called on the logging thread, never on the thread that logged the message
 using LogCallback = std::function<void(LogLevel level, std::string_view message)>;
 
+// Messages are formatted on the calling thread and queued in a lock-free ring buffer,
+// a background thread hands them to the callback. Logging never waits for console I/O,
+// when the buffer is full messages are dropped and counted instead.
 class Log {
 public:
     // Set user callback for log messages
     static void set_callback(LogCallback callback);
-    
+
     // Set minimum log level (messages below this are ignored)
     static void set_level(LogLevel min_level);
-    
+
+    // Blocks until every message queued so far was handed to the callback
+    static void flush();
+
+    // Messages lost to a full ring buffer since startup
+    static uint64_t get_dropped_count();
+
     // Core logging function
     template<typename... Args>
     static void log(LogLevel level, std::format_string<Args...> fmt, Args&&... args) {
-        if (should_log(level)) {
-            auto message = std::format(fmt, std::forward<Args>(args)...);
-            send_to_callback(level, message);
+        if (level >= COMPILED_LOG_LEVEL && should_log(level)) {
+            enqueue(level, std::format(fmt, std::forward<Args>(args)...));
         }
     }
-    
+
     // Convenience methods
     template<typename... Args>
     static void trace(std::format_string<Args...> fmt, Args&&... args) {
-        log(LogLevel::Trace, fmt, std::forward<Args>(args)...);
+        if constexpr (LogLevel::Trace >= COMPILED_LOG_LEVEL)
+            log(LogLevel::Trace, fmt, std::forward<Args>(args)...);
     }
-    
+
     template<typename... Args>
     static void debug(std::format_string<Args...> fmt, Args&&... args) {
-        log(LogLevel::Debug, fmt, std::forward<Args>(args)...);
+        if constexpr (LogLevel::Debug >= COMPILED_LOG_LEVEL)
+            log(LogLevel::Debug, fmt, std::forward<Args>(args)...);
     }
-    
+
     template<typename... Args>
     static void info(std::format_string<Args...> fmt, Args&&... args) {
-        log(LogLevel::Info, fmt, std::forward<Args>(args)...);
+        if constexpr (LogLevel::Info >= COMPILED_LOG_LEVEL)
+            log(LogLevel::Info, fmt, std::forward<Args>(args)...);
     }
-    
+
     template<typename... Args>
     static void warn(std::format_string<Args...> fmt, Args&&... args) {
         log(LogLevel::Warn, fmt, std::forward<Args>(args)...);
     }
-    
+
     template<typename... Args>
     static void error(std::format_string<Args...> fmt, Args&&... args) {
         log(LogLevel::Error, fmt, std::forward<Args>(args)...);
@@ -61,7 +83,7 @@ public:
 
 private:
     static bool should_log(LogLevel level);
-    static void send_to_callback(LogLevel level, std::string_view message);
+    static void enqueue(LogLevel level, std::string message);
 };
 
-} // namespace render
\ No newline at end of file
+} // namespace render
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace render
+{
+
+	/// One batched math kernel against the scalar loop it replaces
+	struct MathKernelTiming
+	{
+		const char *name = "";
+		double scalar_ns = 0.0; // Per element, best of the repeats
+		double batch_ns = 0.0;
+		double max_difference = 0.0; // Largest absolute difference between the scalar and batched results
+	};
+
+	/// Times every kernel of the SIMD math module over count elements against its scalar version.
+	/// Inputs are generated with a fixed seed, each timing is the fastest of repeats runs
+	std::vector<MathKernelTiming> benchmark_math_kernels(size_t count, uint32_t repeats);
+
+} // namespace render
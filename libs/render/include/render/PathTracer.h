@@ -4,9 +4,12 @@
 #include <string>
 #include <vector>
 
+#include "Types.h"
+
 namespace render
 {
 
+	class Camera;
 	class Scene;
 	class RenderSettings;
 
@@ -22,11 +25,56 @@ namespace render
 
 		struct RenderResult
 		{
-			std::vector<uint32_t> image_buffer;
+			OutputFormat format = OutputFormat::RGBA8;
+			std::vector<uint32_t> image_buffer; // RGBA8, filled when format is RGBA8
+			std::vector<uint16_t> hdr_buffer;	// Half-float RGBA, filled when format is RGBA16F
 			uint32_t width = 0;
 			uint32_t height = 0;
 		};
 
+		/// Averaged AOV as channel-major float planes (width * height per channel)
+		struct AOVBuffer
+		{
+			AOVType type = AOVType::Albedo;
+			uint32_t channels = 0;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			std::vector<float> planes;
+		};
+
+		/// Raw per-pixel sums, tracers rendering disjoint sample streams merge by adding them
+		struct AccumulationSnapshot
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t channels = 0;	   // See AccumulationLayout
+			uint32_t sample_count = 0; // Samples per pixel in the sums
+			std::vector<float> color;  // Interleaved, channels per pixel
+			std::vector<float> sample_counts; // Per pixel when a render region made them differ, empty = sample_count everywhere
+		};
+
+		/// Backend work of the last scene synchronization
+		struct SceneUpdateStats
+		{
+			double build_seconds = 0.0;
+			bool refit = false;		 // Acceleration structure refit instead of a full rebuild
+			bool failed = false;	 // Build ran out of memory, the previous acceleration structure is still used unless scene_dropped
+			bool pending_changes = false; // Scene edits of a failed build are not traced yet, the next update retries them
+			bool scene_dropped = false;	  // A failed refit left no usable structure, an empty scene renders until a rebuild succeeds
+			bool background = false; // Built while frames kept rendering the previous acceleration structure
+			BuildProfile profile = BuildProfile::Auto; // Resolved profile of the acceleration structure
+			size_t memory_bytes = 0; // Acceleration structure memory in use after the update
+			double wait_seconds = 0.0; // Time rendering waited for an asynchronous update, the rest of build_seconds overlapped other work
+		};
+
+		/// Memory allocated by the acceleration structure library (BVHs, geometry buffers, build scratch)
+		struct MemoryStats
+		{
+			size_t current_bytes = 0;
+			size_t peak_bytes = 0;
+			size_t budget_bytes = 0; // 0 = unlimited
+		};
+
 	public:
 		PathTracer() = default;
 		virtual ~PathTracer() = default;
@@ -36,9 +84,16 @@ namespace render
 
 		virtual void set_scene(std::shared_ptr<Scene> scene) = 0;
 		virtual void set_settings(std::shared_ptr<RenderSettings> settings) = 0;
+		// Camera of this view, nullptr renders through the scene camera
+		virtual void set_camera(std::shared_ptr<Camera> camera) = 0;
 
 		virtual std::shared_ptr<Scene> get_scene() const = 0;
 		virtual std::shared_ptr<RenderSettings> get_settings() const = 0;
+		virtual std::shared_ptr<Camera> get_camera() const = 0;
+
+		// New tracer on the same scene, acceleration structure and threads, starting with a copy of this view's settings
+		// and camera. Views keep their own accumulation and may render concurrently; scene edits reach all of them.
+		virtual std::unique_ptr<PathTracer> create_view() const = 0;
 
 		// Backend identification
 		virtual BackendType get_backend_type() const = 0;
@@ -47,7 +102,38 @@ namespace render
 
 		virtual const RenderResult &get_render_result() = 0;
 
-		static std::unique_ptr<PathTracer> create_path_tracer(BackendType backend);
+		// Returns nullptr unless the AOV is enabled in the render settings
+		virtual const AOVBuffer *get_aov(AOVType type) = 0;
+
+		// Copy of the beauty accumulation as of the last rendered frame
+		virtual void get_accumulation(AccumulationSnapshot &snapshot) const = 0;
+
+		// Saves the progressive state in the background, rendering continues meanwhile
+		virtual void save_checkpoint(const std::string &path) = 0;
+		// Continues from a checkpoint of the same scene and settings, false when it does not match
+		virtual bool resume_from_checkpoint(const std::string &path) = 0;
+
+		// Queues the current image for writing on a background thread, only the snapshot copy blocks
+		virtual void write_image(const std::string &path, const ImageOutputOptions &options = {}) = 0;
+		// Blocks until every queued image is written
+		virtual void wait_for_image_writes() = 0;
+
+		// Starts applying pending scene changes on a background thread, the next render() waits for it.
+		// The scene must not be edited until that render() call.
+		virtual void update_scene_async() = 0;
+		virtual SceneUpdateStats get_last_scene_update() const = 0;
+
+		virtual MemoryStats get_memory_stats() const = 0;
+		// Builds that would exceed the budget fail and keep the previous acceleration structure, 0 = unlimited.
+		// A rebuild holds the old and the new structure at once, so the budget has to cover both.
+		// A refit updates the structure in place, when it fails there is nothing to keep: the rebuild that follows
+		// starts from an empty scene, and if it fails too an empty scene renders until a later update succeeds.
+		virtual void set_memory_budget(size_t bytes) = 0;
+
+		// Threads the tracer was created with, shared by rendering and acceleration structure builds
+		virtual const ThreadingConfig &get_threading_config() const = 0;
+
+		static std::unique_ptr<PathTracer> create_path_tracer(BackendType backend, const ThreadingConfig &threading = {});
 	};
 
 	
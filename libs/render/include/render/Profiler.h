@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace render {
+
+// One timed scope, names are string literals and compared by pointer
+struct ProfileEvent {
+    const char* name = nullptr;
+    uint64_t start_ns = 0; // Since Profiler::now_ns() started counting
+    uint64_t end_ns = 0;
+    uint32_t thread = 0;   // Index into ProfileFrame::thread_names
+};
+
+// Events of one frame, between two Profiler::begin_frame() calls
+struct ProfileFrame {
+    uint64_t start_ns = 0;
+    uint64_t end_ns = 0;
+    std::vector<ProfileEvent> events; // Sorted by thread, then start
+    std::vector<std::string> thread_names;
+};
+
+// Scoped timers of the render library and the app, off until enabled.
+// Every thread records into its own buffer, a disabled profiler costs one relaxed load per scope.
+// The last frames are kept for the live view and can be written as Chrome trace_event JSON
+// (chrome://tracing, Perfetto).
+class Profiler {
+public:
+    static void set_enabled(bool enabled);
+    static bool is_enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // Marks the start of the next frame, events older than the retained frames are dropped
+    static void begin_frame();
+
+    // Shown as the thread's track name, call from the thread itself
+    static void set_thread_name(std::string name);
+
+    static uint64_t now_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_origin).count());
+    }
+
+    static void record(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+    // Last completed frame, false before two begin_frame() calls
+    static bool get_last_frame(ProfileFrame& frame);
+
+    // Writes every retained event, false when the file cannot be written
+    static bool write_chrome_trace(const std::string& path);
+
+private:
+    static std::atomic<bool> s_enabled;
+    static const std::chrono::steady_clock::time_point s_origin;
+};
+
+// Times its own lifetime while the profiler is enabled
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : m_name(Profiler::is_enabled() ? name : nullptr), m_start(m_name ? Profiler::now_ns() : 0) {}
+
+    ~ProfileScope() {
+        if (m_name)
+            Profiler::record(m_name, m_start, Profiler::now_ns());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start;
+};
+
+} // namespace render
+
+// Define RENDER_DISABLE_PROFILER to compile every scope away
+#ifndef RENDER_DISABLE_PROFILER
+#define RENDER_PROFILE_CONCAT_INNER(a, b) a##b
+#define RENDER_PROFILE_CONCAT(a, b) RENDER_PROFILE_CONCAT_INNER(a, b)
+#define RENDER_PROFILE_SCOPE(name) ::render::ProfileScope RENDER_PROFILE_CONCAT(render_profile_scope_, __LINE__)(name)
+#else
+#define RENDER_PROFILE_SCOPE(name) ((void)0)
+#endif
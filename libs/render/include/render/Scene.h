@@ -1,14 +1,17 @@
 #pragma once
 
 #include "Types.h"
+#include "Camera.h"
+#include "Log.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <vector>
 #include <memory>
 #include <cstring>
+#include <deque>
 #include <string>
 #include <unordered_map>
-#include <iostream>
+#include <unordered_set>
 
 namespace render
 {
@@ -46,31 +49,149 @@ namespace render
 			return transform;
 		}
 
+		/// Parent * child: other is expressed in this transform's space
+		/// Exact unless a non-uniform parent scale meets a rotated child, matrices handle that case
 		Transform operator*(const Transform& other) const
 		{
 			Transform result;
-			result.position = position + other.position;
+			result.position = position + rotation * (scale * other.position);
 			result.rotation = rotation * other.rotation;
 			result.scale = scale * other.scale;
 			return result;
 		}
 	};
 
+	/// Bits summarizing journal events, backends pick the cheapest update that covers them
+	namespace SceneChange
+	{
+		constexpr uint32_t TRANSFORM = 1u << 0; // Node transforms or sizes, same node set: BVH refit
+		constexpr uint32_t TOPOLOGY = 1u << 1;	// Nodes added or removed: full rebuild
+		constexpr uint32_t MATERIAL = 1u << 2;	// Shading only, the acceleration structure is unaffected
+	}
+
+	enum class SceneEventType : uint8_t {
+		NodeAdded,
+		NodeRemoved,
+		TransformChanged,
+		RadiusChanged,
+		MaterialChanged
+	};
+
+	struct SceneEvent {
+		SceneEventType type;
+		NodeID node;
+
+		bool operator==(const SceneEvent& other) const = default;
+	};
+
+	/// Ordered log of scene edits, consumers remember the version they synced to and read the events after it.
+	/// Edits inside a transaction are published together when the outermost transaction commits, so a
+	/// consumer never sees half of a batched edit. Not thread-safe, edit and sync from the same thread.
+	class SceneJournal
+	{
+	public:
+		// Oldest events are dropped past this, consumers that fell further behind resync from scratch
+		static constexpr size_t MAX_EVENTS = 1u << 16;
+
+		/// Version after the last published event, consumers store it after syncing
+		uint64_t getVersion() const { return m_firstVersion + m_events.size(); }
+
+		/// Appends the published events after version, false when some of them were already dropped
+		bool getEventsSince(uint64_t version, std::vector<SceneEvent>& events) const;
+
+		/// SceneChange bits covering the events
+		static uint32_t summarize(const std::vector<SceneEvent>& events);
+
+		void record(SceneEventType type, NodeID node);
+
+		void beginTransaction() { m_transactionDepth++; }
+		void commitTransaction();
+		bool inTransaction() const { return m_transactionDepth > 0; }
+
+	private:
+		void publish(const SceneEvent& event);
+
+	private:
+		std::deque<SceneEvent> m_events;
+		uint64_t m_firstVersion = 0;		  // Version of m_events.front()
+		std::vector<SceneEvent> m_pending;	  // Recorded in the open transaction, in order, without duplicates
+		std::unordered_set<uint64_t> m_pendingKeys;
+		uint32_t m_transactionDepth = 0;
+	};
+
+	/// Groups edits into one journal batch for its lifetime, transactions nest
+	class SceneTransaction
+	{
+	public:
+		explicit SceneTransaction(SceneJournal& journal) : m_journal(&journal) { m_journal->beginTransaction(); }
+		~SceneTransaction() { m_journal->commitTransaction(); }
+
+		SceneTransaction(const SceneTransaction&) = delete;
+		SceneTransaction& operator=(const SceneTransaction&) = delete;
+
+	private:
+		SceneJournal* m_journal;
+	};
+
+	class SceneNode;
+
+	/// World matrices of all nodes in one flat array, in depth-first preorder: parents come before their
+	/// children and every subtree is a contiguous range. Edits only mark their subtree, update() recomputes
+	/// the marked ranges in one forward pass instead of walking node pointers.
+	class TransformHierarchy
+	{
+	public:
+		static constexpr uint32_t INVALID_INDEX = ~0u;
+
+		/// Parents or the node set changed, the order is rebuilt on the next update
+		void markStructureDirty() { m_structureDirty = true; }
+		void markDirty(uint32_t index)
+		{
+			if (index != INVALID_INDEX)
+				m_dirty.push_back(index);
+		}
+		bool isDirty() const { return m_structureDirty || !m_dirty.empty(); }
+
+		void update(SceneNode& root);
+
+		const glm::mat4& getWorldMatrix(uint32_t index) const { return m_worlds[index]; }
+		size_t size() const { return m_nodes.size(); }
+
+	private:
+		void rebuild(SceneNode& root);
+		void compose(uint32_t begin, uint32_t end);
+
+	private:
+		std::vector<SceneNode*> m_nodes;	 // Preorder, index 0 is the scene root
+		std::vector<uint32_t> m_parents;	 // Index of the parent, always smaller than the child's
+		std::vector<uint32_t> m_subtreeEnd; // One past the last descendant
+		std::vector<glm::mat4> m_locals;
+		std::vector<glm::mat4> m_worlds;
+		std::vector<uint32_t> m_dirty;		 // Nodes whose local transform changed since the last update
+		bool m_structureDirty = true;
+	};
+
 	class SceneNode {
+		friend class Scene;
+		friend class TransformHierarchy;
+
 	protected:
 		static NodeID s_nextID;
 		NodeID m_id;
 		std::string m_name;
 		NodeType m_type;
 		
-		// Hierarchy
-		// SceneNode* m_parent = nullptr;
-		// std::vector<std::unique_ptr<SceneNode>> m_children;
+		// Hierarchy, the scene owns the nodes
+		SceneNode* m_parent = nullptr;
+		std::vector<SceneNode*> m_children;
 		
-		// Transform
+		// Transform, the world matrix lives in the scene's TransformHierarchy
 		Transform m_localTransform;
-		mutable Transform m_worldTransform;
-		mutable bool m_worldTransformDirty = true;
+		TransformHierarchy* m_hierarchy = nullptr;
+		uint32_t m_hierarchyIndex = TransformHierarchy::INVALID_INDEX;
+
+		// Journal of the owning scene, edits before the node is added are covered by NodeAdded
+		SceneJournal* m_journal = nullptr;
 		
 		// Visibility
 		// bool m_visible = true;
@@ -79,7 +200,7 @@ namespace render
 		
 	public:
 		SceneNode(NodeType type, const std::string& name = "Node")
-			: m_id(s_nextID++), m_name(name), m_type(type), m_localTransform(), m_worldTransform(), m_worldTransformDirty(true)
+			: m_id(s_nextID++), m_name(name), m_type(type), m_localTransform()
 		{}
 		virtual ~SceneNode() = default;
 		
@@ -89,22 +210,23 @@ namespace render
 		void SetName(const std::string& name) { m_name = name; }
 		NodeType GetType() const { return m_type; }
 		
-		// Hierarchy
-		// void AddChild(std::unique_ptr<SceneNode> child);
-		// void RemoveChild(NodeID childID);
-		// SceneNode* FindChild(NodeID id);
-		// SceneNode* GetParent() const { return m_parent; }
-		// const std::vector<std::unique_ptr<SceneNode>>& GetChildren() const { return m_children; }
+		// Hierarchy, reparent through Scene::SetParent
+		SceneNode* GetParent() const { return m_parent; }
+		const std::vector<SceneNode*>& GetChildren() const { return m_children; }
 		
 		// Transform
-		// const Transform& GetLocalTransform() const { return m_localTransform; }
-		// const Transform& GetWorldTransform() const;
-		// void SetLocalTransform(const Transform& transform);
+		const Transform& GetLocalTransform() const { return m_localTransform; }
+		void SetLocalTransform(const Transform& transform)
+		{
+			m_localTransform = transform;
+			MarkWorldTransformDirty();
+			RecordChange(SceneEventType::TransformChanged);
+		}
 		void SetPosition(const glm::vec3& position)
 		{
 			m_localTransform.position = position;
-			// MarkWorldTransformDirty();
-			m_worldTransformDirty = true;
+			MarkWorldTransformDirty();
+			RecordChange(SceneEventType::TransformChanged);
 		}
 		// void SetRotation(const glm::vec3& rotation); // Euler angles
 		// void SetScale(const glm::vec3& scale);
@@ -116,20 +238,41 @@ namespace render
 		// glm::vec3 GetScale() const;
 
 	protected:
-		// void MarkWorldTransformDirty();
-		// void UpdateWorldTransform() const;
+		void MarkWorldTransformDirty()
+		{
+			if (m_hierarchy)
+				m_hierarchy->markDirty(m_hierarchyIndex);
+		}
+
+		void RecordChange(SceneEventType type)
+		{
+			if (m_journal)
+				m_journal->record(type, m_id);
+		}
 	};
 
 	class SphereObject : public SceneNode {
 	private:
 		float m_radius = 1.0f;
+		glm::vec3 m_albedo = glm::vec3(0.7f); // Diffuse reflectance
 		
 	public:
 		SphereObject(const std::string& name = "Sphere") 
 			: SceneNode(NodeType::SPHERE_OBJECT, name) {}
 		
 		float GetRadius() const { return m_radius; }
-		void SetRadius(float radius) { m_radius = radius; }
+		void SetRadius(float radius)
+		{
+			m_radius = radius;
+			RecordChange(SceneEventType::RadiusChanged);
+		}
+
+		const glm::vec3& GetAlbedo() const { return m_albedo; }
+		void SetAlbedo(const glm::vec3& albedo)
+		{
+			m_albedo = albedo;
+			RecordChange(SceneEventType::MaterialChanged);
+		}
 	};
 
 	class Scene
@@ -139,14 +282,22 @@ namespace render
 		std::unique_ptr<SceneNode> m_rootNode;
 		std::unordered_map<NodeID, SceneNode*> m_nodeRegistry;
 		std::vector<std::unique_ptr<SceneNode>> m_nodes; // Store actual node objects
-		
 
-		bool m_has_changes = true;
+		// Camera changes are tracked by Camera::getVersion, they never require a geometry rebuild
+		Camera m_camera;
+
+		// Node edits, see SceneJournal
+		SceneJournal m_journal;
+
+		// Cached world matrices, brought up to date on first access after an edit
+		mutable TransformHierarchy m_hierarchy;
 		
 	public:
 		Scene()
 		: m_rootNode(std::make_unique<SceneNode>(NodeType::SCENE_ROOT, "Root"))
-		{}
+		{
+			m_rootNode->m_hierarchy = &m_hierarchy;
+		}
 		~Scene()
 		{
 			// Cleanup all nodes - unique_ptrs will handle deletion automatically
@@ -154,6 +305,10 @@ namespace render
 			m_nodes.clear();
 		}
 		
+		// Camera
+		Camera& GetCamera() { return m_camera; }
+		const Camera& GetCamera() const { return m_camera; }
+
 		// Node Management
 		SceneNode* GetRootNode() const { return m_rootNode.get(); }
 
@@ -167,8 +322,9 @@ namespace render
 			T* nodePtr = node.get();
 			RegisterNode(nodePtr);
 			m_nodes.push_back(std::move(node)); // Store the actual node object
-			// For simplicity, we are not handling hierarchy here
-			std::cout << "Created node ID: " << nodePtr->GetID() << ", Name: " << nodePtr->GetName() << std::endl;
+			Attach(nodePtr, m_rootNode.get());
+			m_journal.record(SceneEventType::NodeAdded, nodePtr->GetID());
+			render::Log::trace("Created node ID: {}, Name: {}", nodePtr->GetID(), nodePtr->GetName());
 			return nodePtr;
 		}
 		
@@ -179,6 +335,16 @@ namespace render
 			{
 				SceneNode* node = it->second;
 				UnregisterNode(id);
+				m_journal.record(SceneEventType::NodeRemoved, id);
+
+				// Children move up to the root and keep their local transforms
+				Detach(node);
+				for (SceneNode* child : std::vector<SceneNode*>(node->m_children))
+				{
+					Detach(child);
+					Attach(child, m_rootNode.get());
+					m_journal.record(SceneEventType::TransformChanged, child->GetID());
+				}
 				// Remove from storage vector
 				auto nodeIt = std::find_if(m_nodes.begin(), m_nodes.end(), 
 					[node](const std::unique_ptr<SceneNode>& ptr) { return ptr.get() == node; });
@@ -204,26 +370,58 @@ namespace render
 			return nullptr;
 		}
 
-		bool hasChanges() const
+		bool SetNodeTransform(NodeID id, const Transform& transform)
 		{
-			return m_has_changes;
+			SceneNode* node = FindNode(id);
+			if (!node)
+				return false;
+			node->SetLocalTransform(transform);
+			return true;
 		}
 
-		void markChangesProcessed()
+		// Hierarchy, parentID 0 attaches to the root. Fails for unknown nodes and cycles, the local transform is kept
+		bool SetParent(NodeID childID, NodeID parentID);
+
+		// World matrices of the whole scene, edited subtrees are recomputed in one batched pass
+		void UpdateWorldTransforms() const { m_hierarchy.update(*m_rootNode); }
+		const glm::mat4& GetWorldMatrix(const SceneNode& node) const
 		{
-			m_has_changes = false;
+			UpdateWorldTransforms();
+			return m_hierarchy.getWorldMatrix(node.m_hierarchyIndex);
 		}
 
+		// Change tracking, node setters record their own events
+		SceneJournal& getJournal() { return m_journal; }
+		const SceneJournal& getJournal() const { return m_journal; }
+
+		// Edits until the returned transaction goes out of scope reach backends as one batch
+		[[nodiscard]] SceneTransaction beginTransaction() { return SceneTransaction(m_journal); }
+
 	
 	private:
 		void RegisterNode(SceneNode* node)
 		{
 			m_nodeRegistry[node->GetID()] = node;
+			node->m_journal = &m_journal;
+			node->m_hierarchy = &m_hierarchy;
 		}
 		void UnregisterNode(NodeID id)
 		{
 			m_nodeRegistry.erase(id);
 		}
+		void Attach(SceneNode* node, SceneNode* parent)
+		{
+			node->m_parent = parent;
+			parent->m_children.push_back(node);
+			m_hierarchy.markStructureDirty();
+		}
+		void Detach(SceneNode* node)
+		{
+			if (node->m_parent)
+				std::erase(node->m_parent->m_children, node);
+			node->m_parent = nullptr;
+			m_hierarchy.markStructureDirty();
+		}
 	};
 
 #elif
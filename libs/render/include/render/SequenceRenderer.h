@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "PathTracer.h"
+#include "Scene.h"
+#include "Types.h"
+
+namespace render
+{
+
+	struct NodeTransform
+	{
+		NodeID node = 0;
+		Transform transform;
+	};
+
+	/// Node transforms of one animation frame, nodes not listed keep their previous transform
+	struct SequenceFrame
+	{
+		std::vector<NodeTransform> transforms;
+	};
+
+	struct SequenceOptions
+	{
+		uint32_t samples_per_frame = 64;
+		std::string output_pattern; // e.g. "shot_####.exr", the run of '#' becomes the zero-padded frame, empty = no output
+		ImageOutputOptions image_options;
+	};
+
+	struct SequenceFrameStats
+	{
+		uint32_t frame = 0;
+		double build_seconds = 0.0;	 // BVH update, overlapped with the previous frame's output
+		double build_wait_seconds = 0.0; // Part of build_seconds the render loop waited for, the rest overlapped
+		bool refit = false;			 // Refit instead of a full rebuild
+		double render_seconds = 0.0; // Sample passes, including any wait for the BVH update
+		double output_seconds = 0.0; // Time the render loop spent on resolve and image snapshot
+	};
+
+	/// Renders an animation through one path tracer, keeping its Embree scene alive across frames
+	/// While frame N is resolved and handed to the image writer, the BVH of frame N + 1 is already updating
+	class SequenceRenderer
+	{
+	public:
+		using FrameCallback = std::function<void(const SequenceFrameStats &stats, const PathTracer::RenderResult &result)>;
+
+		explicit SequenceRenderer(PathTracer &path_tracer) : m_path_tracer(path_tracer) {}
+
+		/// Called with the resolved image of every frame, on the calling thread
+		void set_frame_callback(FrameCallback callback) { m_frame_callback = std::move(callback); }
+
+		/// Blocks until every frame is rendered and written
+		void render(const std::vector<SequenceFrame> &frames, const SequenceOptions &options);
+
+		const std::vector<SequenceFrameStats> &get_frame_stats() const { return m_frame_stats; }
+
+		/// Output path of a frame for a pattern like "shot_####.exr"
+		static std::string format_frame_path(const std::string &pattern, uint32_t frame);
+
+	private:
+		void apply_frame(const SequenceFrame &frame);
+
+	private:
+		PathTracer &m_path_tracer;
+		FrameCallback m_frame_callback;
+		std::vector<SequenceFrameStats> m_frame_stats;
+	};
+
+} // namespace render
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include <string>
 
 namespace render {
 
@@ -39,6 +40,107 @@ namespace render {
         bool progressive = true;
     };
 
+    /// Sample generator used by the path tracer
+    enum class SamplerType {
+        Independent,    // Per-path PCG hash, purely random
+        Sobol,          // Owen-scrambled Sobol, decorrelated per pixel
+        BlueNoise       // Shared Sobol sequence dithered by a blue noise tile
+    };
+
+    /// How paths past the Russian roulette depth are terminated
+    enum class RouletteMode {
+        Throughput,     // Survive with the largest throughput component
+        Efficiency      // Roulette and splitting factors learned per region from cost and variance (EARS)
+    };
+
+    /// Per-pixel layout of the float32 radiance sums
+    enum class AccumulationLayout {
+        RGB32F,         // 12 bytes/pixel, alpha resolves to 1
+        RGBA32F         // 16 bytes/pixel
+    };
+
+    constexpr uint32_t accumulation_channel_count(AccumulationLayout layout) {
+        return layout == AccumulationLayout::RGBA32F ? 4u : 3u;
+    }
+
+    /// Trade-off between acceleration structure build time and trace speed
+    enum class BuildProfile {
+        Auto,           // Final for new geometry, Interactive while objects are being moved
+        Interactive,    // Low quality, dynamic scene, transform changes refit instead of rebuilding
+        Final,          // High quality SAH, compact nodes, every change rebuilds
+        Robust          // Medium quality, watertight traversal for grazing and far-from-origin rays
+    };
+
+    /// Which NUMA domain the pages of the accumulation buffer land on, decided by the first write
+    enum class MemoryPlacement {
+        FirstTouch,     // Each domain zeroes the tile band its threads render
+        Interleaved,    // Pages spread round-robin over the domains
+        SingleThread    // Zeroed by the render thread, everything lands on its domain
+    };
+
+    /// Pixel format of the resolved render result
+    enum class OutputFormat {
+        RGBA8,          // Clamped, packed 8-bit RGBA (RenderResult::image_buffer)
+        RGBA16F         // Unclamped half-float RGBA (RenderResult::hdr_buffer)
+    };
+
+    /// Arbitrary output variables written alongside the beauty pass
+    enum class AOVType : uint32_t {
+        Albedo = 0,     // First-hit albedo, RGB
+        Normal,         // First-hit shading normal, XYZ
+        Depth,          // First-hit distance along the primary ray, 0 on miss
+        NodeID,         // First-hit scene NodeID, 0 on miss (not averaged)
+        SampleCount,    // Samples accumulated per pixel
+        Count
+    };
+
+    constexpr uint32_t AOV_TYPE_COUNT = static_cast<uint32_t>(AOVType::Count);
+
+    constexpr uint32_t aov_bit(AOVType type) { return 1u << static_cast<uint32_t>(type); }
+
+    constexpr uint32_t aov_channel_count(AOVType type) {
+        return (type == AOVType::Albedo || type == AOVType::Normal) ? 3u : 1u;
+    }
+
+    /// Sample type of written EXR channels, other formats are always 8-bit sRGB
+    enum class ImagePixelType {
+        Half,
+        Float
+    };
+
+    /// Encoding of written images, the file format follows the extension (.exr, .png, ...)
+    struct ImageOutputOptions {
+        ImagePixelType pixel_type = ImagePixelType::Half;
+        std::string compression = "zip";   // EXR: none, rle, zip, zips, piz, pxr24, b44, dwaa, dwab
+        uint32_t tile_size = 0;            // EXR tile edge in pixels, 0 = scanlines
+        uint32_t aov_mask = 0;             // AOVs written as extra channel layers (EXR), must be enabled
+    };
+
+    /// How the threads of a path tracer are bound to CPUs
+    enum class ThreadAffinity {
+        None,           // Left to the OS scheduler
+        NumaDomain,     // Any CPU of the thread's NUMA domain, unpinned on single-domain machines
+        Core            // One logical CPU per thread
+    };
+
+    /// Threads shared by tile rendering and Embree BVH builds, fixed when the path tracer is created
+    struct ThreadingConfig {
+        uint32_t thread_count = 0;                              // 0 = every CPU the process may run on
+        ThreadAffinity affinity = ThreadAffinity::NumaDomain;
+        std::string isa;                                        // Embree ISA (sse4.2, avx2, avx512), empty = best supported
+    };
+
+    /// Crop window in pixels, only pixels inside it are traced
+    struct RenderRegion {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t width = 0;     // 0 = no region, the full frame is traced
+        uint32_t height = 0;
+
+        bool isEmpty() const { return width == 0 || height == 0; }
+        bool operator==(const RenderRegion& other) const = default;
+    };
+
     /// Render settings with automatic dirty flag management
     class RenderSettings {
     public:
@@ -52,10 +154,38 @@ namespace render {
         void setSamplesPerPixel(uint32_t samples);
         void setMaxBounces(uint32_t bounces);
         void setRussianRouletteDepth(uint32_t depth);
+        void setRouletteMode(RouletteMode mode);
+        // Learns where indirect light comes from while rendering and samples bounces towards it
+        void setPathGuiding(bool enabled);
+        void setSamplerType(SamplerType type);
+        void setAccumulationLayout(AccumulationLayout layout);
+        void setMemoryPlacement(MemoryPlacement placement);
+        // Rebuilds the acceleration structure, the image does not change so accumulation continues.
+        // Views of one scene share it, the most recent change of any view wins
+        void setBuildProfile(BuildProfile profile);
+        // Renders sample indices index, index + count, index + 2 * count, ... so several
+        // renderers can split one sequence into disjoint streams and merge their sums
+        void setSampleStream(uint32_t index, uint32_t count);
+        // Traces only the region, pixels outside keep their samples so accumulation continues
+        void setRenderRegion(const RenderRegion& region);
+        void clearRenderRegion() { setRenderRegion({}); }
         
         // Exposure and tone mapping
         void setExposure(float exposure);
         void setAutoExposure(bool enabled, float target_luminance = 0.18f);
+
+        // Post processing
+        void setDenoise(bool enabled);
+        void setOutputFormat(OutputFormat format);
+
+        // Output variables, allocated only while enabled
+        void setAOVEnabled(AOVType type, bool enabled);
+
+        // Progress saved in the background every interval_seconds, an empty path disables checkpoints
+        void setCheckpoint(const std::string& path, float interval_seconds = 600.0f);
+
+        // Image written in the background every interval_seconds, an empty path disables it
+        void setImageOutput(const std::string& path, float interval_seconds = 60.0f, const ImageOutputOptions& options = {});
         
         // Getters
         uint32_t getWidth() const { return m_width; }
@@ -64,9 +194,29 @@ namespace render {
         uint32_t getSamplesPerPixel() const { return m_samplesPerPixel; }
         uint32_t getMaxBounces() const { return m_maxBounces; }
         uint32_t getRussianRouletteDepth() const { return m_russianRouletteDepth; }
+        RouletteMode getRouletteMode() const { return m_rouletteMode; }
+        bool getPathGuiding() const { return m_pathGuiding; }
+        SamplerType getSamplerType() const { return m_samplerType; }
+        AccumulationLayout getAccumulationLayout() const { return m_accumulationLayout; }
+        MemoryPlacement getMemoryPlacement() const { return m_memoryPlacement; }
+        BuildProfile getBuildProfile() const { return m_buildProfile; }
+        uint32_t getSampleStreamIndex() const { return m_sampleStreamIndex; }
+        uint32_t getSampleStreamCount() const { return m_sampleStreamCount; }
+        const RenderRegion& getRenderRegion() const { return m_renderRegion; }
+        // Region clipped to the resolution, the full frame when no region is set
+        RenderRegion getEffectiveRenderRegion() const;
         float getExposure() const { return m_exposure; }
         bool getAutoExposure() const { return m_autoExposure; }
         float getTargetLuminance() const { return m_targetLuminance; }
+        bool getDenoise() const { return m_denoise; }
+        OutputFormat getOutputFormat() const { return m_outputFormat; }
+        bool getAOVEnabled(AOVType type) const { return (m_aovMask & aov_bit(type)) != 0; }
+        uint32_t getAOVMask() const { return m_aovMask; }
+        const std::string& getCheckpointPath() const { return m_checkpointPath; }
+        float getCheckpointInterval() const { return m_checkpointInterval; }
+        const std::string& getImageOutputPath() const { return m_imageOutputPath; }
+        float getImageOutputInterval() const { return m_imageOutputInterval; }
+        const ImageOutputOptions& getImageOutputOptions() const { return m_imageOutputOptions; }
         
         // Dirty state management
         bool isDirty() const { return m_dirty; }
@@ -82,11 +232,36 @@ namespace render {
         uint32_t m_samplesPerPixel = 64;
         uint32_t m_maxBounces = 8;
         uint32_t m_russianRouletteDepth = 3;
+        RouletteMode m_rouletteMode = RouletteMode::Throughput;
+        bool m_pathGuiding = false;
+        SamplerType m_samplerType = SamplerType::Sobol;
+        AccumulationLayout m_accumulationLayout = AccumulationLayout::RGB32F;
+        MemoryPlacement m_memoryPlacement = MemoryPlacement::FirstTouch;
+        BuildProfile m_buildProfile = BuildProfile::Auto;
+        uint32_t m_sampleStreamIndex = 0;
+        uint32_t m_sampleStreamCount = 1;
+        RenderRegion m_renderRegion;
         
         // Exposure and tone mapping
         float m_exposure = 1.0f;
         bool m_autoExposure = false;
         float m_targetLuminance = 0.18f;
+
+        // Post processing
+        bool m_denoise = false;
+        OutputFormat m_outputFormat = OutputFormat::RGBA8;
+
+        // Output variables
+        uint32_t m_aovMask = 0;
+
+        // Checkpoints
+        std::string m_checkpointPath;
+        float m_checkpointInterval = 600.0f;
+
+        // Periodic image output
+        std::string m_imageOutputPath;
+        float m_imageOutputInterval = 60.0f;
+        ImageOutputOptions m_imageOutputOptions;
         
         // Dirty flag
         bool m_dirty = true;  // Dirty on construction
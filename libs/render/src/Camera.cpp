@@ -0,0 +1,95 @@
+#include "render/Camera.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace render {
+
+    namespace {
+        std::atomic<uint64_t> g_next_version{1};
+
+        uint64_t next_version() {
+            return g_next_version.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Camera::Camera() {
+        updateFrame();
+    }
+
+    void Camera::setPosition(const glm::vec3& position) {
+        if (m_position != position) {
+            m_position = position;
+            updateFrame();
+        }
+    }
+
+    void Camera::setTarget(const glm::vec3& target) {
+        if (m_target != target) {
+            m_target = target;
+            updateFrame();
+        }
+    }
+
+    void Camera::setUp(const glm::vec3& up) {
+        if (m_up != up) {
+            m_up = up;
+            updateFrame();
+        }
+    }
+
+    void Camera::lookAt(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up) {
+        if (m_position != position || m_target != target || m_up != up) {
+            m_position = position;
+            m_target = target;
+            m_up = up;
+            updateFrame();
+        }
+    }
+
+    void Camera::setFieldOfView(float degrees) {
+        if (m_fov != degrees) {
+            m_fov = degrees;
+            updateFrame();
+        }
+    }
+
+    void Camera::setAperture(float radius) {
+        if (m_aperture != radius) {
+            m_aperture = std::max(radius, 0.0f);
+            m_version = next_version();
+        }
+    }
+
+    void Camera::setFocusDistance(float distance) {
+        if (m_focusDistance != distance) {
+            m_focusDistance = distance;
+            m_version = next_version();
+        }
+    }
+
+    glm::vec3 Camera::getRayDirection(const glm::vec2& ndc, float aspect) const {
+        const float x = ndc.x * aspect * m_tanHalfFov;
+        const float y = ndc.y * m_tanHalfFov;
+        return glm::normalize(x * m_right + y * m_upAxis + m_forward);
+    }
+
+    void Camera::updateFrame() {
+        // Keep the previous frame if the view axis is degenerate (target on the position or parallel to up)
+        const glm::vec3 view = m_target - m_position;
+        if (glm::dot(view, view) > 0.0f) {
+            const glm::vec3 forward = glm::normalize(view);
+            const glm::vec3 right = glm::cross(m_up, forward);
+            if (glm::dot(right, right) > 1e-12f) {
+                m_forward = forward;
+                m_right = glm::normalize(right);
+                m_upAxis = glm::cross(m_forward, m_right);
+            }
+        }
+
+        m_tanHalfFov = std::tan(glm::radians(m_fov) * 0.5f);
+        m_version = next_version();
+    }
+
+}
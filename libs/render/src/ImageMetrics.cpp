@@ -0,0 +1,55 @@
+#include "render/ImageMetrics.h"
+
+#include <cmath>
+
+namespace render
+{
+	namespace
+	{
+		// Keeps the relative error of black reference pixels finite, the usual choice in the denoising literature
+		constexpr double RELATIVE_MSE_EPSILON = 1e-2;
+	}
+
+	ImageError compare_images(const float *image, uint32_t image_channels, const float *reference, uint32_t reference_channels,
+							  size_t pixel_count)
+	{
+		ImageError error;
+		if (pixel_count == 0)
+			return error;
+
+		// Summed in double, a 4K image has 25M terms
+		double squared = 0.0;
+		double relative = 0.0;
+		for (size_t i = 0; i < pixel_count; i++)
+		{
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				const double value = image[i * image_channels + c];
+				const double expected = reference[i * reference_channels + c];
+				const double difference = value - expected;
+				squared += difference * difference;
+				relative += difference * difference / (expected * expected + RELATIVE_MSE_EPSILON);
+			}
+		}
+
+		const double count = static_cast<double>(pixel_count) * 3.0;
+		error.rmse = std::sqrt(squared / count);
+		error.relative_mse = relative / count;
+		return error;
+	}
+
+	void average_accumulation(const PathTracer::AccumulationSnapshot &snapshot, std::vector<float> &rgb)
+	{
+		const size_t pixel_count = static_cast<size_t>(snapshot.width) * snapshot.height;
+		rgb.resize(pixel_count * 3);
+		for (size_t i = 0; i < pixel_count; i++)
+		{
+			// Pixels of a render region have their own counts, see AccumulationSnapshot::sample_counts
+			const float samples = snapshot.sample_counts.empty() ? static_cast<float>(snapshot.sample_count) : snapshot.sample_counts[i];
+			const float scale = samples > 0.0f ? 1.0f / samples : 0.0f;
+			for (uint32_t c = 0; c < 3; c++)
+				rgb[i * 3 + c] = snapshot.color[i * snapshot.channels + c] * scale;
+		}
+	}
+
+} // namespace render
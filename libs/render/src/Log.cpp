@@ -1,32 +1,213 @@
 #include "render/Log.h"
+#include <array>
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 namespace render {
 
 namespace {
-    LogCallback g_callback = nullptr;
-    LogLevel g_min_level = LogLevel::Info;
+    std::atomic<LogLevel> g_min_level = LogLevel::Info;
+
+    // Bounded multi-producer queue (Vyukov), a slot's sequence tells whose turn it is:
+    // position = free for the producer of that position, position + 1 = filled for the consumer
+    class LogQueue {
+    public:
+        static constexpr uint64_t CAPACITY = 4096; // Power of two
+
+        LogQueue() {
+            for (uint64_t i = 0; i < CAPACITY; i++)
+                m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        // Any thread, false when the queue is full
+        bool push(LogLevel level, std::string &&message) {
+            uint64_t position = m_tail.load(std::memory_order_relaxed);
+            Slot *slot;
+            while (true) {
+                slot = &m_slots[position & (CAPACITY - 1)];
+                const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+                const int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+                if (difference == 0) {
+                    if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+
+            slot->level = level;
+            slot->message = std::move(message);
+            slot->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Positions claimed by producers so far, the consumer pops them in this order
+        uint64_t get_tail() const { return m_tail.load(std::memory_order_acquire); }
+
+        // Logging thread only
+        bool pop(LogLevel &level, std::string &message) {
+            Slot &slot = m_slots[m_head & (CAPACITY - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != m_head + 1)
+                return false;
+
+            level = slot.level;
+            message = std::move(slot.message);
+            slot.sequence.store(m_head + CAPACITY, std::memory_order_release);
+            m_head++;
+            return true;
+        }
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> sequence{0};
+            LogLevel level = LogLevel::Info;
+            std::string message;
+        };
+
+        std::array<Slot, CAPACITY> m_slots;
+        alignas(64) std::atomic<uint64_t> m_tail{0};
+        alignas(64) uint64_t m_head = 0;
+    };
+
+    // Owns the logging thread, created on first use and drained on exit
+    class Logger {
+    public:
+        Logger() : m_thread([this] { run(); }) {}
+
+        ~Logger() {
+            m_stop.store(true, std::memory_order_release);
+            wake();
+            m_thread.join();
+        }
+
+        void enqueue(LogLevel level, std::string message) {
+            if (!m_queue.push(level, std::move(message))) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            wake();
+        }
+
+        void set_callback(LogCallback callback) {
+            std::lock_guard lock(m_callback_mutex);
+            m_callback = std::move(callback);
+        }
+
+        void flush() {
+            // The callback itself logging and flushing would wait for itself
+            if (std::this_thread::get_id() == m_thread.get_id())
+                return;
+
+            // Every message pushed before this point holds a position below the tail. A counter bumped after
+            // the push could lag behind a later message, which then passes for delivered before it is
+            const uint64_t target = m_queue.get_tail();
+            uint64_t delivered = m_delivered.load(std::memory_order_acquire);
+            while (delivered < target) {
+                m_delivered.wait(delivered, std::memory_order_acquire);
+                delivered = m_delivered.load(std::memory_order_acquire);
+            }
+        }
+
+        uint64_t get_dropped_count() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    private:
+        void wake() {
+            m_signal.fetch_add(1, std::memory_order_release);
+            m_signal.notify_one();
+        }
+
+        void run() {
+            while (true) {
+                const uint64_t signal = m_signal.load(std::memory_order_acquire);
+                const bool stop = m_stop.load(std::memory_order_acquire);
+                drain();
+                if (stop)
+                    return;
+                m_signal.wait(signal, std::memory_order_acquire);
+            }
+        }
+
+        void drain() {
+            std::lock_guard lock(m_callback_mutex);
+
+            uint64_t count = 0;
+            LogLevel level;
+            std::string message;
+            while (m_queue.pop(level, message)) {
+                write(level, message);
+                count++;
+            }
+
+            const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+            if (dropped != m_reported_dropped) {
+                write(LogLevel::Warn, std::format("{} log messages dropped, the log buffer was full", dropped - m_reported_dropped));
+                m_reported_dropped = dropped;
+            }
+
+            if (count > 0) {
+                if (!m_callback)
+                    std::cout.flush();
+                m_delivered.fetch_add(count, std::memory_order_release);
+                m_delivered.notify_all();
+            }
+        }
+
+        void write(LogLevel level, std::string_view message) {
+            if (m_callback) {
+                m_callback(level, message);
+            } else {
+                // Fallback to stdout if no callback is set
+                std::cout << message << '\n';
+            }
+        }
+
+    private:
+        LogQueue m_queue;
+        std::atomic<uint64_t> m_delivered{0}; // Messages handed to the callback, equals the queue head, flush() waits on it
+        std::atomic<uint64_t> m_dropped{0};
+        uint64_t m_reported_dropped = 0;
+
+        std::atomic<uint64_t> m_signal{0}; // Bumped by every push, the logging thread sleeps on it
+        std::atomic<bool> m_stop{false};
+
+        std::mutex m_callback_mutex; // Held by the logging thread while it delivers, never by producers
+        LogCallback m_callback;
+
+        std::thread m_thread; // Last, starts once everything above is constructed
+    };
+
+    Logger &get_logger() {
+        static Logger logger;
+        return logger;
+    }
 }
 
 void Log::set_callback(LogCallback callback) {
-    g_callback = std::move(callback);
+    get_logger().set_callback(std::move(callback));
 }
 
 void Log::set_level(LogLevel min_level) {
-    g_min_level = min_level;
+    g_min_level.store(min_level, std::memory_order_relaxed);
+}
+
+void Log::flush() {
+    get_logger().flush();
+}
+
+uint64_t Log::get_dropped_count() {
+    return get_logger().get_dropped_count();
 }
 
 bool Log::should_log(LogLevel level) {
-    return static_cast<int>(level) >= static_cast<int>(g_min_level);
+    return static_cast<int>(level) >= static_cast<int>(g_min_level.load(std::memory_order_relaxed));
 }
 
-void Log::send_to_callback(LogLevel level, std::string_view message) {
-    if (g_callback) {
-        g_callback(level, message);
-    } else {
-        // Fallback to stdout if no callback is set
-        std::cout << message << std::endl;
-    }
+void Log::enqueue(LogLevel level, std::string message) {
+    get_logger().enqueue(level, std::move(message));
 }
 
-} // namespace render
\ No newline at end of file
+} // namespace render
@@ -0,0 +1,238 @@
+#include "render/MathBenchmark.h"
+
+#include "utils/Math.h"
+#include "utils/MathBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+
+namespace render
+{
+	namespace
+	{
+		// Composing matrices touches 16x the memory of the other kernels, fewer elements keep the buffers comparable
+		constexpr size_t ELEMENTS_PER_MATRIX = 16;
+
+		/// Fastest of repeats runs, reset restores the inputs of in-place kernels outside the timed region
+		double time_best(uint32_t repeats, const std::function<void()> &reset, const std::function<void()> &run)
+		{
+			double best = 0.0;
+			for (uint32_t i = 0; i < repeats; i++)
+			{
+				if (reset)
+					reset();
+				const auto start = std::chrono::steady_clock::now();
+				run();
+				const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				best = i == 0 ? seconds : std::min(best, seconds);
+			}
+			return best;
+		}
+
+		double max_difference(const std::vector<float> &a, const std::vector<float> &b)
+		{
+			double difference = 0.0;
+			for (size_t i = 0; i < a.size(); i++)
+				difference = std::max(difference, static_cast<double>(std::abs(a[i] - b[i])));
+			return difference;
+		}
+
+		std::vector<float> make_uniform(size_t count, float min, float max, std::mt19937 &rng)
+		{
+			std::uniform_real_distribution<float> distribution(min, max);
+			std::vector<float> values(count);
+			for (float &value : values)
+				value = distribution(rng);
+			return values;
+		}
+
+		/// SoA vec3 buffers in the layout the batch kernels take
+		struct Vec3Buffer
+		{
+			explicit Vec3Buffer(size_t count) : x(count), y(count), z(count) {}
+
+			Math::Vec3Streams streams() { return {x.data(), y.data(), z.data()}; }
+			Math::ConstVec3Streams const_streams() const { return {x.data(), y.data(), z.data()}; }
+
+			glm::vec3 get(size_t i) const { return glm::vec3(x[i], y[i], z[i]); }
+			void set(size_t i, const glm::vec3 &v)
+			{
+				x[i] = v.x;
+				y[i] = v.y;
+				z[i] = v.z;
+			}
+
+			double max_difference(const Vec3Buffer &other) const
+			{
+				return std::max({render::max_difference(x, other.x), render::max_difference(y, other.y), render::max_difference(z, other.z)});
+			}
+
+			std::vector<float> x, y, z;
+		};
+
+		Vec3Buffer make_unit_vectors(size_t count, std::mt19937 &rng)
+		{
+			std::normal_distribution<float> distribution;
+			Vec3Buffer vectors(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				glm::vec3 v(distribution(rng), distribution(rng), distribution(rng));
+				const float length = glm::length(v);
+				vectors.set(i, length > 1e-6f ? v / length : glm::vec3(0.0f, 0.0f, 1.0f));
+			}
+			return vectors;
+		}
+	}
+
+	std::vector<MathKernelTiming> benchmark_math_kernels(size_t count, uint32_t repeats)
+	{
+		count = std::max<size_t>(count, ELEMENTS_PER_MATRIX * 2);
+		repeats = std::max(repeats, 1u);
+
+		std::mt19937 rng(0x5eed);
+		std::vector<MathKernelTiming> timings;
+		const auto add = [&](const char *name, size_t elements, double scalar_seconds, double batch_seconds, double difference) {
+			MathKernelTiming timing;
+			timing.name = name;
+			timing.scalar_ns = scalar_seconds * 1e9 / static_cast<double>(elements);
+			timing.batch_ns = batch_seconds * 1e9 / static_cast<double>(elements);
+			timing.max_difference = difference;
+			timings.push_back(timing);
+		};
+
+		{
+			const std::vector<float> x = make_uniform(count, 1e-2f, 1e2f, rng);
+			std::vector<float> scalar(count), batch(count);
+			const double scalar_seconds = time_best(repeats, {}, [&]() {
+				for (size_t i = 0; i < count; i++)
+					scalar[i] = Math::fastRsqrt(x[i]);
+			});
+			const double batch_seconds = time_best(repeats, {}, [&]() { Math::fastRsqrtBatch(x.data(), batch.data(), count); });
+			add("fastRsqrt", count, scalar_seconds, batch_seconds, max_difference(scalar, batch));
+		}
+
+		{
+			const std::vector<float> x = make_uniform(count, -100.0f, 100.0f, rng);
+			std::vector<float> scalar_sin(count), scalar_cos(count), batch_sin(count), batch_cos(count);
+			const double scalar_seconds = time_best(repeats, {}, [&]() {
+				for (size_t i = 0; i < count; i++)
+					Math::sincos(x[i], scalar_sin[i], scalar_cos[i]);
+			});
+			const double batch_seconds = time_best(repeats, {}, [&]() { Math::sincosBatch(x.data(), batch_sin.data(), batch_cos.data(), count); });
+			add("sincos", count, scalar_seconds, batch_seconds, std::max(max_difference(scalar_sin, batch_sin), max_difference(scalar_cos, batch_cos)));
+		}
+
+		const Vec3Buffer normals = make_unit_vectors(count, rng);
+		{
+			Vec3Buffer scalar_tangents(count), scalar_bitangents(count), batch_tangents(count), batch_bitangents(count);
+			const double scalar_seconds = time_best(repeats, {}, [&]() {
+				for (size_t i = 0; i < count; i++)
+				{
+					glm::vec3 tangent, bitangent;
+					Math::buildOrthonormalBasis(normals.get(i), tangent, bitangent);
+					scalar_tangents.set(i, tangent);
+					scalar_bitangents.set(i, bitangent);
+				}
+			});
+			const double batch_seconds = time_best(repeats, {}, [&]() {
+				Math::buildOrthonormalBasisBatch(normals.const_streams(), batch_tangents.streams(), batch_bitangents.streams(), count);
+			});
+			add("buildOrthonormalBasis", count, scalar_seconds, batch_seconds,
+				std::max(scalar_tangents.max_difference(batch_tangents), scalar_bitangents.max_difference(batch_bitangents)));
+		}
+
+		{
+			const std::vector<float> u1 = make_uniform(count, 0.0f, 1.0f, rng);
+			const std::vector<float> u2 = make_uniform(count, 0.0f, 1.0f, rng);
+			Vec3Buffer scalar(count), batch(count);
+			const double scalar_seconds = time_best(repeats, {}, [&]() {
+				for (size_t i = 0; i < count; i++)
+					scalar.set(i, Math::sampleCosineHemisphere(normals.get(i), glm::vec2(u1[i], u2[i])));
+			});
+			const double batch_seconds = time_best(repeats, {}, [&]() {
+				Math::sampleCosineHemisphereBatch(normals.const_streams(), u1.data(), u2.data(), batch.streams(), count);
+			});
+			add("sampleCosineHemisphere", count, scalar_seconds, batch_seconds, scalar.max_difference(batch));
+		}
+
+		{
+			// In place on RGB triplets, the scalar versions take a vec3
+			constexpr float exposure = 1.5f;
+			const size_t channels = count / 3 * 3;
+			const std::vector<float> hdr = make_uniform(channels, 0.0f, 16.0f, rng);
+			std::vector<float> scalar, batch;
+			const auto reset = [&]() {
+				scalar = hdr;
+				batch = hdr;
+			};
+
+			double scalar_seconds = time_best(repeats, reset, [&]() {
+				for (size_t i = 0; i < channels; i += 3)
+				{
+					const glm::vec3 mapped = Math::acesTonemap(glm::vec3(scalar[i], scalar[i + 1], scalar[i + 2]), exposure);
+					scalar[i] = mapped.x;
+					scalar[i + 1] = mapped.y;
+					scalar[i + 2] = mapped.z;
+				}
+			});
+			double batch_seconds = time_best(repeats, reset, [&]() { Math::acesTonemapBatch(batch.data(), channels, exposure); });
+			add("acesTonemap", channels, scalar_seconds, batch_seconds, max_difference(scalar, batch));
+
+			scalar_seconds = time_best(repeats, reset, [&]() {
+				for (size_t i = 0; i < channels; i += 3)
+				{
+					const glm::vec3 mapped = Math::reinhardTonemap(glm::vec3(scalar[i], scalar[i + 1], scalar[i + 2]), exposure);
+					scalar[i] = mapped.x;
+					scalar[i + 1] = mapped.y;
+					scalar[i + 2] = mapped.z;
+				}
+			});
+			batch_seconds = time_best(repeats, reset, [&]() { Math::reinhardTonemapBatch(batch.data(), channels, exposure); });
+			add("reinhardTonemap", channels, scalar_seconds, batch_seconds, max_difference(scalar, batch));
+		}
+
+		{
+			// A random tree in topological order, every parent index below its child's
+			const size_t matrix_count = count / ELEMENTS_PER_MATRIX;
+			std::vector<uint32_t> parents(matrix_count, 0);
+			std::vector<glm::mat4> locals(matrix_count);
+			const std::vector<float> offsets = make_uniform(matrix_count * 3, -1.0f, 1.0f, rng);
+			for (size_t i = 0; i < matrix_count; i++)
+			{
+				if (i > 0)
+					parents[i] = std::uniform_int_distribution<uint32_t>(0, static_cast<uint32_t>(i - 1))(rng);
+				locals[i] = glm::mat4(1.0f);
+				locals[i][3] = glm::vec4(offsets[3 * i], offsets[3 * i + 1], offsets[3 * i + 2], 1.0f);
+			}
+
+			std::vector<glm::mat4> scalar(matrix_count), batch(matrix_count);
+			const double scalar_seconds = time_best(repeats, {}, [&]() {
+				scalar[0] = locals[0];
+				for (size_t i = 1; i < matrix_count; i++)
+					scalar[i] = scalar[parents[i]] * locals[i];
+			});
+			const double batch_seconds = time_best(repeats, {}, [&]() {
+				batch[0] = locals[0];
+				Math::composeHierarchyBatch(parents.data(), reinterpret_cast<const float *>(locals.data()), reinterpret_cast<float *>(batch.data()), 1,
+											matrix_count);
+			});
+
+			double difference = 0.0;
+			for (size_t i = 0; i < matrix_count; i++)
+			{
+				for (int column = 0; column < 4; column++)
+				{
+					for (int row = 0; row < 4; row++)
+						difference = std::max(difference, static_cast<double>(std::abs(scalar[i][column][row] - batch[i][column][row])));
+				}
+			}
+			add("composeHierarchy", matrix_count, scalar_seconds, batch_seconds, difference);
+		}
+
+		return timings;
+	}
+
+} // namespace render
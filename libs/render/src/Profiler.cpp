@@ -0,0 +1,155 @@
+#include "render/Profiler.h"
+#include <algorithm>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace render {
+
+std::atomic<bool> Profiler::s_enabled{false};
+const std::chrono::steady_clock::time_point Profiler::s_origin = std::chrono::steady_clock::now();
+
+namespace {
+    // Frames kept for the live view and the trace export
+    constexpr size_t RETAINED_FRAMES = 240;
+
+    // Bound for threads recording without anyone calling begin_frame()
+    constexpr size_t MAX_THREAD_EVENTS = 1 << 20;
+
+    // Written by its own thread, the lock is only contended while a frame is collected or exported
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::deque<ProfileEvent> events;
+        std::string name;
+        uint32_t index = 0;
+    };
+
+    struct ProfilerState {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> threads; // Kept after a thread exits, its events stay exportable
+        std::deque<uint64_t> frame_starts;
+    };
+
+    ProfilerState& get_state() {
+        static ProfilerState state;
+        return state;
+    }
+
+    thread_local std::shared_ptr<ThreadBuffer> t_buffer;
+
+    ThreadBuffer& get_thread_buffer() {
+        if (!t_buffer) {
+            ProfilerState& state = get_state();
+            std::lock_guard lock(state.mutex);
+            t_buffer = std::make_shared<ThreadBuffer>();
+            t_buffer->index = static_cast<uint32_t>(state.threads.size());
+            t_buffer->name = std::format("Thread {}", t_buffer->index);
+            state.threads.push_back(t_buffer);
+        }
+        return *t_buffer;
+    }
+
+    // Names are literals from RENDER_PROFILE_SCOPE, only quotes and backslashes need escaping
+    std::string escape_json(std::string_view text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+void Profiler::set_enabled(bool enabled) {
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::begin_frame() {
+    ProfilerState& state = get_state();
+    std::lock_guard lock(state.mutex);
+    state.frame_starts.push_back(now_ns());
+    if (state.frame_starts.size() <= RETAINED_FRAMES + 1)
+        return;
+
+    state.frame_starts.pop_front();
+    const uint64_t oldest = state.frame_starts.front();
+    for (const auto& thread : state.threads) {
+        std::lock_guard thread_lock(thread->mutex);
+        while (!thread->events.empty() && thread->events.front().start_ns < oldest)
+            thread->events.pop_front();
+    }
+}
+
+void Profiler::set_thread_name(std::string name) {
+    ThreadBuffer& buffer = get_thread_buffer();
+    std::lock_guard lock(buffer.mutex);
+    buffer.name = std::move(name);
+}
+
+void Profiler::record(const char* name, uint64_t start_ns, uint64_t end_ns) {
+    ThreadBuffer& buffer = get_thread_buffer();
+    std::lock_guard lock(buffer.mutex);
+    if (buffer.events.size() >= MAX_THREAD_EVENTS)
+        buffer.events.pop_front();
+    buffer.events.push_back({name, start_ns, end_ns, buffer.index});
+}
+
+bool Profiler::get_last_frame(ProfileFrame& frame) {
+    ProfilerState& state = get_state();
+    std::lock_guard lock(state.mutex);
+    if (state.frame_starts.size() < 2)
+        return false;
+
+    frame.start_ns = state.frame_starts[state.frame_starts.size() - 2];
+    frame.end_ns = state.frame_starts.back();
+    frame.events.clear();
+    frame.thread_names.clear();
+    for (const auto& thread : state.threads) {
+        std::lock_guard thread_lock(thread->mutex);
+        frame.thread_names.push_back(thread->name);
+        // Scopes are recorded when they end, so events are ordered by end time
+        for (const ProfileEvent& event : thread->events) {
+            if (event.end_ns > frame.start_ns && event.start_ns < frame.end_ns)
+                frame.events.push_back(event);
+        }
+    }
+    std::ranges::sort(frame.events, [](const ProfileEvent& a, const ProfileEvent& b) {
+        return a.thread != b.thread ? a.thread < b.thread : a.start_ns < b.start_ns;
+    });
+    return true;
+}
+
+bool Profiler::write_chrome_trace(const std::string& path) {
+    std::ofstream file(path);
+    if (!file)
+        return false;
+
+    // Complete ("X") events in microseconds, one track per thread
+    ProfilerState& state = get_state();
+    std::lock_guard lock(state.mutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& thread : state.threads) {
+        std::lock_guard thread_lock(thread->mutex);
+        file << (first ? "" : ",")
+             << std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}", thread->index,
+                            escape_json(thread->name));
+        first = false;
+        for (const ProfileEvent& event : thread->events) {
+            file << std::format(",{{\"name\":\"{}\",\"cat\":\"render\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                                escape_json(event.name), event.thread, event.start_ns / 1e3, (event.end_ns - event.start_ns) / 1e3);
+        }
+    }
+    // Frame boundaries as global instant events
+    for (uint64_t frame_start : state.frame_starts) {
+        file << (first ? "" : ",") << std::format("{{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":{:.3f}}}", frame_start / 1e3);
+        first = false;
+    }
+    file << "]}\n";
+    return static_cast<bool>(file);
+}
+
+} // namespace render
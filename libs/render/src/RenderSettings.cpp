@@ -1,5 +1,7 @@
 #include "render/Types.h"
 
+#include <algorithm>
+
 namespace render {
 
     void RenderSettings::setResolution(uint32_t width, uint32_t height) {
@@ -38,19 +40,114 @@ namespace render {
         }
     }
 
-    void RenderSettings::setExposure(float exposure) {
-        if (m_exposure != exposure) {
-            m_exposure = exposure;
+    void RenderSettings::setRouletteMode(RouletteMode mode) {
+        // Learned factors start over with the accumulation
+        if (m_rouletteMode != mode) {
+            m_rouletteMode = mode;
+            markDirty();
+        }
+    }
+
+    void RenderSettings::setPathGuiding(bool enabled) {
+        // Training starts over with the accumulation
+        if (m_pathGuiding != enabled) {
+            m_pathGuiding = enabled;
+            markDirty();
+        }
+    }
+
+    void RenderSettings::setSamplerType(SamplerType type) {
+        if (m_samplerType != type) {
+            m_samplerType = type;
+            markDirty();
+        }
+    }
+
+    void RenderSettings::setAccumulationLayout(AccumulationLayout layout) {
+        if (m_accumulationLayout != layout) {
+            m_accumulationLayout = layout;
+            markDirty();
+        }
+    }
+
+    void RenderSettings::setMemoryPlacement(MemoryPlacement placement) {
+        if (m_memoryPlacement != placement) {
+            m_memoryPlacement = placement;
+            markDirty();
+        }
+    }
+
+    void RenderSettings::setBuildProfile(BuildProfile profile) {
+        m_buildProfile = profile;
+    }
+
+    void RenderSettings::setSampleStream(uint32_t index, uint32_t count) {
+        count = std::max(count, 1u);
+        index = std::min(index, count - 1);
+        if (m_sampleStreamIndex != index || m_sampleStreamCount != count) {
+            m_sampleStreamIndex = index;
+            m_sampleStreamCount = count;
             markDirty();
         }
     }
 
+    void RenderSettings::setRenderRegion(const RenderRegion& region) {
+        m_renderRegion = region;
+    }
+
+    RenderRegion RenderSettings::getEffectiveRenderRegion() const {
+        if (m_renderRegion.isEmpty() || m_width == 0 || m_height == 0)
+            return {0, 0, m_width, m_height};
+
+        // A region outside the frame still covers its last pixel
+        RenderRegion region;
+        region.x = std::min(m_renderRegion.x, m_width - 1);
+        region.y = std::min(m_renderRegion.y, m_height - 1);
+        region.width = std::min(m_renderRegion.width, m_width - region.x);
+        region.height = std::min(m_renderRegion.height, m_height - region.y);
+        return region;
+    }
+
+    void RenderSettings::setExposure(float exposure) {
+        // Applied at resolve time, the accumulated samples stay valid
+        m_exposure = exposure;
+    }
+
     void RenderSettings::setAutoExposure(bool enabled, float target_luminance) {
-        if (m_autoExposure != enabled || m_targetLuminance != target_luminance) {
-            m_autoExposure = enabled;
-            m_targetLuminance = target_luminance;
+        m_autoExposure = enabled;
+        m_targetLuminance = target_luminance;
+    }
+
+    void RenderSettings::setDenoise(bool enabled) {
+        if (m_denoise != enabled) {
+            m_denoise = enabled;
             markDirty();
         }
     }
 
-}
\ No newline at end of file
+    void RenderSettings::setOutputFormat(OutputFormat format) {
+        // Only affects the resolve, the accumulated samples stay valid
+        m_outputFormat = format;
+    }
+
+    void RenderSettings::setAOVEnabled(AOVType type, bool enabled) {
+        const uint32_t mask = enabled ? (m_aovMask | aov_bit(type)) : (m_aovMask & ~aov_bit(type));
+        if (m_aovMask != mask) {
+            m_aovMask = mask;
+            markDirty();
+        }
+    }
+
+    void RenderSettings::setCheckpoint(const std::string& path, float interval_seconds) {
+        // Saving progress never invalidates it
+        m_checkpointPath = path;
+        m_checkpointInterval = std::max(interval_seconds, 0.0f);
+    }
+
+    void RenderSettings::setImageOutput(const std::string& path, float interval_seconds, const ImageOutputOptions& options) {
+        m_imageOutputPath = path;
+        m_imageOutputInterval = std::max(interval_seconds, 0.0f);
+        m_imageOutputOptions = options;
+    }
+
+}
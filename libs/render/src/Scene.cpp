@@ -1,11 +1,184 @@
 #include "render/Scene.h"
-// #include <algorithm>
+
+#include "utils/MathBatch.h"
+
+#include <algorithm>
 
 // #include <OpenImageIO/imageio.h>
 
 namespace render {
 	// Define the static member
 	NodeID SceneNode::s_nextID = 1;
+
+	bool SceneJournal::getEventsSince(uint64_t version, std::vector<SceneEvent>& events) const
+	{
+		if (version < m_firstVersion)
+			return false;
+		if (version >= getVersion())
+			return true;
+		events.insert(events.end(), m_events.begin() + static_cast<ptrdiff_t>(version - m_firstVersion), m_events.end());
+		return true;
+	}
+
+	uint32_t SceneJournal::summarize(const std::vector<SceneEvent>& events)
+	{
+		uint32_t changes = 0;
+		for (const SceneEvent& event : events)
+		{
+			switch (event.type)
+			{
+			case SceneEventType::NodeAdded:
+			case SceneEventType::NodeRemoved:
+				changes |= SceneChange::TOPOLOGY;
+				break;
+			case SceneEventType::TransformChanged:
+			case SceneEventType::RadiusChanged:
+				changes |= SceneChange::TRANSFORM;
+				break;
+			case SceneEventType::MaterialChanged:
+				changes |= SceneChange::MATERIAL;
+				break;
+			}
+		}
+		return changes;
+	}
+
+	void SceneJournal::record(SceneEventType type, NodeID node)
+	{
+		const SceneEvent event{type, node};
+		if (m_transactionDepth == 0)
+		{
+			publish(event);
+			return;
+		}
+
+		// Dragging a node records hundreds of identical edits, one is enough
+		const uint64_t key = (static_cast<uint64_t>(node) << 8) | static_cast<uint64_t>(type);
+		if (m_pendingKeys.insert(key).second)
+			m_pending.push_back(event);
+	}
+
+	void SceneJournal::commitTransaction()
+	{
+		if (m_transactionDepth == 0 || --m_transactionDepth > 0)
+			return;
+
+		for (const SceneEvent& event : m_pending)
+			publish(event);
+		m_pending.clear();
+		m_pendingKeys.clear();
+	}
+
+	void SceneJournal::publish(const SceneEvent& event)
+	{
+		m_events.push_back(event);
+		if (m_events.size() > MAX_EVENTS)
+		{
+			m_events.pop_front();
+			m_firstVersion++;
+		}
+	}
+
+	void TransformHierarchy::update(SceneNode& root)
+	{
+		if (m_structureDirty)
+		{
+			rebuild(root);
+			return;
+		}
+		if (m_dirty.empty())
+			return;
+
+		std::ranges::sort(m_dirty);
+		const auto [first, last] = std::ranges::unique(m_dirty);
+		m_dirty.erase(first, last);
+
+		for (uint32_t index : m_dirty)
+			m_locals[index] = m_nodes[index]->GetLocalTransform().ToMatrix();
+
+		// A dirty node inside an already recomputed subtree is covered by that pass
+		uint32_t covered = 0;
+		for (uint32_t index : m_dirty)
+		{
+			if (index < covered)
+				continue;
+			covered = m_subtreeEnd[index];
+			compose(index, covered);
+		}
+		m_dirty.clear();
+	}
+
+	void TransformHierarchy::rebuild(SceneNode& root)
+	{
+		m_nodes.clear();
+		m_parents.clear();
+
+		// Depth-first preorder, children are pushed in reverse to keep their order
+		std::vector<std::pair<SceneNode*, uint32_t>> stack{{&root, 0u}};
+		while (!stack.empty())
+		{
+			const auto [node, parent] = stack.back();
+			stack.pop_back();
+
+			const uint32_t index = static_cast<uint32_t>(m_nodes.size());
+			node->m_hierarchyIndex = index;
+			m_nodes.push_back(node);
+			m_parents.push_back(parent);
+			for (auto it = node->m_children.rbegin(); it != node->m_children.rend(); ++it)
+				stack.emplace_back(*it, index);
+		}
+
+		const uint32_t count = static_cast<uint32_t>(m_nodes.size());
+		m_subtreeEnd.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+			m_subtreeEnd[i] = i + 1;
+		for (uint32_t i = count - 1; i > 0; i--)
+			m_subtreeEnd[m_parents[i]] = std::max(m_subtreeEnd[m_parents[i]], m_subtreeEnd[i]);
+
+		m_locals.resize(count);
+		m_worlds.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+			m_locals[i] = m_nodes[i]->GetLocalTransform().ToMatrix();
+		compose(0, count);
+
+		m_dirty.clear();
+		m_structureDirty = false;
+	}
+
+	void TransformHierarchy::compose(uint32_t begin, uint32_t end)
+	{
+		static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "composeHierarchyBatch expects tightly packed matrices");
+
+		// The root has no parent, its world matrix is its local one
+		if (begin == 0)
+		{
+			m_worlds[0] = m_locals[0];
+			begin = 1;
+		}
+		if (begin < end)
+			Math::composeHierarchyBatch(m_parents.data(), reinterpret_cast<const float*>(m_locals.data()), reinterpret_cast<float*>(m_worlds.data()), begin, end);
+	}
+
+	bool Scene::SetParent(NodeID childID, NodeID parentID)
+	{
+		SceneNode* child = FindNode(childID);
+		SceneNode* parent = parentID == 0 ? m_rootNode.get() : FindNode(parentID);
+		if (!child || !parent)
+			return false;
+		if (child->m_parent == parent)
+			return true;
+
+		for (const SceneNode* ancestor = parent; ancestor; ancestor = ancestor->m_parent)
+		{
+			if (ancestor == child)
+				return false;
+		}
+
+		Detach(child);
+		Attach(child, parent);
+		m_journal.record(SceneEventType::TransformChanged, childID);
+		return true;
+	}
 }
 
 // namespace render
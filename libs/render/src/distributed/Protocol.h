@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+
+#include "distributed/Socket.h"
+
+namespace render
+{
+
+	/// Wire format between RenderCoordinator and render workers
+	/// Messages are a Header followed by payload_size bytes. Structs are sent as raw host memory,
+	/// the hello exchange rejects peers with a different byte order or protocol version.
+	///
+	///   worker -> coordinator   Hello
+	///   coordinator -> worker   Job
+	///   worker -> coordinator   Update (Update + interleaved float sums)
+	///   coordinator -> worker   Continue | Stop, then the worker renders the next batch or exits
+	namespace wire
+	{
+		constexpr uint32_t MAGIC = 0x52445054; // "RDPT"
+		constexpr uint32_t VERSION = 2;
+		constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+		enum class MessageType : uint32_t
+		{
+			Hello = 1,
+			Job,
+			Update,
+			Continue,
+			Stop
+		};
+
+		struct Header
+		{
+			uint32_t magic = MAGIC;
+			MessageType type = MessageType::Hello;
+			uint64_t payload_size = 0;
+		};
+
+		struct Hello
+		{
+			uint32_t version = VERSION;
+			uint32_t byte_order = BYTE_ORDER_MARK;
+		};
+
+		struct Job
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t sampler_type = 0;
+			uint32_t max_bounces = 0;
+			uint32_t russian_roulette_depth = 0;
+			uint32_t passes_per_update = 1;
+			uint32_t stream_index = 0;
+			uint32_t stream_count = 1;
+
+			// Render region, empty = full frame
+			uint32_t region_x = 0;
+			uint32_t region_y = 0;
+			uint32_t region_width = 0;
+			uint32_t region_height = 0;
+
+			// Camera
+			float position[3] = {};
+			float target[3] = {};
+			float up[3] = {};
+			float fov = 0.0f;
+			float aperture = 0.0f;
+			float focus_distance = 0.0f;
+		};
+
+		struct Update
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t channels = 0;
+			uint32_t sample_count = 0; // Samples per pixel inside the job's region
+			double render_seconds = 0.0; // Time spent in render() since the job started
+		};
+
+		/// Header plus optional payload, false once the connection is gone
+		inline bool send_message(const Socket &socket, MessageType type, const void *payload = nullptr, uint64_t payload_size = 0)
+		{
+			Header header;
+			header.type = type;
+			header.payload_size = payload_size;
+			return socket.send_all(&header, sizeof(header)) && (payload_size == 0 || socket.send_all(payload, payload_size));
+		}
+
+		/// Reads the next header, false on a closed connection or a foreign peer
+		inline bool receive_header(const Socket &socket, Header &header)
+		{
+			return socket.receive_all(&header, sizeof(header)) && header.magic == MAGIC;
+		}
+
+		/// Reads a message whose payload is exactly T
+		template <typename T>
+		bool receive_message(const Socket &socket, MessageType type, T &payload)
+		{
+			Header header;
+			return receive_header(socket, header) && header.type == type && header.payload_size == sizeof(T) &&
+				   socket.receive_all(&payload, sizeof(T));
+		}
+	}
+
+} // namespace render
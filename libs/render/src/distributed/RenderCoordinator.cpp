@@ -0,0 +1,352 @@
+#include "render/Distributed.h"
+
+#include "distributed/Protocol.h"
+#include "distributed/Socket.h"
+#include "engines/pathtracer/resolve/Resolve.h"
+#include "utils/ThreadPool.h"
+
+#include "render/Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace render
+{
+	namespace
+	{
+		/// Band of rows worker index renders when the job is split by region, bands differ by at most one row
+		RenderRegion get_worker_region(const DistributedJob &job, uint32_t index, uint32_t worker_count)
+		{
+			const uint32_t y0 = static_cast<uint32_t>(static_cast<uint64_t>(job.height) * index / worker_count);
+			const uint32_t y1 = static_cast<uint32_t>(static_cast<uint64_t>(job.height) * (index + 1) / worker_count);
+			return {0, y0, job.width, y1 - y0};
+		}
+
+		wire::Job make_wire_job(const DistributedJob &job, uint32_t index, uint32_t worker_count)
+		{
+			wire::Job wire_job;
+			wire_job.width = job.width;
+			wire_job.height = job.height;
+			wire_job.sampler_type = static_cast<uint32_t>(job.sampler_type);
+			wire_job.max_bounces = job.max_bounces;
+			wire_job.russian_roulette_depth = job.russian_roulette_depth;
+			wire_job.passes_per_update = std::max(job.passes_per_update, 1u);
+			if (job.split_by_region)
+			{
+				// Every band takes the whole sample sequence
+				const RenderRegion region = get_worker_region(job, index, worker_count);
+				wire_job.region_x = region.x;
+				wire_job.region_y = region.y;
+				wire_job.region_width = region.width;
+				wire_job.region_height = region.height;
+			}
+			else
+			{
+				wire_job.stream_index = index;
+				wire_job.stream_count = worker_count;
+			}
+
+			const Camera &camera = job.camera;
+			for (int i = 0; i < 3; i++)
+			{
+				wire_job.position[i] = camera.getPosition()[i];
+				wire_job.target[i] = camera.getTarget()[i];
+				wire_job.up[i] = camera.getUp()[i];
+			}
+			wire_job.fov = camera.getFieldOfView();
+			wire_job.aperture = camera.getAperture();
+			wire_job.focus_distance = camera.getFocusDistance();
+			return wire_job;
+		}
+	}
+
+	class SocketRenderCoordinator : public RenderCoordinator
+	{
+	public:
+		explicit SocketRenderCoordinator(const std::string &address)
+			: m_listener(Socket::listen(address)), m_address(address)
+		{
+			Log::info("Render coordinator listening on {}", address);
+		}
+
+		~SocketRenderCoordinator() override
+		{
+			stop();
+			for (std::thread &thread : m_threads)
+				thread.join();
+		}
+
+		void start(const DistributedJob &job, uint32_t worker_count) override
+		{
+			if (!m_workers.empty())
+				throw std::runtime_error("Render coordinator already started");
+			if (worker_count == 0 || job.width == 0 || job.height == 0)
+				throw std::runtime_error("Distributed job needs at least one worker and a non-empty image");
+			if (job.split_by_region && job.height < worker_count)
+				throw std::runtime_error("Distributed job split by region needs at least one row per worker");
+
+			m_job = job;
+			m_workers.resize(worker_count);
+
+			try
+			{
+				accept_workers(job, worker_count);
+			}
+			catch (...)
+			{
+				abort_start();
+				throw;
+			}
+		}
+
+		void wait() override
+		{
+			std::unique_lock lock(m_mutex);
+			m_done_cv.wait(lock, [this] { return m_active_workers == 0; });
+		}
+
+		void stop() override
+		{
+			m_stop = true;
+		}
+
+		uint32_t get_sample_count() const override
+		{
+			std::lock_guard lock(m_mutex);
+			return total_samples();
+		}
+
+		std::vector<DistributedWorkerStats> get_worker_stats() const override
+		{
+			std::lock_guard lock(m_mutex);
+			std::vector<DistributedWorkerStats> stats;
+			stats.reserve(m_workers.size());
+			for (const Worker &worker : m_workers)
+				stats.push_back(worker.stats);
+			return stats;
+		}
+
+		void get_accumulation(PathTracer::AccumulationSnapshot &snapshot) const override
+		{
+			snapshot.width = m_job.width;
+			snapshot.height = m_job.height;
+			snapshot.channels = accumulation_channel_count(AccumulationLayout::RGB32F);
+			snapshot.color.assign(static_cast<size_t>(snapshot.width) * snapshot.height * snapshot.channels, 0.0f);
+
+			// Streams are disjoint, so their sums add up to the sums of one renderer taking all the samples.
+			// Bands are disjoint too, a worker's sums are zero outside its band.
+			std::lock_guard lock(m_mutex);
+			snapshot.sample_count = total_samples();
+			snapshot.sample_counts.clear();
+			for (const Worker &worker : m_workers)
+			{
+				if (worker.color.size() != snapshot.color.size())
+					continue;
+				for (size_t i = 0; i < snapshot.color.size(); i++)
+					snapshot.color[i] += worker.color[i];
+			}
+
+			// Bands progress at their own pace, so every pixel counts the samples of the worker that rendered it
+			if (m_job.split_by_region)
+			{
+				snapshot.sample_counts.assign(static_cast<size_t>(snapshot.width) * snapshot.height, 0.0f);
+				for (const Worker &worker : m_workers)
+				{
+					const size_t begin = static_cast<size_t>(worker.region.y) * snapshot.width;
+					const size_t end = begin + static_cast<size_t>(worker.region.height) * snapshot.width;
+					std::fill(snapshot.sample_counts.begin() + begin, snapshot.sample_counts.begin() + end, static_cast<float>(worker.stats.sample_count));
+				}
+			}
+		}
+
+		const PathTracer::RenderResult &get_render_result() override
+		{
+			get_accumulation(m_merged);
+
+			ResolveInput resolve;
+			resolve.color = m_merged.color.data();
+			resolve.channels = m_merged.channels;
+			resolve.pixel_count = static_cast<size_t>(m_merged.width) * m_merged.height;
+			resolve.scale = m_merged.sample_count > 0 ? 1.0f / static_cast<float>(m_merged.sample_count) : 0.0f;
+			if (!m_merged.sample_counts.empty())
+			{
+				m_averaged.resize(m_merged.color.size());
+				average_samples(m_merged.color.data(), m_merged.channels, m_merged.sample_counts.data(), resolve.pixel_count, m_averaged.data(), m_thread_pool);
+				resolve.color = m_averaged.data();
+				resolve.scale = 1.0f;
+			}
+
+			m_render_result.format = OutputFormat::RGBA8;
+			m_render_result.width = m_merged.width;
+			m_render_result.height = m_merged.height;
+			m_render_result.image_buffer.resize(resolve.pixel_count);
+			resolve_rgba8(resolve, m_render_result.image_buffer.data(), m_thread_pool);
+			return m_render_result;
+		}
+
+	private:
+		struct Worker
+		{
+			DistributedWorkerStats stats;
+			RenderRegion region;	  // Pixels the worker renders
+			std::vector<float> color; // Latest accumulation sums
+		};
+
+		/// Accepts and hands out jobs until worker_count workers are serving, within the job's connect timeout
+		void accept_workers(const DistributedJob &job, uint32_t worker_count)
+		{
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(job.connect_timeout_ms);
+			for (uint32_t i = 0; i < worker_count; i++)
+			{
+				// At least 1 ms once a deadline is set, 0 would wait forever
+				uint32_t timeout_ms = 0;
+				if (job.connect_timeout_ms > 0)
+				{
+					const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+					timeout_ms = static_cast<uint32_t>(std::max<int64_t>(remaining, 1));
+				}
+
+				Socket connection = m_listener.accept(timeout_ms);
+				if (!connection.is_valid())
+					throw std::runtime_error(std::format("Only {} of {} render workers connected to {}", i, worker_count, m_address));
+
+				wire::Hello hello;
+				if (!wire::receive_message(connection, wire::MessageType::Hello, hello) || hello.version != wire::VERSION ||
+					hello.byte_order != wire::BYTE_ORDER_MARK)
+				{
+					Log::error("Rejected render worker with an incompatible protocol");
+					i--;
+					continue;
+				}
+
+				const wire::Job wire_job = make_wire_job(job, i, worker_count);
+				if (!wire::send_message(connection, wire::MessageType::Job, &wire_job, sizeof(wire_job)))
+				{
+					i--;
+					continue;
+				}
+
+				{
+					std::lock_guard lock(m_mutex);
+					m_workers[i].stats.stream_index = i;
+					m_workers[i].stats.connected = true;
+					m_workers[i].region = job.split_by_region ? get_worker_region(job, i, worker_count) : RenderRegion{0, 0, job.width, job.height};
+					m_active_workers++;
+				}
+				Log::info("Render worker {} of {} connected", i + 1, worker_count);
+
+				m_threads.emplace_back([this, i, connection = std::move(connection)]() mutable { serve_worker(i, connection); });
+			}
+		}
+
+		/// Stops the workers that already connected and forgets them, so start() can be called again
+		void abort_start()
+		{
+			m_stop = true;
+			for (std::thread &thread : m_threads)
+				thread.join();
+
+			std::lock_guard lock(m_mutex);
+			m_threads.clear();
+			m_workers.clear();
+			m_active_workers = 0;
+			m_stop = false;
+		}
+
+		/// Request/response loop of one worker: every update is answered with Continue or Stop
+		void serve_worker(uint32_t index, Socket &connection)
+		{
+			const size_t expected_floats = static_cast<size_t>(m_job.width) * m_job.height * accumulation_channel_count(AccumulationLayout::RGB32F);
+			std::vector<float> color;
+
+			while (true)
+			{
+				wire::Header header;
+				wire::Update update;
+				if (!wire::receive_header(connection, header) || header.type != wire::MessageType::Update ||
+					header.payload_size != sizeof(update) + expected_floats * sizeof(float) ||
+					!connection.receive_all(&update, sizeof(update)))
+					break;
+
+				color.resize(expected_floats);
+				if (!connection.receive_all(color.data(), expected_floats * sizeof(float)))
+					break;
+
+				bool done;
+				{
+					std::lock_guard lock(m_mutex);
+					Worker &worker = m_workers[index];
+					worker.color.swap(color);
+					worker.stats.sample_count = update.sample_count;
+					worker.stats.render_seconds = update.render_seconds;
+					worker.stats.samples_per_second = update.render_seconds > 0.0
+														  ? static_cast<double>(update.sample_count) * worker.region.width * worker.region.height / update.render_seconds
+														  : 0.0;
+					done = m_stop || (m_job.target_samples > 0 && total_samples() >= m_job.target_samples);
+				}
+
+				if (done)
+				{
+					wire::send_message(connection, wire::MessageType::Stop);
+					break;
+				}
+				if (!wire::send_message(connection, wire::MessageType::Continue))
+					break;
+			}
+
+			const DistributedWorkerStats stats = get_worker_stats()[index];
+			Log::info("Render worker {} finished: {} spp, {:.2f} Msamples/s", index, stats.sample_count, stats.samples_per_second * 1e-6);
+
+			std::lock_guard lock(m_mutex);
+			m_workers[index].stats.connected = false;
+			m_active_workers--;
+			m_done_cv.notify_all();
+		}
+
+		uint32_t total_samples() const
+		{
+			// A frame split by region is only as far along as its slowest band
+			if (m_job.split_by_region)
+			{
+				uint32_t least = m_workers.empty() ? 0 : UINT32_MAX;
+				for (const Worker &worker : m_workers)
+					least = std::min(least, worker.stats.sample_count);
+				return least;
+			}
+
+			uint32_t total = 0;
+			for (const Worker &worker : m_workers)
+				total += worker.stats.sample_count;
+			return total;
+		}
+
+	private:
+		Socket m_listener;
+		std::string m_address;
+		DistributedJob m_job;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_done_cv;
+		std::vector<Worker> m_workers;
+		std::vector<std::thread> m_threads;
+		uint32_t m_active_workers = 0; // Guarded by m_mutex
+		std::atomic<bool> m_stop{false};
+
+		ThreadPool m_thread_pool;
+		PathTracer::AccumulationSnapshot m_merged;
+		std::vector<float> m_averaged; // Merged sums divided by per-pixel sample counts
+		PathTracer::RenderResult m_render_result;
+	};
+
+	std::unique_ptr<RenderCoordinator> RenderCoordinator::create(const std::string &address)
+	{
+		return std::make_unique<SocketRenderCoordinator>(address);
+	}
+
+} // namespace render
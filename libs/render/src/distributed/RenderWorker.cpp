@@ -0,0 +1,111 @@
+#include "render/Distributed.h"
+
+#include "distributed/Protocol.h"
+#include "distributed/Socket.h"
+
+#include "render/Log.h"
+#include "render/Scene.h"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace render
+{
+	namespace
+	{
+		std::shared_ptr<RenderSettings> make_job_settings(const wire::Job &job)
+		{
+			auto settings = std::make_shared<RenderSettings>();
+			settings->setResolution(job.width, job.height);
+			settings->setSamplerType(static_cast<SamplerType>(job.sampler_type));
+			settings->setMaxBounces(job.max_bounces);
+			settings->setRussianRouletteDepth(job.russian_roulette_depth);
+			// The coordinator merges RGB sums, see RenderCoordinator::get_accumulation
+			settings->setAccumulationLayout(AccumulationLayout::RGB32F);
+			settings->setSampleStream(job.stream_index, job.stream_count);
+			settings->setRenderRegion({job.region_x, job.region_y, job.region_width, job.region_height});
+			return settings;
+		}
+
+		void apply_job_camera(const wire::Job &job, Camera &camera)
+		{
+			camera.lookAt(glm::vec3(job.position[0], job.position[1], job.position[2]),
+						  glm::vec3(job.target[0], job.target[1], job.target[2]),
+						  glm::vec3(job.up[0], job.up[1], job.up[2]));
+			camera.setFieldOfView(job.fov);
+			camera.setAperture(job.aperture);
+			camera.setFocusDistance(job.focus_distance);
+		}
+
+		bool send_update(const Socket &socket, const PathTracer::AccumulationSnapshot &snapshot, double render_seconds)
+		{
+			wire::Update update;
+			update.width = snapshot.width;
+			update.height = snapshot.height;
+			update.channels = snapshot.channels;
+			update.sample_count = snapshot.sample_count;
+			update.render_seconds = render_seconds;
+
+			const uint64_t color_size = snapshot.color.size() * sizeof(float);
+			wire::Header header;
+			header.type = wire::MessageType::Update;
+			header.payload_size = sizeof(update) + color_size;
+			return socket.send_all(&header, sizeof(header)) && socket.send_all(&update, sizeof(update)) &&
+				   socket.send_all(snapshot.color.data(), color_size);
+		}
+	}
+
+	bool run_render_worker(const std::string &address, std::shared_ptr<Scene> scene, const ThreadingConfig &threading)
+	{
+		if (!scene)
+			throw std::runtime_error("Render worker needs a scene");
+
+		Socket socket = Socket::connect(address);
+
+		const wire::Hello hello;
+		wire::Job job;
+		if (!wire::send_message(socket, wire::MessageType::Hello, &hello, sizeof(hello)) ||
+			!wire::receive_message(socket, wire::MessageType::Job, job))
+		{
+			Log::error("Render worker did not receive a job from {}", address);
+			return false;
+		}
+		if (job.region_width > 0 && job.region_height > 0)
+			Log::info("Render worker rendering rows {} to {} at {}x{}", job.region_y, job.region_y + job.region_height, job.width, job.height);
+		else
+			Log::info("Render worker rendering stream {} of {} at {}x{}", job.stream_index, job.stream_count, job.width, job.height);
+
+		apply_job_camera(job, scene->GetCamera());
+
+		auto path_tracer = PathTracer::create_path_tracer(PathTracer::BackendType::CPU_EMBREE, threading);
+		path_tracer->set_settings(make_job_settings(job));
+		path_tracer->set_scene(scene);
+
+		PathTracer::AccumulationSnapshot snapshot;
+		double render_seconds = 0.0;
+
+		while (true)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for (uint32_t pass = 0; pass < job.passes_per_update; pass++)
+				path_tracer->render();
+			render_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			path_tracer->get_accumulation(snapshot);
+			if (!send_update(socket, snapshot, render_seconds))
+				break;
+
+			wire::Header reply;
+			if (!wire::receive_header(socket, reply))
+				break;
+			if (reply.type == wire::MessageType::Stop)
+				return true;
+			if (reply.type != wire::MessageType::Continue)
+				break;
+		}
+
+		Log::error("Render worker lost the connection to {}", address);
+		return false;
+	}
+
+} // namespace render
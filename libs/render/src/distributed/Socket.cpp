@@ -0,0 +1,339 @@
+#include "Socket.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace render
+{
+	namespace
+	{
+#ifdef _WIN32
+		using NativeSocket = SOCKET;
+		using IoSize = int;
+
+		// Winsock needs to be initialized once per process before the first call
+		void ensure_network_initialized()
+		{
+			static const bool initialized = [] {
+				WSADATA data;
+				return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+			}();
+			if (!initialized)
+				throw std::runtime_error("WSAStartup failed");
+		}
+
+		void close_native(NativeSocket socket) { closesocket(socket); }
+		int poll_native(pollfd *fds, unsigned long count, int timeout_ms) { return WSAPoll(fds, count, timeout_ms); }
+		constexpr int SEND_FLAGS = 0;
+#else
+		using NativeSocket = int;
+		using IoSize = size_t;
+
+		void ensure_network_initialized() {}
+		void close_native(NativeSocket socket) { ::close(socket); }
+		int poll_native(pollfd *fds, nfds_t count, int timeout_ms) { return ::poll(fds, count, timeout_ms); }
+#ifdef MSG_NOSIGNAL
+		constexpr int SEND_FLAGS = MSG_NOSIGNAL; // A closed peer must not raise SIGPIPE
+#else
+		constexpr int SEND_FLAGS = 0;
+#endif
+#endif
+
+		// INVALID_SOCKET on Windows is ~0 as well
+		const NativeSocket INVALID_NATIVE = static_cast<NativeSocket>(-1);
+
+		// Large transfers are split so the size always fits the platform's length type
+		constexpr size_t MAX_IO_CHUNK = size_t(1) << 30;
+
+		constexpr std::string_view UNIX_PREFIX = "unix://";
+		constexpr std::string_view TCP_PREFIX = "tcp://";
+
+		struct ParsedAddress
+		{
+			bool unix_domain = false;
+			std::string path; // Unix
+			std::string host; // TCP
+			std::string port; // TCP
+		};
+
+		ParsedAddress parse_address(const std::string &address)
+		{
+			ParsedAddress parsed;
+			if (address.starts_with(UNIX_PREFIX))
+			{
+				parsed.unix_domain = true;
+				parsed.path = address.substr(UNIX_PREFIX.size());
+				if (parsed.path.empty())
+					throw std::runtime_error("Empty unix socket path in address: " + address);
+				return parsed;
+			}
+
+			const std::string endpoint = address.starts_with(TCP_PREFIX) ? address.substr(TCP_PREFIX.size()) : address;
+			const size_t colon = endpoint.rfind(':');
+			if (colon == std::string::npos || colon + 1 == endpoint.size())
+				throw std::runtime_error("Address needs a port: " + address);
+
+			parsed.host = endpoint.substr(0, colon);
+			parsed.port = endpoint.substr(colon + 1);
+			// Bracketed IPv6 literal
+			if (parsed.host.size() >= 2 && parsed.host.front() == '[' && parsed.host.back() == ']')
+				parsed.host = parsed.host.substr(1, parsed.host.size() - 2);
+			return parsed;
+		}
+
+		void configure_stream(NativeSocket socket, bool tcp)
+		{
+#ifdef SO_NOSIGPIPE
+			int one = 1;
+			setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+			if (tcp)
+			{
+				// Control messages are tiny and latency bound
+				int no_delay = 1;
+				setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&no_delay), sizeof(no_delay));
+			}
+		}
+
+#ifndef _WIN32
+		sockaddr_un make_unix_address(const std::string &path)
+		{
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			if (path.size() >= sizeof(address.sun_path))
+				throw std::runtime_error("Unix socket path too long: " + path);
+			std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+			return address;
+		}
+#endif
+
+		/// Returns the connected/bound socket or INVALID for the first usable address of a TCP endpoint
+		NativeSocket open_tcp(const ParsedAddress &parsed, bool listening, int backlog)
+		{
+			addrinfo hints{};
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+			addrinfo *results = nullptr;
+			const char *host = parsed.host.empty() ? nullptr : parsed.host.c_str();
+			if (getaddrinfo(host, parsed.port.c_str(), &hints, &results) != 0)
+				return INVALID_NATIVE;
+
+			NativeSocket result = INVALID_NATIVE;
+			for (addrinfo *info = results; info; info = info->ai_next)
+			{
+				NativeSocket socket = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+				if (socket == INVALID_NATIVE)
+					continue;
+
+				bool ok;
+				if (listening)
+				{
+					int reuse = 1;
+					setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&reuse), sizeof(reuse));
+					ok = ::bind(socket, info->ai_addr, static_cast<int>(info->ai_addrlen)) == 0 && ::listen(socket, backlog) == 0;
+				}
+				else
+				{
+					ok = ::connect(socket, info->ai_addr, static_cast<int>(info->ai_addrlen)) == 0;
+				}
+
+				if (ok)
+				{
+					result = socket;
+					break;
+				}
+				close_native(socket);
+			}
+			freeaddrinfo(results);
+			return result;
+		}
+	}
+
+	Socket::~Socket()
+	{
+		close();
+	}
+
+	Socket::Socket(Socket &&other) noexcept
+		: m_handle(std::exchange(other.m_handle, INVALID_HANDLE)), m_unix_path(std::move(other.m_unix_path))
+	{
+	}
+
+	Socket &Socket::operator=(Socket &&other) noexcept
+	{
+		if (this != &other)
+		{
+			close();
+			m_handle = std::exchange(other.m_handle, INVALID_HANDLE);
+			m_unix_path = std::move(other.m_unix_path);
+		}
+		return *this;
+	}
+
+	void Socket::close()
+	{
+		if (m_handle != INVALID_HANDLE)
+		{
+			close_native(static_cast<NativeSocket>(m_handle));
+			m_handle = INVALID_HANDLE;
+		}
+#ifndef _WIN32
+		if (!m_unix_path.empty())
+		{
+			::unlink(m_unix_path.c_str());
+			m_unix_path.clear();
+		}
+#endif
+	}
+
+	Socket Socket::listen(const std::string &address, int backlog)
+	{
+		ensure_network_initialized();
+		const ParsedAddress parsed = parse_address(address);
+
+		if (parsed.unix_domain)
+		{
+#ifdef _WIN32
+			throw std::runtime_error("Unix domain sockets are not supported on this platform: " + address);
+#else
+			const sockaddr_un unix_address = make_unix_address(parsed.path);
+			const int handle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (handle < 0)
+				throw std::runtime_error("Failed to create socket for " + address);
+
+			// A stale socket file from a previous run would make bind fail
+			::unlink(parsed.path.c_str());
+			if (::bind(handle, reinterpret_cast<const sockaddr *>(&unix_address), sizeof(unix_address)) != 0 || ::listen(handle, backlog) != 0)
+			{
+				::close(handle);
+				throw std::runtime_error("Failed to listen on " + address);
+			}
+
+			Socket socket(handle);
+			socket.m_unix_path = parsed.path;
+			return socket;
+#endif
+		}
+
+		const NativeSocket handle = open_tcp(parsed, true, backlog);
+		if (handle == INVALID_NATIVE)
+			throw std::runtime_error("Failed to listen on " + address);
+		return Socket(static_cast<intptr_t>(handle));
+	}
+
+	Socket Socket::connect(const std::string &address, uint32_t timeout_ms)
+	{
+		ensure_network_initialized();
+		const ParsedAddress parsed = parse_address(address);
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+		while (true)
+		{
+			NativeSocket handle = INVALID_NATIVE;
+			if (parsed.unix_domain)
+			{
+#ifdef _WIN32
+				throw std::runtime_error("Unix domain sockets are not supported on this platform: " + address);
+#else
+				const sockaddr_un unix_address = make_unix_address(parsed.path);
+				handle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+				if (handle >= 0 && ::connect(handle, reinterpret_cast<const sockaddr *>(&unix_address), sizeof(unix_address)) != 0)
+				{
+					::close(handle);
+					handle = INVALID_NATIVE;
+				}
+#endif
+			}
+			else
+			{
+				handle = open_tcp(parsed, false, 0);
+			}
+
+			if (handle != INVALID_NATIVE)
+			{
+				configure_stream(handle, !parsed.unix_domain);
+				return Socket(static_cast<intptr_t>(handle));
+			}
+
+			if (std::chrono::steady_clock::now() >= deadline)
+				throw std::runtime_error("Failed to connect to " + address);
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+	}
+
+	Socket Socket::accept(uint32_t timeout_ms) const
+	{
+		if (timeout_ms > 0)
+		{
+			// A pending connection makes the listening socket readable
+			pollfd listener{};
+			listener.fd = static_cast<NativeSocket>(m_handle);
+			listener.events = POLLIN;
+			const int timeout = static_cast<int>(std::min<uint32_t>(timeout_ms, INT32_MAX));
+			if (poll_native(&listener, 1, timeout) <= 0 || (listener.revents & POLLIN) == 0)
+				return Socket();
+		}
+
+		const NativeSocket handle = ::accept(static_cast<NativeSocket>(m_handle), nullptr, nullptr);
+		if (handle == INVALID_NATIVE)
+			return Socket();
+
+		configure_stream(handle, m_unix_path.empty());
+		return Socket(static_cast<intptr_t>(handle));
+	}
+
+	bool Socket::send_all(const void *data, size_t size) const
+	{
+		const char *bytes = static_cast<const char *>(data);
+		while (size > 0)
+		{
+			const auto chunk = static_cast<IoSize>(std::min(size, MAX_IO_CHUNK));
+			const auto sent = ::send(static_cast<NativeSocket>(m_handle), bytes, chunk, SEND_FLAGS);
+			if (sent <= 0)
+				return false;
+			bytes += sent;
+			size -= static_cast<size_t>(sent);
+		}
+		return true;
+	}
+
+	bool Socket::receive_all(void *data, size_t size) const
+	{
+		char *bytes = static_cast<char *>(data);
+		while (size > 0)
+		{
+			const auto chunk = static_cast<IoSize>(std::min(size, MAX_IO_CHUNK));
+			const auto received = ::recv(static_cast<NativeSocket>(m_handle), bytes, chunk, 0);
+			if (received <= 0)
+				return false;
+			bytes += received;
+			size -= static_cast<size_t>(received);
+		}
+		return true;
+	}
+
+} // namespace render
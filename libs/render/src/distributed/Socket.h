@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace render
+{
+
+	/// Blocking stream socket, move-only
+	/// Addresses are "tcp://host:port" (host may be empty when listening) or "unix:///path/to/socket"
+	class Socket
+	{
+	public:
+		Socket() = default;
+		~Socket();
+
+		Socket(Socket &&other) noexcept;
+		Socket &operator=(Socket &&other) noexcept;
+		Socket(const Socket &) = delete;
+		Socket &operator=(const Socket &) = delete;
+
+		/// Throws std::runtime_error when the address cannot be bound
+		static Socket listen(const std::string &address, int backlog = 64);
+
+		/// Retries until timeout_ms so workers may start before the coordinator, throws on failure
+		static Socket connect(const std::string &address, uint32_t timeout_ms = 10000);
+
+		/// Blocks for the next connection up to timeout_ms (0 = no limit), returns an invalid socket on failure or timeout
+		Socket accept(uint32_t timeout_ms = 0) const;
+
+		// Return false once the connection is closed or broken
+		bool send_all(const void *data, size_t size) const;
+		bool receive_all(void *data, size_t size) const;
+
+		bool is_valid() const { return m_handle != INVALID_HANDLE; }
+		void close();
+
+	private:
+		static constexpr intptr_t INVALID_HANDLE = -1;
+
+		explicit Socket(intptr_t handle) : m_handle(handle) {}
+
+		intptr_t m_handle = INVALID_HANDLE; // int on POSIX, SOCKET on Windows
+		std::string m_unix_path;			// Removed again when a listening unix socket closes
+	};
+
+} // namespace render
@@ -6,12 +6,12 @@
 
 namespace render
 {
-	std::unique_ptr<PathTracer> PathTracer::create_path_tracer(BackendType backend)
+	std::unique_ptr<PathTracer> PathTracer::create_path_tracer(BackendType backend, const ThreadingConfig &threading)
 	{
 		switch (backend)
 		{
 		case BackendType::CPU_EMBREE:
-			return std::make_unique<render::CPUPathTracer>();
+			return std::make_unique<render::CPUPathTracer>(threading);
 		// case BackendType::GPU_OPTIX:
 		// 	return PathTracingEngine::create(BackendType::GPU_OPTIX);
 		// case BackendType::GPU_METAL:
@@ -3,7 +3,11 @@
 #include <algorithm> // For std::clamp
 
 #include <cassert>
+#include <cstring>
+#include <format>
 #include <memory>
+#include <stdexcept>
+#include <string>
 
 #include <ranges>
 
@@ -13,121 +17,642 @@
 #include "render/Color.h"
 
 #include <glm/gtc/constants.hpp>
-#include <iostream>
 
 #include "render/Log.h"
+#include "render/Profiler.h"
 
 #include "render_assert.h"
 
+#include "engines/pathtracer/resolve/Resolve.h"
+#include "utils/Math.h"
+
 namespace render
 {
+	namespace
+	{
+		// AOVs the denoiser uses as edge-stopping features
+		constexpr uint32_t DENOISER_AOV_MASK = aov_bit(AOVType::Albedo) | aov_bit(AOVType::Normal) | aov_bit(AOVType::Depth);
+
+		// AOVs derived at resolve time, they have no accumulation planes
+		constexpr uint32_t RESOLVED_AOV_MASK = aov_bit(AOVType::SampleCount);
+
+		// Max depths that get a kernel with a compile-time bounce bound, slot 0 is the runtime-bounded fallback
+		constexpr uint32_t DEPTH_CLASSES[] = {0, 1, 2, 4, 8, 16};
+		constexpr uint32_t DEPTH_CLASS_COUNT = static_cast<uint32_t>(std::size(DEPTH_CLASSES));
+
+		constexpr uint32_t ROULETTE_POLICY_COUNT = 3;
+
+		// Kernel index = AOVs + 2 * (roulette policy + ROULETTE_POLICY_COUNT * (path guiding + 2 * depth class))
+		constexpr uint32_t RENDER_KERNEL_COUNT = 2 * ROULETTE_POLICY_COUNT * 2 * DEPTH_CLASS_COUNT;
+
+		// Share of guided bounces once a region has a trained distribution, the rest sample the BSDF
+		constexpr float GUIDING_FRACTION = 0.5f;
+
+		// Path vertices whose incident radiance trains the guiding field
+		constexpr uint32_t MAX_GUIDED_VERTICES = 16;
+
+		// Vertices per path or branch that train the efficiency cache, and branches per camera sample
+		constexpr uint32_t MAX_ROULETTE_VERTICES = 16;
+		constexpr uint32_t MAX_PATH_BRANCHES = 32;
+
+		// Keeps relative moments of black pixels finite
+		constexpr float RELATIVE_EPSILON = 1e-2f;
+
+		// Edge of the square tiles a frame is split into, tiles are the unit of work of the render threads
+		constexpr uint32_t TILE_SIZE = 16;
+
+		constexpr TraceFeatures kernel_features(size_t index)
+		{
+			TraceFeatures features;
+			features.aovs = index % 2 != 0;
+			features.russian_roulette = static_cast<RussianRoulettePolicy>(index / 2 % ROULETTE_POLICY_COUNT);
+			features.guiding = index / (2 * ROULETTE_POLICY_COUNT) % 2 != 0;
+			features.max_depth = DEPTH_CLASSES[index / (4 * ROULETTE_POLICY_COUNT)];
+			return features;
+		}
+	}
 
-	CPUPathTracer::CPUPathTracer()
+	CPUPathTracer::CPUPathTracer(const ThreadingConfig &threading)
+		: CPUPathTracer(std::make_shared<SceneAccelerator>(threading))
 	{
-		// Initialize Embree device and setup ray tracing acceleration structures
-		// This will contain the logic currently in EmbreeRenderTarget constructor
+	}
 
-		std::cout << "Initializing CPU Path Tracer with Embree backend..." << std::endl;
+	CPUPathTracer::CPUPathTracer(std::shared_ptr<SceneAccelerator> accelerator)
+		: m_accelerator(std::move(accelerator))
+	{
 		render::Log::info("Initializing CPU Path Tracer with Embree backend...");
 
+		verify(m_accelerator != nullptr, "Scene accelerator not set");
 		m_renderSettings = std::make_shared<RenderSettings>();
-		initialize_embree();
+		m_thread_pool = &m_accelerator->get_thread_pool();
 	}
 
-	CPUPathTracer::~CPUPathTracer()
+	CPUPathTracer::~CPUPathTracer() = default;
+
+	std::unique_ptr<PathTracer> CPUPathTracer::create_view() const
 	{
-		// Cleanup Embree resources
-		// This will contain the logic currently in EmbreeRenderTarget destructor
+		auto view = std::make_unique<CPUPathTracer>(m_accelerator);
+		view->set_settings(std::make_shared<RenderSettings>(*m_renderSettings));
+		view->set_camera(m_camera);
+		return view;
 	}
 
-	void CPUPathTracer::render()
+	const Camera &CPUPathTracer::get_active_camera(const Scene &scene) const
 	{
-		verify(m_embreeDevice && m_embreeScene, "Embree not initialized");
-		verify(m_scene != nullptr, "Scene not set before rendering");
-		invalidate();
+		return m_camera ? *m_camera : scene.GetCamera();
+	}
 
-		// Perform path tracing here using Embree
-		const uint32_t width = m_render_result.width;
-		const uint32_t height = m_render_result.height;
+	template <size_t... Indices>
+	constexpr std::array<CPUPathTracer::RenderKernel, sizeof...(Indices)> CPUPathTracer::make_render_kernels(std::index_sequence<Indices...>)
+	{
+		return {&CPUPathTracer::render_frame<kernel_features(Indices)>...};
+	}
 
-		const float inv_height = 1.0f / height;
-		const float inv_width = 1.0f / width;
+	void CPUPathTracer::render()
+	{
+		RENDER_PROFILE_SCOPE("Render");
+		verify(get_scene() != nullptr, "Scene not set before rendering");
 
+		// Another view may apply scene edits between invalidate() and the frame lock, the frame must not trace them
+		// into an accumulation of the previous scene
+		SceneAccelerator::FrameLock frame;
+		while (true)
+		{
+			invalidate();
+			frame = m_accelerator->lock_frame();
+			if (frame.generation == m_scene_generation)
+				break;
+			frame = {};
+		}
 
-		for (uint32_t y = 0; y < height; y++)
+		static constexpr auto RENDER_KERNELS = make_render_kernels(std::make_index_sequence<RENDER_KERNEL_COUNT>{});
+
+		// Pick the specialization once per frame, the per-path loop has no feature checks left
+		const bool write_aovs = (get_active_aov_mask() & ~RESOLVED_AOV_MASK) != 0;
+		TraceParams params;
+		const uint32_t kernel = select_render_kernel(*m_renderSettings, write_aovs, params);
+		// Learned sampling state starts over with the accumulation, a resumed checkpoint continues untrained
+		const auto get_scene_bounds = [&](glm::vec3 &bounds_min, glm::vec3 &bounds_max) {
+			RTCBounds bounds;
+			rtcGetSceneBounds(frame.scene->scene, &bounds);
+			bounds_min = glm::vec3(bounds.lower_x, bounds.lower_y, bounds.lower_z);
+			bounds_max = glm::vec3(bounds.upper_x, bounds.upper_y, bounds.upper_z);
+			// Empty scenes report inverted bounds, their paths never record anything
+			if (bounds_min.x > bounds_max.x || bounds_min.y > bounds_max.y || bounds_min.z > bounds_max.z)
+			{
+				bounds_min = glm::vec3(0.0f);
+				bounds_max = glm::vec3(1.0f);
+			}
+		};
+		glm::vec3 bounds_min;
+		glm::vec3 bounds_max;
+		if (m_renderSettings->getPathGuiding())
 		{
-			for (uint32_t x = 0; x < width; x++)
+			if (m_frameCount == 0 || !m_guiding.is_initialized())
 			{
-				uint32_t rng_state = get_rng_state(width, height, x, y, m_frameCount + 1);
-				glm::vec3 ray_origin(0.0f, 0.0f, 0.0f);
+				get_scene_bounds(bounds_min, bounds_max);
+				m_guiding.reset(bounds_min, bounds_max);
+			}
+			params.train_guiding = m_guiding.is_training();
+		}
+		const bool efficiency_roulette = m_renderSettings->getRouletteMode() == RouletteMode::Efficiency;
+		if (efficiency_roulette && (m_frameCount == 0 || !m_efficiency.is_initialized()))
+		{
+			get_scene_bounds(bounds_min, bounds_max);
+			m_efficiency.reset(bounds_min, bounds_max);
+		}
+		if (m_frameCount == 0)
+		{
+			m_last_checkpoint = std::chrono::steady_clock::now();
+			m_last_image_output = m_last_checkpoint;
+		}
+
+		// Pixels outside a render region keep their samples, from then on every pixel counts its own
+		const RenderRegion region = m_renderSettings->getEffectiveRenderRegion();
+		auto &sample_counts = aov_planes(AOVType::SampleCount);
+		if ((region.width != m_render_result.width || region.height != m_render_result.height) && sample_counts.empty())
+			sample_counts.assign(static_cast<size_t>(m_render_result.width) * m_render_result.height, static_cast<float>(m_frameCount));
+
+		{
+			RENDER_PROFILE_SCOPE("Trace frame");
+			m_frame_scene = frame.scene.get();
+			(this->*RENDER_KERNELS[kernel])(params);
+			m_frame_scene = nullptr;
+			frame = {};
+		}
+
+		if (m_renderSettings->getPathGuiding())
+			m_guiding.finish_frame();
+		if (efficiency_roulette)
+			m_efficiency.finish_frame();
+
+		m_frameCount++;
+		update_checkpoint();
+		update_image_output();
+	}
+
+	uint32_t CPUPathTracer::select_render_kernel(const RenderSettings &settings, bool write_aovs, TraceParams &params)
+	{
+		params.max_bounces = std::max(settings.getMaxBounces(), 1u);
+		params.russian_roulette_depth = settings.getRussianRouletteDepth();
 
-				// Fast ray direction calculation
-				const float aspect_ratio = (float)width / (float)height;
+		uint32_t depth_class = 0;
+		for (uint32_t i = 1; i < DEPTH_CLASS_COUNT; i++)
+		{
+			if (DEPTH_CLASSES[i] == params.max_bounces)
+				depth_class = i;
+		}
 
-				float u = x * inv_width;
-				float v = 1.0f - y * inv_height;
-				float uv_x = (u * 2.0f - 1.0f) * aspect_ratio;
-				float uv_y = v * 2.0f - 1.0f;
+		// Throughput roulette that can never trigger before the depth limit is compiled out, splitting can
+		RussianRoulettePolicy roulette = RussianRoulettePolicy::Off;
+		if (settings.getRouletteMode() == RouletteMode::Efficiency)
+			roulette = RussianRoulettePolicy::Efficiency;
+		else if (params.russian_roulette_depth < params.max_bounces)
+			roulette = RussianRoulettePolicy::MaxThroughput;
 
-				float len = sqrtf(uv_x * uv_x + uv_y * uv_y + 1.0f);
-				glm::vec3 ray_direction(uv_x / len, uv_y / len, 1.0f / len);
+		const uint32_t guiding = settings.getPathGuiding() ? 1u : 0u;
+		return (write_aovs ? 1u : 0u) + 2 * (static_cast<uint32_t>(roulette) + ROULETTE_POLICY_COUNT * (guiding + 2 * depth_class));
+	}
 
-				glm::vec4 color = trace_ray(ray_origin, ray_direction, rng_state);
+	template <TraceFeatures Features>
+	void CPUPathTracer::render_frame(const TraceParams &params)
+	{
+		const uint32_t width = m_render_result.width;
+		const RenderRegion region = m_renderSettings->getEffectiveRenderRegion();
+
+		const bool thin_lens = m_primary_rays.is_thin_lens();
+
+		// Position of a pixel's next sample in the (possibly shared) sample sequence
+		const uint32_t stream_count = m_renderSettings->getSampleStreamCount();
+		const uint32_t stream_index = m_renderSettings->getSampleStreamIndex();
+		float *const sample_counts = aov_planes(AOVType::SampleCount).empty() ? nullptr : aov_planes(AOVType::SampleCount).data();
+
+		// Tiles of the region on the full-frame tile grid, so a tile row is still rendered by the domain that touched its pages first
+		const uint32_t tile_x0 = region.x / TILE_SIZE;
+		const uint32_t tile_y0 = region.y / TILE_SIZE;
+		const uint32_t tile_y1 = (region.y + region.height + TILE_SIZE - 1) / TILE_SIZE;
+		const uint32_t tiles_x = (region.x + region.width + TILE_SIZE - 1) / TILE_SIZE - tile_x0;
+
+		// Each domain renders the tile rows whose accumulation pages it touched first, see clear_accumulation()
+		std::vector<uint32_t> tile_offsets(m_tile_row_offsets.size());
+		for (size_t d = 0; d < tile_offsets.size(); d++)
+			tile_offsets[d] = (std::clamp(m_tile_row_offsets[d], tile_y0, tile_y1) - tile_y0) * tiles_x;
+
+		m_thread_pool->parallel_for_domains(tile_offsets, 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t tile = begin; tile < end; tile++)
+			{
+				RENDER_PROFILE_SCOPE("Trace tile");
+				const uint32_t tile_x = (tile_x0 + tile % tiles_x) * TILE_SIZE;
+				const uint32_t tile_y = (tile_y0 + tile / tiles_x) * TILE_SIZE;
+				const uint32_t x0 = std::max(tile_x, region.x);
+				const uint32_t y0 = std::max(tile_y, region.y);
+				const uint32_t x1 = std::min(tile_x + TILE_SIZE, region.x + region.width);
+				const uint32_t y1 = std::min(tile_y + TILE_SIZE, region.y + region.height);
+
+				// Summed per tile, one atomic update of the efficiency cache per tile
+				[[maybe_unused]] float tile_variance = 0.0f;
+				[[maybe_unused]] uint32_t tile_rays = 0;
+				[[maybe_unused]] uint32_t tile_paths = 0;
+
+				for (uint32_t y = y0; y < y1; y++)
+				{
+					for (uint32_t x = x0; x < x1; x++)
+					{
+						const size_t pixel_index = static_cast<size_t>(y) * width + x;
+						const uint32_t pixel_samples = sample_counts ? static_cast<uint32_t>(sample_counts[pixel_index]) : m_frameCount;
+						const uint32_t sample_index = pixel_samples * stream_count + stream_index;
+
+						SamplerState sampler_state;
+						m_sampler->start_pixel_sample(sampler_state, x, y, sample_index);
+
+						glm::vec3 ray_origin;
+						glm::vec3 ray_direction;
+						if (thin_lens)
+						{
+							Sampler::set_dimension(sampler_state, SampleDimension::CAMERA_LENS);
+							m_primary_rays.generate(pixel_index, m_sampler->get_2d(sampler_state), ray_origin, ray_direction);
+						}
+						else
+						{
+							m_primary_rays.generate(pixel_index, ray_origin, ray_direction);
+						}
+
+						float *pixel = &m_accumulation_buffer[m_accumulation_channels * pixel_index];
+
+						PathAOVs path_aovs;
+						PathSample sample;
+						if constexpr (Features.russian_roulette == RussianRoulettePolicy::Efficiency)
+						{
+							if (pixel_samples > 0)
+								sample.pixel_estimate = (pixel[0] + pixel[1] + pixel[2]) / (3.0f * static_cast<float>(pixel_samples));
+						}
+						glm::vec4 color = trace_ray<Features>(ray_origin, ray_direction, sampler_state, path_aovs, params, sample);
+
+						if constexpr (Features.russian_roulette == RussianRoulettePolicy::Efficiency)
+						{
+							if (sample.pixel_estimate > 0.0f)
+							{
+								const float error = (color.r + color.g + color.b) / 3.0f - sample.pixel_estimate;
+								tile_variance += error * error / (sample.pixel_estimate * sample.pixel_estimate + RELATIVE_EPSILON);
+								tile_rays += sample.rays;
+								tile_paths++;
+							}
+						}
+
+						pixel[0] += color.r;
+						pixel[1] += color.g;
+						pixel[2] += color.b;
+						if (m_accumulation_channels == 4)
+							pixel[3] += color.a;
+						if (sample_counts)
+							sample_counts[pixel_index] += 1.0f;
+
+						if constexpr (Features.aovs)
+						{
+							accumulate_aovs(pixel_index, path_aovs);
+						}
+					}
+				}
 
-				m_accumulation_buffer[4 * (y * width + x) + 0] += color.r;
-				m_accumulation_buffer[4 * (y * width + x) + 1] += color.g;
-				m_accumulation_buffer[4 * (y * width + x) + 2] += color.b;
-				m_accumulation_buffer[4 * (y * width + x) + 3] += color.a;
+				if constexpr (Features.russian_roulette == RussianRoulettePolicy::Efficiency)
+				{
+					if (tile_paths > 0)
+						m_efficiency.record_paths(tile_variance, static_cast<float>(tile_rays), tile_paths);
+				}
 			}
+		});
+	}
+
+	void CPUPathTracer::accumulate_aovs(size_t pixel_index, const PathAOVs &path_aovs)
+	{
+		const size_t pixel_count = static_cast<size_t>(m_render_result.width) * m_render_result.height;
+
+		if (auto &albedo = aov_planes(AOVType::Albedo); !albedo.empty())
+		{
+			albedo[0 * pixel_count + pixel_index] += path_aovs.albedo.r;
+			albedo[1 * pixel_count + pixel_index] += path_aovs.albedo.g;
+			albedo[2 * pixel_count + pixel_index] += path_aovs.albedo.b;
 		}
+		if (auto &normal = aov_planes(AOVType::Normal); !normal.empty())
+		{
+			normal[0 * pixel_count + pixel_index] += path_aovs.normal.x;
+			normal[1 * pixel_count + pixel_index] += path_aovs.normal.y;
+			normal[2 * pixel_count + pixel_index] += path_aovs.normal.z;
+		}
+		if (auto &depth = aov_planes(AOVType::Depth); !depth.empty())
+		{
+			depth[pixel_index] += path_aovs.depth;
+		}
+		if (auto &node_id = aov_planes(AOVType::NodeID); !node_id.empty())
+		{
+			// IDs are exact in float up to 2^24 and are overwritten, never averaged
+			node_id[pixel_index] = static_cast<float>(path_aovs.node_id);
+		}
+	}
 
-		m_frameCount++;
+	uint32_t CPUPathTracer::get_active_aov_mask() const
+	{
+		return m_renderSettings->getAOVMask() | (m_renderSettings->getDenoise() ? DENOISER_AOV_MASK : 0u);
 	}
 
 	const PathTracer::RenderResult &CPUPathTracer::get_render_result()
 	{
 		assert(m_frameCount > 0 && "No frames rendered yet");
-		// Convert accumulation buffer to 8-bit RGBA for output
-		for (uint32_t y = 0; y < m_render_result.height; y++)
+		RENDER_PROFILE_SCOPE("Resolve");
+
+		ResolveInput resolve;
+		resolve.color = m_accumulation_buffer.data();
+		resolve.channels = m_accumulation_channels;
+		resolve.pixel_count = static_cast<size_t>(m_render_result.width) * m_render_result.height;
+		resolve.scale = 1.0f / (float)m_frameCount;
+
+		DenoiserInput input;
+		input.color = m_accumulation_buffer.data();
+		input.color_channels = m_accumulation_channels;
+		input.albedo = aov_planes(AOVType::Albedo).data();
+		input.normal = aov_planes(AOVType::Normal).data();
+		input.depth = aov_planes(AOVType::Depth).data();
+		input.sample_scale = resolve.scale;
+
+		// Sample counts that differ per pixel are averaged up front, everything after sees a uniform scale of 1
+		if (const float *sample_counts = get_pixel_sample_counts())
 		{
-			for (uint32_t x = 0; x < m_render_result.width; x++)
+			const size_t pixel_count = resolve.pixel_count;
+			const bool denoise = m_renderSettings->getDenoise();
+			m_averaged_buffer.resize(pixel_count * (m_accumulation_channels + (denoise ? 7 : 0)));
+
+			float *averaged = m_averaged_buffer.data();
+			average_samples(m_accumulation_buffer.data(), m_accumulation_channels, sample_counts, pixel_count, averaged, *m_thread_pool);
+			resolve.color = input.color = averaged;
+			resolve.scale = input.sample_scale = 1.0f;
+
+			if (denoise)
 			{
-				uint32_t idx = y * m_render_result.width + x;
-				float r = m_accumulation_buffer[4 * idx + 0] / (float)m_frameCount;
-				float g = m_accumulation_buffer[4 * idx + 1] / (float)m_frameCount;
-				float b = m_accumulation_buffer[4 * idx + 2] / (float)m_frameCount;
-				float a = m_accumulation_buffer[4 * idx + 3] / (float)m_frameCount;
-
-				// Apply exposure
-				// r *= m_renderSettings->getExposure();
-				// g *= m_renderSettings->getExposure();
-				// b *= m_renderSettings->getExposure();
-
-				// Clamp to [0,1]
-				r = std::clamp(r, 0.0f, 1.0f);
-				g = std::clamp(g, 0.0f, 1.0f);
-				b = std::clamp(b, 0.0f, 1.0f);
-				a = std::clamp(a, 0.0f, 1.0f);
-
-				m_render_result.image_buffer[idx] = rgba_to_uint32((uint8_t)(r * 255.0f), (uint8_t)(g * 255.0f), (uint8_t)(b * 255.0f), (uint8_t)(a * 255.0f));
+				float *features = averaged + pixel_count * m_accumulation_channels;
+				const auto average_planes = [&](AOVType type, const float *&plane) {
+					for (uint32_t c = 0; c < aov_channel_count(type); c++)
+						average_samples(aov_planes(type).data() + c * pixel_count, 1, sample_counts, pixel_count, features + c * pixel_count, *m_thread_pool);
+					plane = features;
+					features += aov_channel_count(type) * pixel_count;
+				};
+				average_planes(AOVType::Albedo, input.albedo);
+				average_planes(AOVType::Normal, input.normal);
+				average_planes(AOVType::Depth, input.depth);
 			}
 		}
+		else
+		{
+			m_averaged_buffer = {};
+		}
+
+		if (m_renderSettings->getDenoise())
+		{
+			RENDER_PROFILE_SCOPE("Denoise");
+			m_denoised_buffer.resize(resolve.pixel_count * 4);
+			m_denoiser.denoise(input, m_render_result.width, m_render_result.height, DenoiserSettings{}, *m_thread_pool, m_denoised_buffer.data());
+
+			resolve.color = m_denoised_buffer.data();
+			resolve.channels = 4;
+			resolve.scale = 1.0f;
+		}
+
+		resolve.exposure = m_renderSettings->getAutoExposure()
+							   ? compute_auto_exposure(resolve, m_renderSettings->getTargetLuminance(), *m_thread_pool)
+							   : m_renderSettings->getExposure();
+
+		// Only the requested output is kept, the other one is released
+		m_render_result.format = m_renderSettings->getOutputFormat();
+		if (m_render_result.format == OutputFormat::RGBA16F)
+		{
+			m_render_result.image_buffer = {};
+			m_render_result.hdr_buffer.resize(resolve.pixel_count * 4);
+			resolve_rgba16f(resolve, m_render_result.hdr_buffer.data(), *m_thread_pool);
+		}
+		else
+		{
+			m_render_result.hdr_buffer = {};
+			m_render_result.image_buffer.resize(resolve.pixel_count);
+			resolve_rgba8(resolve, m_render_result.image_buffer.data(), *m_thread_pool);
+		}
 
 		return m_render_result;
 	}
 
+	void CPUPathTracer::get_accumulation(AccumulationSnapshot &snapshot) const
+	{
+		snapshot.width = m_render_result.width;
+		snapshot.height = m_render_result.height;
+		snapshot.channels = m_accumulation_channels;
+		snapshot.sample_count = m_frameCount;
+		snapshot.color.assign(m_accumulation_buffer.begin(), m_accumulation_buffer.end());
+		snapshot.sample_counts = m_aov_planes[static_cast<uint32_t>(AOVType::SampleCount)];
+	}
+
+	const float *CPUPathTracer::get_pixel_sample_counts() const
+	{
+		const std::vector<float> &sample_counts = m_aov_planes[static_cast<uint32_t>(AOVType::SampleCount)];
+		return sample_counts.empty() ? nullptr : sample_counts.data();
+	}
+
+	void CPUPathTracer::capture_checkpoint(CheckpointData &data) const
+	{
+		RENDER_PROFILE_SCOPE("Capture checkpoint");
+		data.width = m_render_result.width;
+		data.height = m_render_result.height;
+		data.channels = m_accumulation_channels;
+		data.frame_count = m_frameCount;
+		data.sampler_type = m_renderSettings->getSamplerType();
+		data.sample_stream_index = m_renderSettings->getSampleStreamIndex();
+		data.sample_stream_count = m_renderSettings->getSampleStreamCount();
+		const std::shared_ptr<Scene> scene = get_scene();
+		data.scene_hash = compute_scene_hash(*scene, get_active_camera(*scene), *m_renderSettings);
+		data.color.assign(m_accumulation_buffer.begin(), m_accumulation_buffer.end());
+		data.aov_planes = m_aov_planes;
+	}
+
+	void CPUPathTracer::update_checkpoint()
+	{
+		const std::string &path = m_renderSettings->getCheckpointPath();
+		if (path.empty())
+			return;
+
+		const auto now = std::chrono::steady_clock::now();
+		if (std::chrono::duration<float>(now - m_last_checkpoint).count() < m_renderSettings->getCheckpointInterval())
+			return;
+
+		// The copy is the only cost on the render thread, a checkpoint still being written delays the next one
+		if (m_checkpoint_writer.is_busy())
+			return;
+
+		CheckpointData data;
+		capture_checkpoint(data);
+		m_checkpoint_writer.submit(path, std::move(data));
+		m_last_checkpoint = now;
+	}
+
+	void CPUPathTracer::save_checkpoint(const std::string &path)
+	{
+		verify(get_scene() != nullptr, "Scene not set before saving a checkpoint");
+
+		CheckpointData data;
+		capture_checkpoint(data);
+		m_checkpoint_writer.submit(path, std::move(data));
+	}
+
+	void CPUPathTracer::capture_image(const ImageOutputOptions &options, ImageSnapshot &snapshot) const
+	{
+		RENDER_PROFILE_SCOPE("Capture image");
+		snapshot.width = m_render_result.width;
+		snapshot.height = m_render_result.height;
+		snapshot.channels = m_accumulation_channels;
+		snapshot.sample_count = m_frameCount;
+		// assign() reuses the capacity of recycled snapshots, this copy is all the render thread pays
+		snapshot.color.assign(m_accumulation_buffer.begin(), m_accumulation_buffer.end());
+		for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+		{
+			// Per-pixel sample counts are needed to average the image even when they are not written
+			if ((options.aov_mask & aov_bit(static_cast<AOVType>(i))) || static_cast<AOVType>(i) == AOVType::SampleCount)
+				snapshot.aov_planes[i].assign(m_aov_planes[i].begin(), m_aov_planes[i].end());
+			else
+				snapshot.aov_planes[i].clear();
+		}
+	}
+
+	void CPUPathTracer::update_image_output()
+	{
+		const std::string &path = m_renderSettings->getImageOutputPath();
+		if (path.empty())
+			return;
+
+		const auto now = std::chrono::steady_clock::now();
+		if (std::chrono::duration<float>(now - m_last_image_output).count() < m_renderSettings->getImageOutputInterval())
+			return;
+
+		// Disk slower than the interval drops images instead of stalling the render loop
+		if (m_image_writer.is_full())
+			return;
+
+		write_image(path, m_renderSettings->getImageOutputOptions());
+		m_last_image_output = now;
+	}
+
+	void CPUPathTracer::write_image(const std::string &path, const ImageOutputOptions &options)
+	{
+		ImageSnapshot snapshot = m_image_writer.acquire_snapshot();
+		capture_image(options, snapshot);
+		m_image_writer.submit(path, options, std::move(snapshot));
+	}
+
+	bool CPUPathTracer::resume_from_checkpoint(const std::string &path)
+	{
+		const std::shared_ptr<Scene> scene = get_scene();
+		verify(scene != nullptr, "Scene not set before resuming a checkpoint");
+
+		CheckpointData data;
+		if (!read_checkpoint(path, data))
+			return false;
+
+		// Apply pending scene and settings changes first so they do not reset the restored state
+		invalidate();
+
+		if (data.scene_hash != compute_scene_hash(*scene, get_active_camera(*scene), *m_renderSettings) || data.width != m_render_result.width ||
+			data.height != m_render_result.height || data.channels != m_accumulation_channels ||
+			data.color.size() != m_accumulation_buffer.size())
+		{
+			render::Log::error("Checkpoint {} was rendered with a different scene or settings", path);
+			return false;
+		}
+
+		// Every AOV accumulated from now on needs the sums of the previous samples as well
+		const std::vector<float> &sample_counts = data.aov_planes[static_cast<uint32_t>(AOVType::SampleCount)];
+		if (!sample_counts.empty() && sample_counts.size() != static_cast<size_t>(data.width) * data.height)
+		{
+			render::Log::error("Checkpoint {} has malformed sample counts", path);
+			return false;
+		}
+		for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+		{
+			if (static_cast<AOVType>(i) == AOVType::SampleCount)
+				continue; // Replaced by the checkpoint's own counts below
+			if (!m_aov_planes[i].empty() && data.aov_planes[i].size() != m_aov_planes[i].size())
+			{
+				render::Log::error("Checkpoint {} does not contain the enabled AOV {}", path, i);
+				return false;
+			}
+		}
+
+		std::ranges::copy(data.color, m_accumulation_buffer.begin());
+		// Sample counts are present when the checkpointed render used a region, see get_pixel_sample_counts()
+		aov_planes(AOVType::SampleCount) = std::move(data.aov_planes[static_cast<uint32_t>(AOVType::SampleCount)]);
+		for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+		{
+			if (!m_aov_planes[i].empty() && static_cast<AOVType>(i) != AOVType::SampleCount)
+				m_aov_planes[i] = std::move(data.aov_planes[i]);
+		}
+		m_frameCount = data.frame_count;
+		m_outputDirty = true;
+		m_last_checkpoint = std::chrono::steady_clock::now();
+
+		render::Log::info("Resumed {} at {} samples per pixel", path, m_frameCount);
+		return true;
+	}
+
+	const PathTracer::AOVBuffer *CPUPathTracer::get_aov(AOVType type)
+	{
+		const bool resolved = (aov_bit(type) & RESOLVED_AOV_MASK) != 0;
+		const auto &planes = aov_planes(type);
+		if (!m_renderSettings->getAOVEnabled(type) || m_frameCount == 0 || (!resolved && planes.empty()))
+			return nullptr;
+
+		const size_t pixel_count = static_cast<size_t>(m_render_result.width) * m_render_result.height;
+
+		PathTracer::AOVBuffer &result = m_aov_results[static_cast<uint32_t>(type)];
+		result.type = type;
+		result.channels = aov_channel_count(type);
+		result.width = m_render_result.width;
+		result.height = m_render_result.height;
+		result.planes.resize(pixel_count * result.channels);
+
+		const float *sample_counts = get_pixel_sample_counts();
+		switch (type)
+		{
+		case AOVType::SampleCount:
+			if (sample_counts)
+				std::copy(sample_counts, sample_counts + pixel_count, result.planes.begin());
+			else
+				std::ranges::fill(result.planes, static_cast<float>(m_frameCount));
+			break;
+		case AOVType::NodeID:
+			std::ranges::copy(planes, result.planes.begin());
+			break;
+		default:
+		{
+			if (sample_counts)
+			{
+				for (uint32_t c = 0; c < result.channels; c++)
+					average_samples(planes.data() + c * pixel_count, 1, sample_counts, pixel_count, result.planes.data() + c * pixel_count, *m_thread_pool);
+				break;
+			}
+			const float scale = 1.0f / static_cast<float>(m_frameCount);
+			std::ranges::transform(planes, result.planes.begin(), [scale](float sum) { return sum * scale; });
+			break;
+		}
+		}
+
+		return &result;
+	}
+
 	void CPUPathTracer::invalidate()
 	{
-		bool needs_rebuild = false;
-		if (m_scene->hasChanges())
+		RENDER_PROFILE_SCOPE("Invalidate");
+		// Scene edits of any view restart the accumulation of every view
+		apply_build_profile();
+		const uint64_t scene_generation = m_accelerator->synchronize();
+		if (scene_generation != m_scene_generation)
 		{
-			// TODO: update embree
-			//  bitmask for different changes, some require embree rebuild some dont
+			m_scene_generation = scene_generation;
 			m_frameCount = 0;
 			m_outputDirty = true;
-
-			// temporary - always rebuild for now
-			needs_rebuild = true;
 		}
 		if (m_renderSettings->isDirty())
 		{
@@ -137,79 +662,246 @@ namespace render
 			m_renderSettings->clearDirty();
 		}
 
-		if (m_render_result.width != m_renderSettings->getWidth() || m_render_result.height != m_renderSettings->getHeight())
+		if (!m_sampler || m_sampler->get_type() != m_renderSettings->getSamplerType())
+		{
+			m_sampler = Sampler::create(m_renderSettings->getSamplerType());
+			m_frameCount = 0;
+		}
+
+		const uint32_t accumulation_channels = accumulation_channel_count(m_renderSettings->getAccumulationLayout());
+		if (m_render_result.width != m_renderSettings->getWidth() || m_render_result.height != m_renderSettings->getHeight() ||
+			m_accumulation_channels != accumulation_channels || m_memory_placement != m_renderSettings->getMemoryPlacement() ||
+			m_accumulation_buffer.empty())
 		{
 			m_render_result.width = m_renderSettings->getWidth();
 			m_render_result.height = m_renderSettings->getHeight();
-			m_accumulation_buffer.resize(m_render_result.width * m_render_result.height * 4);
-			m_render_result.image_buffer.resize(m_render_result.width * m_render_result.height);
-			std::ranges::fill(m_accumulation_buffer, 0.0f);
+			m_accumulation_channels = accumulation_channels;
+			m_memory_placement = m_renderSettings->getMemoryPlacement();
+			allocate_accumulation();
 			m_frameCount = 0;
 			m_outputDirty = true;
 		}
 
-		if (m_frameCount == 0)
+		// Primary rays are cached per resolution and camera state, a camera change restarts accumulation
+		if (m_primary_rays.update(get_active_camera(*get_scene()), m_render_result.width, m_render_result.height, *m_thread_pool))
 		{
-			std::ranges::fill(m_accumulation_buffer, 0.0f);
+			m_frameCount = 0;
+			m_outputDirty = true;
+		}
+
+		// AOV planes only exist while requested, either by the user or by the denoiser
+		const uint32_t aov_mask = get_active_aov_mask();
+		const size_t pixel_count = static_cast<size_t>(m_render_result.width) * m_render_result.height;
+		for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+		{
+			const AOVType type = static_cast<AOVType>(i);
+			if (type == AOVType::SampleCount)
+				continue; // Owned by render regions, see render()
+			const bool allocate = (aov_mask & aov_bit(type) & ~RESOLVED_AOV_MASK) != 0;
+			const size_t size = allocate ? pixel_count * aov_channel_count(type) : 0;
+			if (size == 0 && !m_aov_planes[i].empty())
+			{
+				m_aov_planes[i] = {};
+				m_aov_results[i].planes = {};
+			}
+			else if (m_aov_planes[i].size() != size)
+			{
+				m_aov_planes[i].resize(size);
+				m_frameCount = 0;
+			}
+		}
+		if (!m_renderSettings->getDenoise())
+		{
+			m_denoised_buffer = {};
 		}
 
-		if (needs_rebuild)
+		if (m_frameCount == 0)
 		{
-			rebuild_scene();
-			m_scene->markChangesProcessed();
+			clear_accumulation();
+			// Every pixel starts from zero samples, counts are only tracked again once a region renders
+			aov_planes(AOVType::SampleCount) = {};
+			for (auto &planes : m_aov_planes)
+				std::ranges::fill(planes, 0.0f);
 		}
+
 	}
 
-	// TODO: error handling
-	bool CPUPathTracer::initialize_embree()
+	void CPUPathTracer::allocate_accumulation()
 	{
-		assert(!m_embreeDevice && "Embree device already initialized");
-		m_embreeDevice = rtcNewDevice("verbose=1,threads=0");
-		assert(m_embreeDevice && "Failed to create Embree device");
-
-		assert(!m_embreeScene && "Embree scene already initialized");
-		m_embreeScene = rtcNewScene(m_embreeDevice);
-		assert(m_embreeScene && "Failed to create Embree scene");
+		// Pages stay uncommitted until clear_accumulation() writes them, which decides their NUMA domain
+		m_accumulation_buffer.allocate(static_cast<size_t>(m_render_result.width) * m_render_result.height * m_accumulation_channels);
 
+		const uint32_t tile_rows = (m_render_result.height + TILE_SIZE - 1) / TILE_SIZE;
+		m_tile_row_offsets = m_thread_pool->get_domain_offsets(tile_rows);
+	}
 
-		// embree_geometry_id = rtcAttachGeometry(scene, sphere_geometry);
+	void CPUPathTracer::clear_accumulation()
+	{
+		float *const buffer = m_accumulation_buffer.data();
+		const size_t row_floats = static_cast<size_t>(m_render_result.width) * m_accumulation_channels;
+		const size_t size = m_accumulation_buffer.size();
 
-		rtcCommitScene(m_embreeScene);
+		switch (m_memory_placement)
+		{
+		case MemoryPlacement::FirstTouch:
+			// Same tile row bands as render_frame(), so every thread accumulates into memory of its own domain.
+			// No stealing, a domain done early must not touch another domain's pages first
+			m_thread_pool->parallel_for_domains(
+				m_tile_row_offsets, 1,
+				[&](uint32_t begin, uint32_t end) {
+					const size_t first = std::min(static_cast<size_t>(begin) * TILE_SIZE * row_floats, size);
+					const size_t last = std::min(static_cast<size_t>(end) * TILE_SIZE * row_floats, size);
+					std::fill(buffer + first, buffer + last, 0.0f);
+				},
+				false);
+			break;
+		case MemoryPlacement::Interleaved:
+		{
+			// Page p is written by domain p % D, each domain's band lists its pages in order
+			constexpr size_t PAGE_FLOATS = PageBuffer<float>::PAGE_SIZE / sizeof(float);
+			const uint32_t domain_count = m_thread_pool->get_domain_count();
+			const uint32_t page_count = static_cast<uint32_t>((size + PAGE_FLOATS - 1) / PAGE_FLOATS);
+
+			std::vector<uint32_t> offsets(domain_count + 1, 0);
+			for (uint32_t d = 0; d < domain_count; d++)
+				offsets[d + 1] = offsets[d] + (page_count > d ? (page_count - d + domain_count - 1) / domain_count : 0);
+
+			m_thread_pool->parallel_for_domains(
+				offsets, 16,
+				[&](uint32_t begin, uint32_t end) {
+					// Chunks never straddle bands
+					const uint32_t domain = static_cast<uint32_t>(std::ranges::upper_bound(offsets, begin) - offsets.begin()) - 1;
+					for (uint32_t i = begin; i < end; i++)
+					{
+						const size_t page = static_cast<size_t>(i - offsets[domain]) * domain_count + domain;
+						const size_t first = page * PAGE_FLOATS;
+						std::fill(buffer + first, buffer + std::min(first + PAGE_FLOATS, size), 0.0f);
+					}
+				},
+				false);
+			break;
+		}
+		case MemoryPlacement::SingleThread:
+			std::ranges::fill(m_accumulation_buffer, 0.0f);
+			break;
+		}
+	}
 
-		return m_embreeDevice != nullptr && m_embreeScene != nullptr;
+	void CPUPathTracer::update_scene_async()
+	{
+		// The accumulation stays valid until the next render(), so the current frame can still be resolved and written
+		apply_build_profile();
+		m_accelerator->synchronize_async();
 	}
 
-	void CPUPathTracer::cleanup_embree()
+	void CPUPathTracer::apply_build_profile()
 	{
-		assert(m_embreeDevice && "Embree device not initialized");
-		rtcReleaseDevice(m_embreeDevice);
-		m_embreeDevice = nullptr;
-		assert(m_embreeScene && "Embree scene not initialized");
-		rtcReleaseScene(m_embreeScene);
-		m_embreeScene = nullptr;
+		// The profile is shared by every view, a view only sets it when its own setting changes,
+		// so views with different profiles do not rebuild the scene on every alternating render
+		const BuildProfile build_profile = m_renderSettings->getBuildProfile();
+		if (build_profile == m_build_profile)
+			return;
+		m_build_profile = build_profile;
+		m_accelerator->set_build_profile(build_profile);
 	}
-	
-	uint32_t CPUPathTracer::get_rng_state(uint32_t width, uint32_t height, uint32_t x, uint32_t y, uint32_t frame) const
+
+	template <TraceFeatures Features>
+	glm::vec4 CPUPathTracer::trace_ray(const glm::vec3 &ray_origin, const glm::vec3 &ray_direction, SamplerState &sampler_state, PathAOVs &aovs,
+									   const TraceParams &params, PathSample &sample) const
 	{
-			return x + y * width + frame * 982451653U; // Large prime for better distribution
+		PathVertex camera;
+		camera.position = ray_origin;
+		camera.direction = ray_direction;
+		trace_path<Features>(camera, false, sampler_state, aovs, params, sample);
+		return glm::vec4(sample.color, 1.0f);
 	}
-	
-	glm::vec4 CPUPathTracer::trace_ray(const glm::vec3 &ray_origin, const glm::vec3 &ray_direction, uint32_t &rng_state) const
+
+	template <TraceFeatures Features>
+	void CPUPathTracer::trace_path(const PathVertex &start, bool sample_direction, SamplerState &sampler_state, PathAOVs &aovs,
+								   const TraceParams &params, PathSample &sample) const
 	{
-		const int max_bounces = 4;
+		// A constant when the depth class is exact, so the loop bound folds away
+		const uint32_t max_bounces = Features.max_depth != 0 ? Features.max_depth : params.max_bounces;
+		const EmbreeScene &embree_scene = *m_frame_scene;
+		const uint32_t dimension_offset = start.dimension_offset;
 		glm::vec3 accumulated_color = glm::vec3(0.0f);
-		glm::vec3 ray_throughput = glm::vec3(1.0f);
+		glm::vec3 ray_throughput = start.throughput;
 
-		glm::vec3 current_origin = ray_origin;
-		glm::vec3 current_direction = ray_direction;
+		glm::vec3 current_origin = start.position;
+		glm::vec3 current_direction = start.direction;
+		glm::vec3 normal = start.normal;
 
-		// Pre-check debug normals to avoid per-bounce overhead
-		const bool debug_normals = false;
+		// Guided vertices of the path, their incident radiance is known once the path ends
+		struct GuidedVertex
+		{
+			const GuidingField::Region *region;
+			glm::vec3 direction;
+			glm::vec3 throughput; // Including the vertex's own sampling weight
+			float pdf;
+			glm::vec3 color_before; // Sample color before the vertex, the rest was carried by its continuation
+		};
+		[[maybe_unused]] std::array<GuidedVertex, Features.guiding ? MAX_GUIDED_VERTICES : 0> guided_vertices;
+		[[maybe_unused]] uint32_t guided_vertex_count = 0;
+
+		// Vertices that trained the efficiency cache, their continuation includes every branch split off there
+		constexpr bool efficiency = Features.russian_roulette == RussianRoulettePolicy::Efficiency;
+		struct RouletteVertex
+		{
+			uint32_t cell;
+			glm::vec3 throughput; // Before the roulette or splitting weight
+			glm::vec3 color_before;
+			uint32_t rays_before;
+		};
+		[[maybe_unused]] std::array<RouletteVertex, efficiency ? MAX_ROULETTE_VERTICES : 0> roulette_vertices;
+		[[maybe_unused]] uint32_t roulette_vertex_count = 0;
 
 		// Unrolled path tracing loop for better branch prediction
-		int bounce_count = 0;
+		uint32_t bounce_count = start.bounce;
 		while (bounce_count < max_bounces)
 		{
+			// Generate new ray direction, the camera ray has one
+			if (sample_direction)
+			{
+				Sampler::set_dimension(sampler_state, SampleDimension::for_bounce(bounce_count - 1, SampleDimension::BOUNCE_DIRECTION) + dimension_offset);
+				if constexpr (Features.guiding)
+				{
+					// One-sample MIS of the cosine lobe and the learned distribution, weighted by the mixture pdf
+					const glm::vec2 u = m_sampler->get_2d(sampler_state);
+					const GuidingField::Region &region = m_guiding.lookup(current_origin);
+					const bool guided = !region.sampling.is_empty();
+					if (guided)
+					{
+						Sampler::set_dimension(sampler_state, SampleDimension::for_bounce(bounce_count - 1, SampleDimension::GUIDING) + dimension_offset);
+						current_direction = m_sampler->get_1d(sampler_state) < GUIDING_FRACTION ? region.sampling.sample(u) : get_random_bounche(normal, u);
+					}
+					else
+					{
+						current_direction = get_random_bounche(normal, u);
+					}
+
+					// Guided directions below the surface carry no light
+					const float cos_theta = glm::dot(normal, current_direction);
+					if (cos_theta <= 0.0f)
+						break;
+					const float bsdf_pdf = cos_theta * glm::one_over_pi<float>();
+					const float pdf = guided ? GUIDING_FRACTION * region.sampling.pdf(current_direction) + (1.0f - GUIDING_FRACTION) * bsdf_pdf : bsdf_pdf;
+					if (guided)
+						ray_throughput *= bsdf_pdf / pdf;
+
+					if (params.train_guiding && guided_vertex_count < MAX_GUIDED_VERTICES)
+						guided_vertices[guided_vertex_count++] = {&region, current_direction, ray_throughput, pdf, sample.color};
+				}
+				else
+				{
+					current_direction = get_random_bounche(normal, m_sampler->get_2d(sampler_state));
+				}
+
+				// Offset origin for next bounce
+				const float EPSILON = 1e-4f;
+				current_origin += normal * EPSILON;
+			}
+			sample_direction = true;
+
 			// Optimized Embree ray setup
 			RTCRayHit rayhit;
 			rayhit.ray.org_x = current_origin.x;
@@ -224,13 +916,21 @@ namespace render
 			rayhit.ray.flags = 0;
 			rayhit.hit.geomID = RTC_INVALID_GEOMETRY_ID;
 
-			rtcIntersect1(m_embreeScene, &rayhit);
+			rtcIntersect1(embree_scene.scene, &rayhit);
+			if constexpr (efficiency)
+				sample.rays++;
 
 			// Check for miss - optimize for common case (hit)
 			// [[unlikely]]
 			if (rayhit.hit.geomID == RTC_INVALID_GEOMETRY_ID) [[unlikely]]
 			{
-				accumulated_color += ray_throughput * sample_sky(current_direction);
+				const glm::vec3 sky = sample_sky(current_direction);
+				if constexpr (Features.aovs)
+				{
+					if (bounce_count == 0)
+						aovs.albedo = sky;
+				}
+				accumulated_color += ray_throughput * sky;
 				break;
 			}
 
@@ -244,43 +944,115 @@ namespace render
 			const float nx = rayhit.hit.Ng_x;
 			const float ny = rayhit.hit.Ng_y;
 			const float nz = rayhit.hit.Ng_z;
-			const float inv_len = 1.0f / sqrtf(nx * nx + ny * ny + nz * nz);
-			const float norm_x = nx * inv_len;
-			const float norm_y = ny * inv_len;
-			const float norm_z = nz * inv_len;
-
-			// Debug normals early exit
-			// add [[unlikely]]
-			if (debug_normals) [[unlikely]]
+			const float inv_len = Math::fastRsqrt(nx * nx + ny * ny + nz * nz);
+			normal = glm::vec3(nx * inv_len, ny * inv_len, nz * inv_len);
+
+			// First-hit output variables
+			if constexpr (Features.aovs)
 			{
-				return glm::vec4((norm_x + 1.0f) * 0.5f, (norm_y + 1.0f) * 0.5f, (norm_z + 1.0f) * 0.5f, 1.0f);
+				if (bounce_count == 0)
+				{
+					aovs.albedo = embree_scene.geometry_albedo[rayhit.hit.geomID];
+					aovs.normal = normal;
+					aovs.depth = hit_t;
+					aovs.node_id = embree_scene.geometry_node_ids[rayhit.hit.geomID];
+				}
 			}
 
 			// Update throughput
-			ray_throughput *= 0.7f;
+			ray_throughput *= embree_scene.geometry_albedo[rayhit.hit.geomID];
 
-			// Russian roulette after 2 bounces
+			// No continuation ray after the last bounce
 			bounce_count++;
-			if (bounce_count > 2)
+			if (bounce_count == max_bounces)
+				break;
+
+			if constexpr (Features.russian_roulette == RussianRoulettePolicy::MaxThroughput)
 			{
-				const float continuation_probability = std::max({ray_throughput.r, ray_throughput.g, ray_throughput.b});
-				if (random_float(rng_state) > continuation_probability)
+				if (bounce_count >= params.russian_roulette_depth)
+				{
+					Sampler::set_dimension(sampler_state, SampleDimension::for_bounce(bounce_count - 1, SampleDimension::RUSSIAN_ROULETTE) + dimension_offset);
+					const float continuation_probability = std::max({ray_throughput.r, ray_throughput.g, ray_throughput.b});
+					if (m_sampler->get_1d(sampler_state) > continuation_probability)
+						break;
+					ray_throughput /= continuation_probability;
+				}
+			}
+			else if constexpr (efficiency)
+			{
+				// Until the region and the pixel have estimates this is the throughput roulette, which never splits
+				const uint32_t cell = m_efficiency.lookup(current_origin);
+				float factor = sample.pixel_estimate > 0.0f
+								   ? m_efficiency.get_splitting_factor(cell, (ray_throughput.r + ray_throughput.g + ray_throughput.b) / 3.0f)
+								   : 0.0f;
+				if (factor == 0.0f)
+					factor = std::min(std::max({ray_throughput.r, ray_throughput.g, ray_throughput.b}), 1.0f);
+				// Splitting pays off at any depth, termination waits for the roulette depth
+				if (bounce_count < params.russian_roulette_depth)
+					factor = std::max(factor, 1.0f);
+				// Bounds the branches of one camera sample, q = 1 keeps the estimate unbiased
+				if (sample.branches + static_cast<uint32_t>(std::ceil(factor)) - 1 > MAX_PATH_BRANCHES)
+					factor = std::min(factor, 1.0f);
+
+				// Stochastic rounding, floor(q + u) branches have expected count q
+				Sampler::set_dimension(sampler_state, SampleDimension::for_bounce(bounce_count - 1, SampleDimension::RUSSIAN_ROULETTE) + dimension_offset);
+				const uint32_t branch_count = static_cast<uint32_t>(factor + m_sampler->get_1d(sampler_state));
+
+				if (roulette_vertex_count < MAX_ROULETTE_VERTICES)
+					roulette_vertices[roulette_vertex_count++] = {cell, ray_throughput, sample.color, sample.rays};
+				if (branch_count == 0)
 					break;
-				ray_throughput /= continuation_probability;
+				ray_throughput /= factor;
+
+				// Every branch but this one is traced to its end first, each samples its own direction from here
+				sample.branches += branch_count - 1;
+				for (uint32_t branch = 1; branch < branch_count; branch++)
+				{
+					PathVertex split;
+					split.position = current_origin;
+					split.normal = normal;
+					split.throughput = ray_throughput;
+					split.bounce = bounce_count;
+					split.dimension_offset = SampleDimension::for_branch(dimension_offset, bounce_count, branch);
+					SamplerState branch_state = Sampler::start_branch(sampler_state, split.dimension_offset);
+					trace_path<Features>(split, true, branch_state, aovs, params, sample);
+				}
 			}
+		}
 
-			// Generate new ray direction
-			glm::vec3 normal(norm_x, norm_y, norm_z);
-			current_direction = get_random_bounche(normal, rng_state);
+		// Light only arrives at the path end, so a vertex receives what this path and the branches split off after
+		// it added to the sample, divided by the throughput up to the vertex
+		const auto incident_radiance = [&](const glm::vec3 &color_before, const glm::vec3 &throughput) {
+			const glm::vec3 color = sample.color + accumulated_color - color_before;
+			const glm::vec3 radiance = glm::vec3(throughput.r > 0.0f ? color.r / throughput.r : 0.0f, throughput.g > 0.0f ? color.g / throughput.g : 0.0f,
+												 throughput.b > 0.0f ? color.b / throughput.b : 0.0f);
+			return (radiance.r + radiance.g + radiance.b) / 3.0f;
+		};
 
-			// Offset origin for next bounce
-			const float EPSILON = 1e-4f;
-			current_origin.x += norm_x * EPSILON;
-			current_origin.y += norm_y * EPSILON;
-			current_origin.z += norm_z * EPSILON;
+		if constexpr (Features.guiding)
+		{
+			for (uint32_t i = 0; i < guided_vertex_count; i++)
+			{
+				const GuidedVertex &vertex = guided_vertices[i];
+				GuidingField::record(*vertex.region, vertex.direction, incident_radiance(vertex.color_before, vertex.throughput), vertex.pdf);
+			}
 		}
 
-		return glm::vec4(accumulated_color, 1.0f);
+		if constexpr (efficiency)
+		{
+			if (sample.pixel_estimate > 0.0f)
+			{
+				const float pixel_second_moment = sample.pixel_estimate * sample.pixel_estimate + RELATIVE_EPSILON;
+				for (uint32_t i = 0; i < roulette_vertex_count; i++)
+				{
+					const RouletteVertex &vertex = roulette_vertices[i];
+					const float radiance = incident_radiance(vertex.color_before, vertex.throughput);
+					m_efficiency.record_vertex(vertex.cell, radiance * radiance / pixel_second_moment, static_cast<float>(sample.rays - vertex.rays_before));
+				}
+			}
+		}
+
+		sample.color += accumulated_color;
 	}
 	
 	glm::vec3 CPUPathTracer::sample_sky(const glm::vec3 &direction) const
@@ -291,115 +1063,9 @@ namespace render
 		return glm::mix(horizon_color, sky_color, t);
 	}
 	
-	float CPUPathTracer::random_float(uint32_t &state) const
-	{
-		uint32_t result;
-		state = state * 747796405 + 2891336453;
-		result = ((state >> ((state >> 28) + 4)) ^ state) * 277803737;
-		result = (result >> 22) ^ result;
-		return ((float)result / 4294967295.0f);
-	}
-	
-	glm::vec3 CPUPathTracer::get_random_bounche(const glm::vec3 &normal, uint32_t &state) const
+	glm::vec3 CPUPathTracer::get_random_bounche(const glm::vec3 &normal, const glm::vec2 &u) const
 	{
-		// Two random numbers for spherical coordinates
-		float u1 = random_float(state);
-		float u2 = random_float(state);
-
-		// Cosine-weighted sampling
-		float cosTheta = sqrt(u1);
-		float sinTheta = sqrt(1.0f - u1);
-		float phi = 2.0f * glm::pi<float>() * u2;
-
-		// Local coordinates (normal is +Z axis)
-		float x = sinTheta * cos(phi);
-		float y = sinTheta * sin(phi);
-		float z = cosTheta;
-
-		// Build orthonormal basis from normal
-		glm::vec3 up = (abs(normal.z) < 0.999f) ? glm::vec3(0, 0, 1) : glm::vec3(1, 0, 0);
-		glm::vec3 tangent = normalize(cross(up, normal));
-		glm::vec3 bitangent = cross(normal, tangent);
-
-		// Transform to world space
-		return x * tangent + y * bitangent + z * normal;
-	}
-	
-	void CPUPathTracer::rebuild_scene()
-	{
-		assert(m_scene && "Scene not set before rebuilding Embree scene");
-		assert(m_embreeScene && "Embree scene not initialized");
-
-		render::Log::info("Rebuilding Embree scene from application scene...");
-
-		// const auto& objects = m_scene->getAllObjects();
-
-		// for (const auto& obj : objects)
-		// {
-		// 	switch (obj->getType())
-		// 	{
-		// 		case Scene::NodeType::Sphere:
-		// 		{
-		// 			const auto* sphere = static_cast<const Scene::SphereObject*>(obj.get());
-
-					// RTCGeometry sphere_geometry = rtcNewGeometry(m_embreeDevice, RTC_GEOMETRY_TYPE_SPHERE_POINT);
-		// 			struct SpherePoint { float x, y, z, radius; };
-		// 			SpherePoint* vertices = (SpherePoint*)rtcSetNewGeometryBuffer(sphere_geometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT4, sizeof(SpherePoint), 1);
-		// 			vertices[0].x = sphere->transform[3][0];
-		// 			vertices[0].y = sphere->transform[3][1];
-		// 			vertices[0].z = sphere->transform[3][2];
-		// 			vertices[0].radius = sphere->radius;
-
-		// 			rtcCommitGeometry(sphere_geometry);
-		// 			rtcAttachGeometry(m_embreeScene, sphere_geometry);
-		// 			rtcReleaseGeometry(sphere_geometry);
-		// 			break;
-		// 		}
-		// 	}
-		// }
-
-
-		auto all_nodes = m_scene->GetAllNodes();
-		for (const auto& [id, node] : all_nodes)
-		{
-			std::cout << "Processing node ID: " << id << ", Name: " << node->GetName() << std::endl;
-			std::cout << "Node Type: " << static_cast<int>(node->GetType()) << std::endl;
-			switch (node->GetType())
-			{
-				case render::NodeType::SPHERE_OBJECT:
-				{
-					std::cout << "Creating sphere geometry for node: " << node->GetName() << std::endl;
-					const auto* sphere = static_cast<const render::SphereObject*>(node);
-					// Create Embree geometry for sphere
-					RTCGeometry sphere_geometry = rtcNewGeometry(m_embreeDevice, RTC_GEOMETRY_TYPE_SPHERE_POINT);
-					
-					// Set sphere vertex data (center + radius)
-					struct Vertex { float x, y, z, radius; };
-					Vertex* vertices = (Vertex*)rtcSetNewGeometryBuffer(sphere_geometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT4, sizeof(Vertex), 1);
-					
-					glm::vec3 pos = sphere->GetPosition();
-					vertices[0].x = pos.x;
-					vertices[0].y = pos.y;
-					vertices[0].z = pos.z;
-					vertices[0].radius = sphere->GetRadius();
-					
-					std::cout << "Sphere position: (" << pos.x << ", " << pos.y << ", " << pos.z << "), radius: " << sphere->GetRadius() << std::endl;
-					
-					rtcSetGeometryUserData(sphere_geometry, (void*)sphere);
-					rtcCommitGeometry(sphere_geometry);
-					rtcAttachGeometry(m_embreeScene, sphere_geometry);
-					rtcReleaseGeometry(sphere_geometry);
-					break;
-				}
-				default:
-				{
-					std::cout << "Unknown node type: " << static_cast<int>(node->GetType()) << std::endl;
-					break;
-				}
-			}
-		}
-
-
-		rtcCommitScene(m_embreeScene);
+		// Cosine-weighted, branchless basis and polynomial sincos
+		return Math::sampleCosineHemisphere(normal, u);
 	}
 }
\ No newline at end of file
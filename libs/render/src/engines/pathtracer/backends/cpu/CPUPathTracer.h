@@ -1,67 +1,187 @@
 #pragma once
 
 #include "render/PathTracer.h"
+#include "engines/pathtracer/sampling/Sampler.h"
+#include "engines/pathtracer/camera/PrimaryRayTable.h"
+#include "engines/pathtracer/denoise/ATrousDenoiser.h"
+#include "engines/pathtracer/checkpoint/Checkpoint.h"
+#include "engines/pathtracer/output/ImageWriter.h"
+#include "engines/pathtracer/guiding/GuidingField.h"
+#include "engines/pathtracer/roulette/EfficiencyCache.h"
+#include "engines/pathtracer/backends/cpu/SceneAccelerator.h"
+#include "utils/PageBuffer.h"
+#include "utils/ThreadPool.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <utility>
 #include <vector>
 #include <memory>
 #include <glm/glm.hpp>
 
-// Forward declarations for Embree types (avoid including heavy headers in public interface)
+namespace render
+{
 
-// Forward declarations
-class Scene;
+	enum class RussianRoulettePolicy : uint8_t
+	{
+		Off,
+		MaxThroughput, // Survive with the largest throughput component
+		Efficiency	   // Roulette and splitting factors from the EfficiencyCache
+	};
 
-typedef struct RTCDeviceTy *RTCDevice;
-typedef struct RTCSceneTy *RTCScene;
+	/// Integrator features fixed at compile time, one render kernel is instantiated per combination
+	/// and selected from the render settings once per frame
+	struct TraceFeatures
+	{
+		bool aovs = false;
+		RussianRoulettePolicy russian_roulette = RussianRoulettePolicy::Off;
+		bool guiding = false; // Bounces mix BSDF and GuidingField sampling
+		uint32_t max_depth = 0; // Depth class, 0 = bound read from TraceParams at runtime
+	};
 
-namespace render
-{
+	/// Per-frame values the kernels read at runtime
+	struct TraceParams
+	{
+		uint32_t max_bounces = 0;
+		uint32_t russian_roulette_depth = 0; // First bounce that may be terminated
+		bool train_guiding = false;			 // Paths record their radiance into the GuidingField
+	};
 
 	/// CPU-based path tracing implementation using Embree for acceleration
 	/// Clean, modern API for progressive path tracing
+	/// Views created with create_view() share the scene, its acceleration structure and the thread pool
 	class CPUPathTracer : public PathTracer
 	{
 	public:
-		CPUPathTracer();
+		explicit CPUPathTracer(const ThreadingConfig &threading = {});
+		explicit CPUPathTracer(std::shared_ptr<SceneAccelerator> accelerator);
 		~CPUPathTracer();
 
 		void render() override;
 
-		void set_scene(std::shared_ptr<Scene> scene) override { m_scene = scene; }
+		void set_scene(std::shared_ptr<Scene> scene) override { m_accelerator->set_scene(std::move(scene)); }
 		void set_settings(std::shared_ptr<RenderSettings> settings) override { m_renderSettings = settings; }
+		void set_camera(std::shared_ptr<Camera> camera) override { m_camera = std::move(camera); }
 
-		std::shared_ptr<Scene> get_scene() const override { return m_scene; }
+		std::shared_ptr<Scene> get_scene() const override { return m_accelerator->get_scene(); }
 		std::shared_ptr<RenderSettings> get_settings() const override { return m_renderSettings; }
+		std::shared_ptr<Camera> get_camera() const override { return m_camera; }
+
+		std::unique_ptr<PathTracer> create_view() const override;
 
 		// Backend identification
 		std::string get_backend_name() const override { return "CPU Path Tracer (Embree)"; }
 		BackendType get_backend_type() const override { return BackendType::CPU_EMBREE; }
 
 		const PathTracer::RenderResult &get_render_result() override;
+		const PathTracer::AOVBuffer *get_aov(AOVType type) override;
+		void get_accumulation(AccumulationSnapshot &snapshot) const override;
+
+		void save_checkpoint(const std::string &path) override;
+		bool resume_from_checkpoint(const std::string &path) override;
+
+		void write_image(const std::string &path, const ImageOutputOptions &options = {}) override;
+		void wait_for_image_writes() override { m_image_writer.wait(); }
+
+		void update_scene_async() override;
+		SceneUpdateStats get_last_scene_update() const override { return m_accelerator->get_last_update(); }
+
+		MemoryStats get_memory_stats() const override { return m_accelerator->get_memory_stats(); }
+		void set_memory_budget(size_t bytes) override { m_accelerator->set_memory_budget(bytes); }
+
+		const ThreadingConfig &get_threading_config() const override { return m_accelerator->get_threading_config(); }
 
 	private:
+		/// First-hit output variables of a single path
+		struct PathAOVs
+		{
+			glm::vec3 albedo{0.0f};
+			glm::vec3 normal{0.0f};
+			float depth = 0.0f;
+			uint32_t node_id = 0;
+		};
+
+		/// Inputs and results of one camera sample, shared by the branches it splits into
+		struct PathSample
+		{
+			float pixel_estimate = 0.0f; // Mean of the pixel's previous samples, 0 before the first
+			glm::vec3 color{0.0f};
+			uint32_t rays = 0; // Traced by every branch, counted by the efficiency roulette only
+			uint32_t branches = 1;
+		};
+
+		/// Start of a path or of a branch split off at a surface
+		struct PathVertex
+		{
+			glm::vec3 position{0.0f};
+			glm::vec3 normal{0.0f};	   // Branches only, they sample their own direction
+			glm::vec3 direction{0.0f}; // Camera rays only
+			glm::vec3 throughput{1.0f};
+			uint32_t bounce = 0;
+			uint32_t dimension_offset = 0; // See SampleDimension::for_branch
+		};
+
+		using EmbreeScene = SceneAccelerator::EmbreeScene;
+
 		void invalidate();
+		void apply_build_profile();
+		void allocate_accumulation();
+		void clear_accumulation();
+
+		uint32_t get_active_aov_mask() const;
+		void accumulate_aovs(size_t pixel_index, const PathAOVs &path_aovs);
+		std::vector<float> &aov_planes(AOVType type) { return m_aov_planes[static_cast<uint32_t>(type)]; }
+
+		/// Per-pixel sample counts, nullptr while every pixel has m_frameCount samples
+		const float *get_pixel_sample_counts() const;
+
+		/// This view's camera, or the scene camera when none is set
+		const Camera &get_active_camera(const Scene &scene) const;
+
+		using RenderKernel = void (CPUPathTracer::*)(const TraceParams &params);
+
+		static uint32_t select_render_kernel(const RenderSettings &settings, bool write_aovs, TraceParams &params);
 
-		bool initialize_embree();
-		void cleanup_embree();
+		template <size_t... Indices>
+		static constexpr std::array<RenderKernel, sizeof...(Indices)> make_render_kernels(std::index_sequence<Indices...>);
 
-		uint32_t get_rng_state(uint32_t width, uint32_t height, uint32_t x, uint32_t y, uint32_t frame) const;
-		glm::vec4 trace_ray(const glm::vec3 &ray_origin, const glm::vec3 &ray_direction, uint32_t &rng_state) const;
+		template <TraceFeatures Features>
+		void render_frame(const TraceParams &params);
+
+		template <TraceFeatures Features>
+		glm::vec4 trace_ray(const glm::vec3 &ray_origin, const glm::vec3 &ray_direction, SamplerState &sampler_state, PathAOVs &aovs,
+							const TraceParams &params, PathSample &sample) const;
+
+		/// Adds the contribution of a path, and of every branch split off it, to sample.color
+		template <TraceFeatures Features>
+		void trace_path(const PathVertex &start, bool sample_direction, SamplerState &sampler_state, PathAOVs &aovs, const TraceParams &params,
+						PathSample &sample) const;
 
 		glm::vec3 sample_sky(const glm::vec3 &direction) const;
 
-		float random_float(uint32_t &state) const;
-		glm::vec3 get_random_bounche(const glm::vec3 &normal, uint32_t &state) const;
+		glm::vec3 get_random_bounche(const glm::vec3 &normal, const glm::vec2 &u) const;
 
-		void rebuild_scene();
+		void capture_checkpoint(CheckpointData &data) const;
+		void update_checkpoint();
+
+		void capture_image(const ImageOutputOptions &options, ImageSnapshot &snapshot) const;
+		void update_image_output();
 
 	private:
 
-		// Embree device and scene management
-		RTCDevice m_embreeDevice = nullptr;
-		RTCScene m_embreeScene = nullptr;
+		// Embree device, scene and thread pool, possibly shared with other views
+		std::shared_ptr<SceneAccelerator> m_accelerator;
+		const EmbreeScene *m_frame_scene = nullptr; // Traced by render_frame, held by the frame's FrameLock
+		uint64_t m_scene_generation = 0;			// Accelerator generation the accumulation was rendered with
+		BuildProfile m_build_profile = BuildProfile::Auto; // Last profile of this view's settings handed to m_accelerator
 
 		// Progressive state
-		std::shared_ptr<Scene> m_scene;
+		std::shared_ptr<Camera> m_camera;
+		std::unique_ptr<Sampler> m_sampler;
+		PrimaryRayTable m_primary_rays;
+		GuidingField m_guiding;		// Trained from this view's paths, restarts with the accumulation
+		EfficiencyCache m_efficiency; // Likewise, for RouletteMode::Efficiency
 
 		PathTracer::RenderResult m_render_result;
 
@@ -69,9 +189,29 @@ namespace render
 		bool m_progressiveRunning = false;
 
 		// Rendering buffers
-		std::vector<float> m_accumulation_buffer; // RGBARGBA... high precision
+		PageBuffer<float> m_accumulation_buffer; // RGBRGB... or RGBARGBA... float32 sums, see AccumulationLayout
+		uint32_t m_accumulation_channels = 0;
+		MemoryPlacement m_memory_placement = MemoryPlacement::FirstTouch;
+		std::vector<uint32_t> m_tile_row_offsets; // Band of tile rows per NUMA domain, see ThreadPool::get_domain_offsets
+		std::vector<float> m_denoised_buffer;	  // RGBA, averaged
+		std::vector<float> m_averaged_buffer;	  // Color, then albedo/normal/depth planes for the denoiser, averaged per pixel
+
+		// Accumulated AOVs, channel-major planes, empty unless requested
+		// The SampleCount plane holds per-pixel sample counts once a render region made them differ
+		std::array<std::vector<float>, AOV_TYPE_COUNT> m_aov_planes;
+		std::array<PathTracer::AOVBuffer, AOV_TYPE_COUNT> m_aov_results;
+
 		std::shared_ptr<RenderSettings> m_renderSettings;
 		bool m_outputDirty = true;
+
+		ThreadPool *m_thread_pool = nullptr; // Owned by m_accelerator, also runs the Embree builds
+		ATrousDenoiser m_denoiser;
+
+		CheckpointWriter m_checkpoint_writer;
+		std::chrono::steady_clock::time_point m_last_checkpoint;
+
+		ImageWriter m_image_writer;
+		std::chrono::steady_clock::time_point m_last_image_output;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <embree4/rtcore.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace render
+{
+
+	/// Counts the memory an Embree device allocates (BVHs, geometry buffers, build scratch)
+	/// and rejects allocations past an optional budget, which makes the current build fail with
+	/// RTC_ERROR_OUT_OF_MEMORY instead of the process running out of memory
+	class EmbreeMemoryMonitor
+	{
+	public:
+		void attach(RTCDevice device) { rtcSetDeviceMemoryMonitorFunction(device, &EmbreeMemoryMonitor::callback, this); }
+
+		void set_budget(size_t bytes) { m_budget.store(static_cast<int64_t>(bytes), std::memory_order_relaxed); }
+
+		size_t get_budget() const { return static_cast<size_t>(m_budget.load(std::memory_order_relaxed)); }
+		size_t get_current() const { return static_cast<size_t>(std::max<int64_t>(m_current.load(std::memory_order_relaxed), 0)); }
+		size_t get_peak() const { return static_cast<size_t>(m_peak.load(std::memory_order_relaxed)); }
+
+		/// True when an allocation was refused since the last call
+		bool take_budget_exceeded() { return m_budget_exceeded.exchange(false, std::memory_order_relaxed); }
+
+	private:
+		/// Called from every thread Embree allocates on, before allocations and after frees
+		static bool callback(void *user_ptr, ssize_t bytes, bool /*post*/)
+		{
+			auto *monitor = static_cast<EmbreeMemoryMonitor *>(user_ptr);
+
+			const int64_t current = monitor->m_current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+			if (bytes <= 0)
+				return true;
+
+			const int64_t budget = monitor->m_budget.load(std::memory_order_relaxed);
+			if (budget > 0 && current > budget)
+			{
+				// A refused allocation never happens, so it is not counted
+				monitor->m_current.fetch_sub(bytes, std::memory_order_relaxed);
+				monitor->m_budget_exceeded.store(true, std::memory_order_relaxed);
+				return false;
+			}
+
+			int64_t peak = monitor->m_peak.load(std::memory_order_relaxed);
+			while (current > peak && !monitor->m_peak.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+			{
+			}
+			return true;
+		}
+
+	private:
+		std::atomic<int64_t> m_current{0};
+		std::atomic<int64_t> m_peak{0};
+		std::atomic<int64_t> m_budget{0}; // 0 = unlimited
+		std::atomic<bool> m_budget_exceeded{false};
+	};
+
+} // namespace render
@@ -0,0 +1,485 @@
+#include "SceneAccelerator.h"
+#include <embree4/rtcore.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "render/Log.h"
+#include "render/Profiler.h"
+#include "render/Scene.h"
+
+#include "render_assert.h"
+
+namespace render
+{
+	namespace
+	{
+		// Rebuilds of fewer primitives finish faster than a frame, they run inline rather than a frame late
+		constexpr size_t BACKGROUND_BUILD_MIN_PRIMITIVES = 10000;
+
+		// Builds that overlap rendering or output run on this fraction of the render threads
+		constexpr uint32_t BUILD_POOL_DIVISOR = 4;
+
+		/// Embree sphere point, center and radius
+		struct SphereVertex
+		{
+			float x, y, z, radius;
+		};
+
+		SphereVertex make_sphere_vertex(const Scene &scene, const SphereObject &sphere)
+		{
+			// Rotation does not change a sphere, non-uniform scale is approximated by the largest axis
+			const glm::mat4 &world = scene.GetWorldMatrix(sphere);
+			const float scale = std::max({glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))});
+			return {world[3].x, world[3].y, world[3].z, sphere.GetRadius() * scale};
+		}
+
+		/// Embree settings of a resolved build profile
+		struct BuildParameters
+		{
+			RTCSceneFlags flags;
+			RTCBuildQuality quality;
+			bool refit; // Transform changes update the existing structure in place
+		};
+
+		BuildParameters get_build_parameters(BuildProfile profile)
+		{
+			switch (profile)
+			{
+			case BuildProfile::Interactive:
+				return {RTC_SCENE_FLAG_DYNAMIC, RTC_BUILD_QUALITY_LOW, true};
+			case BuildProfile::Robust:
+				return {RTC_SCENE_FLAG_ROBUST, RTC_BUILD_QUALITY_MEDIUM, false};
+			default:
+				return {RTC_SCENE_FLAG_COMPACT, RTC_BUILD_QUALITY_HIGH, false};
+			}
+		}
+
+		/// Auto builds new geometry for tracing speed and switches to cheap updates once objects move
+		BuildProfile resolve_build_profile(BuildProfile profile, uint32_t changes)
+		{
+			if (profile != BuildProfile::Auto)
+				return profile;
+			return (changes & SceneChange::TOPOLOGY) != 0 ? BuildProfile::Final : BuildProfile::Interactive;
+		}
+	}
+
+	SceneAccelerator::SceneAccelerator(const ThreadingConfig &threading)
+		: m_threading(threading)
+	{
+		m_thread_pool = std::make_unique<ThreadPool>(NumaTopology::detect().with_cpu_count(m_threading.thread_count), m_threading.affinity);
+		m_build_pool = std::make_unique<ThreadPool>(std::max(1u, m_thread_pool->get_thread_count() / BUILD_POOL_DIVISOR));
+		render::Log::info("Rendering on {} threads in {} NUMA domains, {} threads for overlapped builds", m_thread_pool->get_thread_count(),
+						  m_thread_pool->get_domain_count(), m_build_pool->get_thread_count());
+		initialize_embree();
+	}
+
+	SceneAccelerator::~SceneAccelerator()
+	{
+		wait_for_update();
+		if (m_background_build.valid())
+			m_background_build.wait();
+
+		// Views hold the accelerator, so no frame can still reference a scene of this device
+		m_embree_scene.reset();
+		rtcReleaseDevice(m_device);
+	}
+
+	void SceneAccelerator::initialize_embree()
+	{
+		assert(!m_device && "Embree device already initialized");
+		// threads == user_threads leaves Embree no workers of its own, the render or build threads join every build instead
+		// (see commit_scene), so builds and tile rendering share one set of cores instead of oversubscribing them.
+		// Only one build runs at a time and the build pool is the smaller one, so the render thread count covers both
+		const uint32_t thread_count = m_thread_pool->get_thread_count();
+		std::string config = std::format("verbose=1,threads={},user_threads={}", thread_count, thread_count);
+		if (!m_threading.isa.empty())
+			config += std::format(",isa={}", m_threading.isa);
+
+		m_device = rtcNewDevice(config.c_str());
+		if (!m_device)
+			throw std::runtime_error(std::format("Failed to create Embree device with \"{}\"", config));
+		m_memory_monitor.attach(m_device);
+
+		m_embree_scene = make_empty_scene(*m_thread_pool);
+		assert(m_embree_scene->scene && "Failed to create Embree scene");
+	}
+
+	void SceneAccelerator::set_scene(std::shared_ptr<Scene> scene)
+	{
+		std::lock_guard lock(m_mutex);
+		wait_for_update();
+		m_scene = std::move(scene);
+		m_scene_synced = false;
+		m_failed_changes = 0;
+	}
+
+	std::shared_ptr<Scene> SceneAccelerator::get_scene() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_scene;
+	}
+
+	void SceneAccelerator::set_build_profile(BuildProfile build_profile)
+	{
+		std::lock_guard lock(m_mutex);
+		m_build_profile = build_profile;
+	}
+
+	uint64_t SceneAccelerator::synchronize()
+	{
+		RENDER_PROFILE_SCOPE("Scene sync");
+		std::lock_guard lock(m_mutex);
+		verify(m_scene != nullptr, "Scene not set before synchronizing it");
+
+		// Changes made after an asynchronous update are applied here, synchronously
+		if (m_update.valid())
+		{
+			const auto start = std::chrono::steady_clock::now();
+			wait_for_update();
+			std::lock_guard stats_lock(m_stats_mutex);
+			m_last_update.wait_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		// A finished background rebuild is swapped in between frames
+		finish_background_build(false);
+
+		// Edits made while a rebuild runs in the background wait for it and are applied after the swap
+		if (has_scene_changes() && !m_background_build.valid())
+			update_embree_scene(take_scene_changes(), m_build_profile, false);
+
+		// A different profile rebuilds the same geometry, the accumulated image stays valid
+		if (m_build_profile != BuildProfile::Auto && m_build_profile != m_embree_scene->profile && !m_background_build.valid())
+			update_embree_scene(0, m_build_profile, false);
+
+		return m_generation.load(std::memory_order_relaxed);
+	}
+
+	void SceneAccelerator::synchronize_async()
+	{
+		std::lock_guard lock(m_mutex);
+		verify(m_scene != nullptr, "Scene not set before updating it");
+		wait_for_update();
+		finish_background_build(true);
+		if (!has_scene_changes())
+			return;
+
+		const uint32_t changes = take_scene_changes();
+		m_update = std::async(std::launch::async, [this, changes, build_profile = m_build_profile] { update_embree_scene(changes, build_profile, true); });
+	}
+
+	SceneAccelerator::FrameLock SceneAccelerator::lock_frame() const
+	{
+		FrameLock frame;
+		frame.lock = std::shared_lock(m_frame_mutex);
+		frame.scene = m_embree_scene;
+		frame.generation = m_generation.load(std::memory_order_relaxed);
+		return frame;
+	}
+
+	void SceneAccelerator::wait_for_update()
+	{
+		if (m_update.valid())
+			m_update.get();
+	}
+
+	bool SceneAccelerator::has_scene_changes() const
+	{
+		return !m_scene_synced || m_failed_changes != 0 || m_scene->getJournal().getVersion() != m_scene_version;
+	}
+
+	uint32_t SceneAccelerator::take_scene_changes()
+	{
+		// A new scene, or one whose journal dropped events we never read, is built from scratch
+		const SceneJournal &journal = m_scene->getJournal();
+		std::vector<SceneEvent> events;
+		const bool complete = m_scene_synced && journal.getEventsSince(m_scene_version, events);
+
+		// Edits of a failed build were already taken from the journal, they are applied again with the new ones
+		const uint32_t changes = (complete ? SceneJournal::summarize(events) : SceneChange::TOPOLOGY) | std::exchange(m_failed_changes, 0);
+		m_scene_synced = true;
+		m_scene_version = journal.getVersion();
+		return changes;
+	}
+
+	void SceneAccelerator::update_materials()
+	{
+		RENDER_PROFILE_SCOPE("Material update");
+		std::unique_lock frame_lock(m_frame_mutex);
+		EmbreeScene &embree_scene = *m_embree_scene;
+		for (uint32_t geometry_id = 0; geometry_id < embree_scene.geometry_node_ids.size(); geometry_id++)
+		{
+			const SceneNode* node = m_scene->FindNode(embree_scene.geometry_node_ids[geometry_id]);
+			if (node && node->GetType() == NodeType::SPHERE_OBJECT)
+				embree_scene.geometry_albedo[geometry_id] = static_cast<const SphereObject*>(node)->GetAlbedo();
+		}
+		m_generation.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void SceneAccelerator::update_embree_scene(uint32_t changes, BuildProfile build_profile, bool asynchronous)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		// Shading-only edits patch the traced scene, the acceleration structure is untouched
+		if (changes & SceneChange::MATERIAL)
+			update_materials();
+		if (changes == SceneChange::MATERIAL)
+			return;
+
+		const BuildProfile profile = resolve_build_profile(build_profile, changes);
+
+		// Asynchronous updates overlap the resolve and output of the previous frame, which need the render pool
+		ThreadPool &pool = asynchronous ? *m_build_pool : *m_thread_pool;
+
+		// Same node set and profile: move the existing geometries and refit instead of rebuilding from scratch
+		if ((changes & SceneChange::TOPOLOGY) == 0 && !m_embree_scene->geometry_node_ids.empty() && profile == m_embree_scene->profile &&
+			get_build_parameters(profile).refit)
+		{
+			if (refit_scene(pool))
+			{
+				record_scene_update(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), true, false, false);
+				return;
+			}
+			// A failed refit leaves the scene half updated and unsafe to trace, so there is no previous scene to keep.
+			// Views render an empty scene until a rebuild succeeds, which then does not need the broken scene's memory
+			render::Log::warn("Embree refit failed, rebuilding the scene");
+			replace_scene(make_empty_scene(pool), true);
+			m_scene_dropped = true;
+		}
+
+		SceneGeometry geometry = capture_scene_geometry();
+
+		// The first build has no previous scene to keep rendering, it runs on the whole pool.
+		// Background builds run on the build pool while the render pool keeps rendering.
+		if (!asynchronous && !m_embree_scene->geometry_node_ids.empty() && geometry.spheres.size() >= BACKGROUND_BUILD_MIN_PRIMITIVES)
+		{
+			render::Log::debug("Rebuilding Embree scene with {} spheres in the background", geometry.spheres.size());
+			m_background_changes = changes;
+			m_background_build = std::async(std::launch::async, [this, geometry = std::move(geometry), profile]() {
+				return build_scene(geometry, profile, *m_build_pool);
+			});
+			return;
+		}
+
+		apply_built_scene(build_scene(geometry, profile, pool), false, changes);
+	}
+
+	void SceneAccelerator::finish_background_build(bool wait)
+	{
+		if (!m_background_build.valid())
+			return;
+		if (!wait && m_background_build.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return;
+
+		apply_built_scene(m_background_build.get(), true, m_background_changes);
+	}
+
+	void SceneAccelerator::apply_built_scene(std::shared_ptr<EmbreeScene> scene, bool background, uint32_t changes)
+	{
+		if (!scene)
+		{
+			// Materials were patched before the build, only the geometry edits are retried
+			m_failed_changes |= changes & ~SceneChange::MATERIAL;
+			if (m_scene_dropped)
+				render::Log::error("Embree scene build failed after a failed refit, rendering an empty scene until the next update succeeds");
+			else
+				render::Log::error("Embree scene build failed, keeping the previous scene and retrying on the next update");
+			record_scene_update(0.0, false, true, background);
+			return;
+		}
+
+		// A profile change rebuilds the same geometry, only scene edits change the image
+		const double build_seconds = scene->build_seconds;
+		replace_scene(std::move(scene), changes != 0 || m_scene_dropped);
+		m_scene_dropped = false;
+		record_scene_update(build_seconds, false, false, background);
+	}
+
+	void SceneAccelerator::replace_scene(std::shared_ptr<EmbreeScene> scene, bool changes_image)
+	{
+		std::shared_ptr<EmbreeScene> previous;
+		{
+			std::unique_lock frame_lock(m_frame_mutex);
+			previous = std::exchange(m_embree_scene, std::move(scene));
+			if (changes_image)
+				m_generation.fetch_add(1, std::memory_order_relaxed);
+		}
+		// The previous scene is released with its last reference, outside the lock frames wait on
+	}
+
+	void SceneAccelerator::record_scene_update(double seconds, bool refit, bool failed, bool background)
+	{
+		std::lock_guard lock(m_stats_mutex);
+		m_last_update.build_seconds = seconds;
+		m_last_update.refit = refit;
+		m_last_update.failed = failed;
+		m_last_update.background = background;
+		m_last_update.profile = m_embree_scene->profile;
+		m_last_update.memory_bytes = m_memory_monitor.get_current();
+		m_last_update.wait_seconds = 0.0;
+		m_last_update.pending_changes = m_failed_changes != 0;
+		m_last_update.scene_dropped = m_scene_dropped;
+		render::Log::debug("Embree scene {} in {:.3f} ms, {:.1f} MB in use", refit ? "refit" : "rebuilt", seconds * 1e3,
+						   m_last_update.memory_bytes / (1024.0 * 1024.0));
+	}
+
+	PathTracer::SceneUpdateStats SceneAccelerator::get_last_update() const
+	{
+		std::lock_guard lock(m_stats_mutex);
+		return m_last_update;
+	}
+
+	PathTracer::MemoryStats SceneAccelerator::get_memory_stats() const
+	{
+		PathTracer::MemoryStats stats;
+		stats.current_bytes = m_memory_monitor.get_current();
+		stats.peak_bytes = m_memory_monitor.get_peak();
+		stats.budget_bytes = m_memory_monitor.get_budget();
+		return stats;
+	}
+
+	SceneAccelerator::EmbreeScene::~EmbreeScene()
+	{
+		if (scene)
+			rtcReleaseScene(scene);
+	}
+
+	SceneAccelerator::SceneGeometry SceneAccelerator::capture_scene_geometry() const
+	{
+		assert(m_scene && "Scene not set before rebuilding Embree scene");
+
+		SceneGeometry geometry;
+		m_scene->UpdateWorldTransforms();
+		for (const auto& [id, node] : m_scene->GetAllNodes())
+		{
+			switch (node->GetType())
+			{
+				case render::NodeType::SPHERE_OBJECT:
+				{
+					const auto* sphere_object = static_cast<const render::SphereObject*>(node);
+					const SphereVertex sphere = make_sphere_vertex(*m_scene, *sphere_object);
+					geometry.spheres.emplace_back(sphere.x, sphere.y, sphere.z, sphere.radius);
+					geometry.albedo.push_back(sphere_object->GetAlbedo());
+					geometry.node_ids.push_back(node->GetID());
+					break;
+				}
+				default:
+				{
+					render::Log::warn("Unknown node type: {}", static_cast<int>(node->GetType()));
+					break;
+				}
+			}
+		}
+		return geometry;
+	}
+
+	std::shared_ptr<SceneAccelerator::EmbreeScene> SceneAccelerator::build_scene(const SceneGeometry &geometry, BuildProfile build_profile, ThreadPool &pool)
+	{
+		RENDER_PROFILE_SCOPE("Scene build");
+		const auto start = std::chrono::steady_clock::now();
+
+		// Built next to the current scene, which stays in use if the build fails; geometry IDs are reassigned
+		auto result = std::make_shared<EmbreeScene>();
+		result->scene = rtcNewScene(m_device);
+		result->profile = build_profile;
+
+		const BuildParameters parameters = get_build_parameters(build_profile);
+		rtcSetSceneFlags(result->scene, parameters.flags);
+		rtcSetSceneBuildQuality(result->scene, parameters.quality);
+
+		for (size_t i = 0; i < geometry.spheres.size(); i++)
+		{
+			RTCGeometry sphere_geometry = rtcNewGeometry(m_device, RTC_GEOMETRY_TYPE_SPHERE_POINT);
+			SphereVertex* vertex = (SphereVertex*)rtcSetNewGeometryBuffer(sphere_geometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT4, sizeof(SphereVertex), 1);
+			const glm::vec4 &sphere = geometry.spheres[i];
+			*vertex = {sphere.x, sphere.y, sphere.z, sphere.w};
+
+			rtcSetGeometryBuildQuality(sphere_geometry, parameters.quality);
+			rtcCommitGeometry(sphere_geometry);
+			const uint32_t geometry_id = rtcAttachGeometry(result->scene, sphere_geometry);
+			if (geometry_id >= result->geometry_node_ids.size())
+			{
+				result->geometry_node_ids.resize(geometry_id + 1, 0);
+				result->geometry_albedo.resize(geometry_id + 1, glm::vec3(0.0f));
+			}
+			result->geometry_node_ids[geometry_id] = geometry.node_ids[i];
+			result->geometry_albedo[geometry_id] = geometry.albedo[i];
+			rtcReleaseGeometry(sphere_geometry);
+		}
+
+		if (!commit_scene(result->scene, pool))
+			return nullptr;
+
+		result->build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	}
+
+	std::shared_ptr<SceneAccelerator::EmbreeScene> SceneAccelerator::make_empty_scene(ThreadPool &pool)
+	{
+		auto result = std::make_shared<EmbreeScene>();
+		result->scene = rtcNewScene(m_device);
+		commit_scene(result->scene, pool);
+		return result;
+	}
+
+	bool SceneAccelerator::refit_scene(ThreadPool &pool)
+	{
+		RENDER_PROFILE_SCOPE("Scene refit");
+		// Updated in place, so every view's running frame has to finish first
+		std::unique_lock frame_lock(m_frame_mutex);
+
+		// Only reached for profiles that built a dynamic scene, see get_build_parameters()
+		const EmbreeScene &embree_scene = *m_embree_scene;
+		m_scene->UpdateWorldTransforms();
+		for (uint32_t geometry_id = 0; geometry_id < embree_scene.geometry_node_ids.size(); geometry_id++)
+		{
+			const SceneNode* node = m_scene->FindNode(embree_scene.geometry_node_ids[geometry_id]);
+			if (!node || node->GetType() != NodeType::SPHERE_OBJECT)
+				continue;
+
+			RTCGeometry geometry = rtcGetGeometry(embree_scene.scene, geometry_id);
+			SphereVertex* vertex = (SphereVertex*)rtcGetGeometryBufferData(geometry, RTC_BUFFER_TYPE_VERTEX, 0);
+			const SphereVertex updated = make_sphere_vertex(*m_scene, *static_cast<const SphereObject*>(node));
+			if (std::memcmp(vertex, &updated, sizeof(SphereVertex)) == 0)
+				continue;
+
+			*vertex = updated;
+			rtcUpdateGeometryBuffer(geometry, RTC_BUFFER_TYPE_VERTEX, 0);
+			rtcSetGeometryBuildQuality(geometry, RTC_BUILD_QUALITY_REFIT);
+			rtcCommitGeometry(geometry);
+		}
+
+		m_generation.fetch_add(1, std::memory_order_relaxed);
+		return commit_scene(embree_scene.scene, pool);
+	}
+
+	bool SceneAccelerator::commit_scene(RTCScene scene, ThreadPool &pool)
+	{
+		// Every thread of the pool joins the build, the first to arrive starts it and all return once it is done.
+		// Embree keeps errors per thread, so each one checks its own
+		std::atomic<bool> failed = false;
+		RTCDevice device = m_device;
+		auto commit = [scene, device, &failed]() {
+			rtcJoinCommitScene(scene);
+			if (rtcGetDeviceError(device) != RTC_ERROR_NONE)
+				failed.store(true, std::memory_order_relaxed);
+		};
+		pool.run_on_all_threads(commit);
+
+		if (m_memory_monitor.take_budget_exceeded())
+		{
+			const PathTracer::MemoryStats stats = get_memory_stats();
+			render::Log::error("Embree build exceeded the memory budget of {:.1f} MB ({:.1f} MB in use)", stats.budget_bytes / (1024.0 * 1024.0),
+							   stats.current_bytes / (1024.0 * 1024.0));
+			return false;
+		}
+		return !failed.load(std::memory_order_relaxed);
+	}
+
+} // namespace render
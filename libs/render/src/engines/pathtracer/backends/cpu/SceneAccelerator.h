@@ -0,0 +1,145 @@
+#pragma once
+
+#include "render/PathTracer.h"
+#include "render/Types.h"
+#include "engines/pathtracer/backends/cpu/EmbreeMemoryMonitor.h"
+#include "utils/ThreadPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <glm/glm.hpp>
+
+typedef struct RTCDeviceTy *RTCDevice;
+typedef struct RTCSceneTy *RTCScene;
+
+namespace render
+{
+
+	class Scene;
+
+	/// Embree device, thread pool and acceleration structure of one scene, shared by every CPU path tracer view of it
+	/// Views keep their own camera, settings and accumulation, so memory and build time do not grow with the view count.
+	/// Views may render concurrently: each frame holds a FrameLock, in-place updates (refits, material patches) wait for
+	/// running frames while full rebuilds are swapped in between them. Edit the scene only while no view synchronizes.
+	class SceneAccelerator
+	{
+	public:
+		/// Committed Embree scene and the data traced with it, reference counted so a replacement
+		/// can be built in the background while frames keep tracing this one
+		struct EmbreeScene
+		{
+			EmbreeScene() = default;
+			~EmbreeScene();
+
+			EmbreeScene(const EmbreeScene &) = delete;
+			EmbreeScene &operator=(const EmbreeScene &) = delete;
+
+			RTCScene scene = nullptr;
+			std::vector<uint32_t> geometry_node_ids;	 // Embree geometry ID -> scene NodeID
+			std::vector<glm::vec3> geometry_albedo;	 // Embree geometry ID -> diffuse albedo, patched in place between frames
+			BuildProfile profile = BuildProfile::Auto; // Auto for the empty scene before the first build
+			double build_seconds = 0.0;
+		};
+
+		/// Keeps the traced scene unchanged for the lifetime of a frame
+		struct FrameLock
+		{
+			std::shared_lock<std::shared_mutex> lock;
+			std::shared_ptr<const EmbreeScene> scene;
+			uint64_t generation = 0; // Scene generation traced by this frame, see synchronize()
+		};
+
+		explicit SceneAccelerator(const ThreadingConfig &threading = {});
+		~SceneAccelerator();
+
+		SceneAccelerator(const SceneAccelerator &) = delete;
+		SceneAccelerator &operator=(const SceneAccelerator &) = delete;
+
+		void set_scene(std::shared_ptr<Scene> scene);
+		std::shared_ptr<Scene> get_scene() const;
+
+		/// Profile of the shared acceleration structure, a non-Auto profile different from the built one
+		/// is rebuilt by the next synchronize()
+		void set_build_profile(BuildProfile build_profile);
+
+		/// Applies pending scene edits and swaps in finished background builds, then returns the scene generation.
+		/// The generation changes whenever the traced image changed, views restart accumulation when it does.
+		/// Call before lock_frame(), never while holding a FrameLock.
+		uint64_t synchronize();
+
+		/// Starts applying pending scene edits on a background thread, the next synchronize() waits for it.
+		/// The scene must not be edited until then.
+		void synchronize_async();
+
+		FrameLock lock_frame() const;
+
+		ThreadPool &get_thread_pool() { return *m_thread_pool; }
+		const ThreadingConfig &get_threading_config() const { return m_threading; }
+
+		PathTracer::SceneUpdateStats get_last_update() const;
+		PathTracer::MemoryStats get_memory_stats() const;
+		void set_memory_budget(size_t bytes) { m_memory_monitor.set_budget(bytes); }
+
+	private:
+		/// Geometry copied from the scene on the synchronizing thread, builds never read the scene itself
+		struct SceneGeometry
+		{
+			std::vector<glm::vec4> spheres; // Center, radius
+			std::vector<glm::vec3> albedo;
+			std::vector<uint32_t> node_ids;
+		};
+
+		void initialize_embree();
+		bool commit_scene(RTCScene scene, ThreadPool &pool);
+
+		void wait_for_update();
+		bool has_scene_changes() const;
+		uint32_t take_scene_changes();
+		void update_materials();
+		void update_embree_scene(uint32_t changes, BuildProfile build_profile, bool asynchronous);
+		SceneGeometry capture_scene_geometry() const;
+		std::shared_ptr<EmbreeScene> build_scene(const SceneGeometry &geometry, BuildProfile build_profile, ThreadPool &pool);
+		std::shared_ptr<EmbreeScene> make_empty_scene(ThreadPool &pool);
+		bool refit_scene(ThreadPool &pool);
+		void finish_background_build(bool wait);
+		void apply_built_scene(std::shared_ptr<EmbreeScene> scene, bool background, uint32_t changes);
+		void replace_scene(std::shared_ptr<EmbreeScene> scene, bool changes_image);
+		void record_scene_update(double seconds, bool refit, bool failed, bool background);
+
+	private:
+		ThreadingConfig m_threading;
+		std::unique_ptr<ThreadPool> m_thread_pool; // Renders every view's tiles and joins the Embree builds, see commit_scene()
+		std::unique_ptr<ThreadPool> m_build_pool;  // Joins asynchronous and background builds, so frames never wait for them to release m_thread_pool
+
+		RTCDevice m_device = nullptr;
+		EmbreeMemoryMonitor m_memory_monitor;
+
+		// Frames hold a shared lock, replacing or modifying m_embree_scene takes it exclusively
+		// and bumps the generation in the same step, so a frame never sees one without the other
+		mutable std::shared_mutex m_frame_mutex;
+		std::shared_ptr<EmbreeScene> m_embree_scene;
+		std::atomic<uint64_t> m_generation{0};
+
+		// Serializes synchronize(), synchronize_async() and set_scene() between views
+		mutable std::mutex m_mutex;
+		std::shared_ptr<Scene> m_scene;
+		BuildProfile m_build_profile = BuildProfile::Auto;
+		bool m_scene_synced = false;  // m_scene was built at least once, later syncs read its journal
+		uint64_t m_scene_version = 0; // SceneJournal version of the last sync
+		uint32_t m_failed_changes = 0; // SceneChange bits of journal events whose build failed, retried by the next sync
+		bool m_scene_dropped = false;  // A failed refit replaced m_embree_scene with an empty one, cleared by the next successful build
+
+		std::future<void> m_update; // synchronize_async()
+		std::future<std::shared_ptr<EmbreeScene>> m_background_build; // Rebuild traced from the first frame after it finishes
+		uint32_t m_background_changes = 0;							   // SceneChange bits the background rebuild applies
+
+		mutable std::mutex m_stats_mutex;
+		PathTracer::SceneUpdateStats m_last_update;
+	};
+
+} // namespace render
@@ -0,0 +1,51 @@
+#include "PrimaryRayTable.h"
+
+#include "render/Camera.h"
+#include "utils/ThreadPool.h"
+
+namespace render
+{
+	namespace
+	{
+		constexpr uint32_t ROWS_PER_TASK = 8;
+	}
+
+	bool PrimaryRayTable::update(const Camera &camera, uint32_t width, uint32_t height, ThreadPool &thread_pool)
+	{
+		if (m_width == width && m_height == height && m_camera_version == camera.getVersion())
+			return false;
+
+		m_width = width;
+		m_height = height;
+		m_camera_version = camera.getVersion();
+
+		m_origin = camera.getPosition();
+		m_right = camera.getRight();
+		m_up = camera.getUpAxis();
+		m_forward = camera.getForward();
+		m_aperture = camera.getAperture();
+		m_focus_distance = camera.getFocusDistance();
+
+		m_directions.resize(static_cast<size_t>(width) * height);
+
+		const float inv_width = 1.0f / static_cast<float>(width);
+		const float inv_height = 1.0f / static_cast<float>(height);
+		const float aspect_ratio = static_cast<float>(width) * inv_height;
+
+		thread_pool.parallel_for(height, ROWS_PER_TASK, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t y = begin; y < end; y++)
+			{
+				const float ndc_y = 1.0f - 2.0f * (static_cast<float>(y) + 0.5f) * inv_height;
+				glm::vec3 *row = m_directions.data() + static_cast<size_t>(y) * width;
+				for (uint32_t x = 0; x < width; x++)
+				{
+					const float ndc_x = 2.0f * (static_cast<float>(x) + 0.5f) * inv_width - 1.0f;
+					row[x] = camera.getRayDirection(glm::vec2(ndc_x, ndc_y), aspect_ratio);
+				}
+			}
+		});
+
+		return true;
+	}
+
+} // namespace render
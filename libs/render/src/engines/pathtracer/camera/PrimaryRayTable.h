@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace render
+{
+
+	class Camera;
+	class ThreadPool;
+
+	/// Normalized primary ray directions through every pixel center
+	/// Rebuilt only when the resolution or the camera changes, so per-frame ray setup is a streaming load
+	class PrimaryRayTable
+	{
+	public:
+		/// Returns true when the table was rebuilt
+		bool update(const Camera &camera, uint32_t width, uint32_t height, ThreadPool &thread_pool);
+
+		bool is_thin_lens() const { return m_aperture > 0.0f; }
+
+		/// Pinhole ray from the camera position
+		void generate(size_t pixel_index, glm::vec3 &origin, glm::vec3 &direction) const
+		{
+			origin = m_origin;
+			direction = m_directions[pixel_index];
+		}
+
+		/// Thin lens ray, lens_u is a 2D sample mapped onto the aperture disk
+		void generate(size_t pixel_index, const glm::vec2 &lens_u, glm::vec3 &origin, glm::vec3 &direction) const
+		{
+			const glm::vec3 pinhole_direction = m_directions[pixel_index];
+			const glm::vec3 focus_point = m_origin + pinhole_direction * (m_focus_distance / glm::dot(pinhole_direction, m_forward));
+			const glm::vec2 lens = sample_concentric_disk(lens_u) * m_aperture;
+			origin = m_origin + lens.x * m_right + lens.y * m_up;
+			direction = glm::normalize(focus_point - origin);
+		}
+
+	private:
+		/// Shirley-Chiu concentric square to disk mapping, keeps stratification intact
+		static glm::vec2 sample_concentric_disk(const glm::vec2 &u)
+		{
+			const glm::vec2 offset = 2.0f * u - 1.0f;
+			if (offset.x == 0.0f && offset.y == 0.0f)
+				return glm::vec2(0.0f);
+
+			float radius, theta;
+			if (std::abs(offset.x) > std::abs(offset.y))
+			{
+				radius = offset.x;
+				theta = glm::quarter_pi<float>() * (offset.y / offset.x);
+			}
+			else
+			{
+				radius = offset.y;
+				theta = glm::half_pi<float>() - glm::quarter_pi<float>() * (offset.x / offset.y);
+			}
+			return radius * glm::vec2(std::cos(theta), std::sin(theta));
+		}
+
+	private:
+		std::vector<glm::vec3> m_directions; // Row-major, one per pixel
+
+		// Cache key
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+		uint64_t m_camera_version = 0; // Unique across cameras, see Camera::getVersion()
+
+		// Camera snapshot taken at build time
+		glm::vec3 m_origin{0.0f};
+		glm::vec3 m_right{1.0f, 0.0f, 0.0f};
+		glm::vec3 m_up{0.0f, 1.0f, 0.0f};
+		glm::vec3 m_forward{0.0f, 0.0f, 1.0f};
+		float m_aperture = 0.0f;
+		float m_focus_distance = 1.0f;
+	};
+
+} // namespace render
@@ -0,0 +1,298 @@
+#include "Checkpoint.h"
+
+#include "engines/pathtracer/output/ImageWriter.h"
+#include "render/Log.h"
+#include "render/Scene.h"
+
+#include <OpenImageIO/imageio.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <system_error>
+#include <type_traits>
+
+namespace render
+{
+	namespace
+	{
+		constexpr int CHECKPOINT_VERSION = 1;
+
+		const char *const COLOR_CHANNEL_NAMES[4] = {"R", "G", "B", "A"};
+
+		/// FNV-1a
+		class Hasher
+		{
+		public:
+			template <typename T>
+			void add(const T &value)
+			{
+				static_assert(std::is_trivially_copyable_v<T>);
+				const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+				for (size_t i = 0; i < sizeof(T); i++)
+				{
+					m_hash ^= bytes[i];
+					m_hash *= 0x100000001b3ull;
+				}
+			}
+
+			uint64_t get() const { return m_hash; }
+
+		private:
+			uint64_t m_hash = 0xcbf29ce484222325ull;
+		};
+
+		// Files are written under a temporary name and renamed, so a crash mid-write keeps the previous checkpoint
+		std::filesystem::path partial_path(const std::filesystem::path &path)
+		{
+			std::filesystem::path partial = path;
+			partial.replace_filename(path.stem().string() + ".partial" + path.extension().string());
+			return partial;
+		}
+	}
+
+	uint64_t compute_scene_hash(const Scene &scene, const Camera &camera, const RenderSettings &settings)
+	{
+		Hasher hasher;
+
+		// The node registry is unordered, hash in ID order
+		std::vector<const SceneNode *> nodes;
+		nodes.reserve(scene.GetAllNodes().size());
+		for (const auto &[id, node] : scene.GetAllNodes())
+			nodes.push_back(node);
+		std::ranges::sort(nodes, {}, &SceneNode::GetID);
+
+		for (const SceneNode *node : nodes)
+		{
+			hasher.add(node->GetID());
+			hasher.add(node->GetType());
+			const SceneNode *parent = node->GetParent();
+			hasher.add(parent && parent->GetType() != NodeType::SCENE_ROOT ? parent->GetID() : NodeID(0));
+			hasher.add(node->GetLocalTransform());
+			if (node->GetType() == NodeType::SPHERE_OBJECT)
+			{
+				const auto *sphere = static_cast<const SphereObject *>(node);
+				hasher.add(sphere->GetRadius());
+				hasher.add(sphere->GetAlbedo());
+			}
+		}
+
+		hasher.add(camera.getPosition());
+		hasher.add(camera.getTarget());
+		hasher.add(camera.getUp());
+		hasher.add(camera.getFieldOfView());
+		hasher.add(camera.getAperture());
+		hasher.add(camera.getFocusDistance());
+
+		hasher.add(settings.getWidth());
+		hasher.add(settings.getHeight());
+		hasher.add(settings.getMaxBounces());
+		hasher.add(settings.getRussianRouletteDepth());
+		hasher.add(settings.getSamplerType());
+		hasher.add(settings.getAccumulationLayout());
+		hasher.add(settings.getSampleStreamIndex());
+		hasher.add(settings.getSampleStreamCount());
+		return hasher.get();
+	}
+
+	bool write_checkpoint(const std::string &path, const CheckpointData &data)
+	{
+		const size_t pixel_count = static_cast<size_t>(data.width) * data.height;
+
+		std::vector<std::string> channel_names;
+		uint32_t aov_mask = 0;
+		for (uint32_t c = 0; c < data.channels; c++)
+			channel_names.push_back(COLOR_CHANNEL_NAMES[c]);
+		for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+		{
+			const AOVType type = static_cast<AOVType>(i);
+			if (data.aov_planes[i].empty())
+				continue;
+			aov_mask |= aov_bit(type);
+			for (uint32_t c = 0; c < aov_channel_count(type); c++)
+				channel_names.push_back(aov_channel_name(type, c));
+		}
+
+		const size_t channel_count = channel_names.size();
+		OIIO::ImageSpec spec(data.width, data.height, static_cast<int>(channel_count), OIIO::TypeDesc::FLOAT);
+		spec.channelnames = std::move(channel_names);
+		spec.attribute("compression", "zip");
+		spec.attribute("render:checkpoint_version", CHECKPOINT_VERSION);
+		spec.attribute("render:frame_count", static_cast<int>(data.frame_count));
+		spec.attribute("render:sampler", static_cast<int>(data.sampler_type));
+		spec.attribute("render:sample_stream_index", static_cast<int>(data.sample_stream_index));
+		spec.attribute("render:sample_stream_count", static_cast<int>(data.sample_stream_count));
+		spec.attribute("render:accumulation_channels", static_cast<int>(data.channels));
+		spec.attribute("render:aov_mask", static_cast<int>(aov_mask));
+		// 64-bit values do not survive an int attribute
+		spec.attribute("render:scene_hash", std::format("{:016x}", data.scene_hash));
+
+		// EXR stores pixels interleaved, the AOV planes are channel-major
+		std::vector<float> pixels(pixel_count * channel_count);
+		for (size_t p = 0; p < pixel_count; p++)
+		{
+			float *out = pixels.data() + p * channel_count;
+			std::memcpy(out, data.color.data() + p * data.channels, data.channels * sizeof(float));
+			out += data.channels;
+			for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+			{
+				const std::vector<float> &planes = data.aov_planes[i];
+				if (planes.empty())
+					continue;
+				for (uint32_t c = 0; c < aov_channel_count(static_cast<AOVType>(i)); c++)
+					*out++ = planes[c * pixel_count + p];
+			}
+		}
+
+		const std::filesystem::path partial = partial_path(path);
+		auto output = OIIO::ImageOutput::create(partial.string());
+		if (!output || !output->open(partial.string(), spec) || !output->write_image(OIIO::TypeDesc::FLOAT, pixels.data()))
+		{
+			Log::error("Failed to write checkpoint {}: {}", path, output ? output->geterror() : OIIO::geterror());
+			return false;
+		}
+		output->close();
+
+		std::error_code error;
+		std::filesystem::rename(partial, path, error);
+		if (error)
+		{
+			Log::error("Failed to replace checkpoint {}: {}", path, error.message());
+			return false;
+		}
+		return true;
+	}
+
+	bool read_checkpoint(const std::string &path, CheckpointData &data)
+	{
+		auto input = OIIO::ImageInput::open(path);
+		if (!input)
+		{
+			Log::error("Failed to open checkpoint {}: {}", path, OIIO::geterror());
+			return false;
+		}
+
+		const OIIO::ImageSpec &spec = input->spec();
+		if (spec.get_int_attribute("render:checkpoint_version") != CHECKPOINT_VERSION)
+		{
+			Log::error("{} is not a checkpoint of this renderer version", path);
+			return false;
+		}
+
+		data.width = static_cast<uint32_t>(spec.width);
+		data.height = static_cast<uint32_t>(spec.height);
+		data.channels = static_cast<uint32_t>(spec.get_int_attribute("render:accumulation_channels"));
+		data.frame_count = static_cast<uint32_t>(spec.get_int_attribute("render:frame_count"));
+		data.sampler_type = static_cast<SamplerType>(spec.get_int_attribute("render:sampler"));
+		data.sample_stream_index = static_cast<uint32_t>(spec.get_int_attribute("render:sample_stream_index"));
+		data.sample_stream_count = static_cast<uint32_t>(spec.get_int_attribute("render:sample_stream_count", 1));
+		data.scene_hash = std::stoull(spec.get_string_attribute("render:scene_hash", "0"), nullptr, 16);
+		const uint32_t aov_mask = static_cast<uint32_t>(spec.get_int_attribute("render:aov_mask"));
+
+		size_t channel_count = data.channels;
+		for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+		{
+			if (aov_mask & aov_bit(static_cast<AOVType>(i)))
+				channel_count += aov_channel_count(static_cast<AOVType>(i));
+		}
+		if ((data.channels != 3 && data.channels != 4) || channel_count != static_cast<size_t>(spec.nchannels))
+		{
+			Log::error("Checkpoint {} has an unexpected channel layout", path);
+			return false;
+		}
+
+		const size_t pixel_count = static_cast<size_t>(data.width) * data.height;
+		std::vector<float> pixels(pixel_count * channel_count);
+		if (!input->read_image(0, 0, 0, spec.nchannels, OIIO::TypeDesc::FLOAT, pixels.data()))
+		{
+			Log::error("Failed to read checkpoint {}: {}", path, input->geterror());
+			return false;
+		}
+		input->close();
+
+		data.color.resize(pixel_count * data.channels);
+		for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+		{
+			const bool present = (aov_mask & aov_bit(static_cast<AOVType>(i))) != 0;
+			data.aov_planes[i].resize(present ? pixel_count * aov_channel_count(static_cast<AOVType>(i)) : 0);
+		}
+
+		for (size_t p = 0; p < pixel_count; p++)
+		{
+			const float *in = pixels.data() + p * channel_count;
+			std::memcpy(data.color.data() + p * data.channels, in, data.channels * sizeof(float));
+			in += data.channels;
+			for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+			{
+				std::vector<float> &planes = data.aov_planes[i];
+				if (planes.empty())
+					continue;
+				for (uint32_t c = 0; c < aov_channel_count(static_cast<AOVType>(i)); c++)
+					planes[c * pixel_count + p] = *in++;
+			}
+		}
+		return true;
+	}
+
+	CheckpointWriter::CheckpointWriter()
+		: m_thread(&CheckpointWriter::writer_loop, this)
+	{
+	}
+
+	CheckpointWriter::~CheckpointWriter()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = true;
+		}
+		m_work_cv.notify_one();
+		m_thread.join();
+	}
+
+	bool CheckpointWriter::is_busy() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_pending;
+	}
+
+	void CheckpointWriter::submit(const std::string &path, CheckpointData &&data)
+	{
+		{
+			std::unique_lock lock(m_mutex);
+			m_done_cv.wait(lock, [this] { return !m_pending; });
+			m_path = path;
+			m_data = std::move(data);
+			m_pending = true;
+		}
+		m_work_cv.notify_one();
+	}
+
+	void CheckpointWriter::wait()
+	{
+		std::unique_lock lock(m_mutex);
+		m_done_cv.wait(lock, [this] { return !m_pending; });
+	}
+
+	void CheckpointWriter::writer_loop()
+	{
+		std::unique_lock lock(m_mutex);
+		while (true)
+		{
+			// A queued checkpoint is still written on shutdown
+			m_work_cv.wait(lock, [this] { return m_pending || m_stop; });
+			if (!m_pending)
+				return;
+
+			// The submitter only touches the data again after m_pending is cleared
+			lock.unlock();
+			if (write_checkpoint(m_path, m_data))
+				Log::info("Checkpoint written to {} ({} samples)", m_path, m_data.frame_count);
+			lock.lock();
+
+			m_pending = false;
+			m_done_cv.notify_all();
+		}
+	}
+
+} // namespace render
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "render/Types.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace render
+{
+
+	class Camera;
+	class Scene;
+
+	/// Progressive state needed to continue a render exactly where it stopped
+	/// The sampler is stateless per sample index, so the frame count and sample stream fully describe it
+	struct CheckpointData
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t channels = 0; // Color channels, see AccumulationLayout
+		uint32_t frame_count = 0;
+		SamplerType sampler_type = SamplerType::Sobol;
+		uint32_t sample_stream_index = 0;
+		uint32_t sample_stream_count = 1;
+		uint64_t scene_hash = 0;
+
+		std::vector<float> color;									 // Interleaved sums
+		std::array<std::vector<float>, AOV_TYPE_COUNT> aov_planes; // Channel-major sums, empty when not accumulated
+	};
+
+	/// Hash of everything that changes the accumulated image: geometry, the view's camera and integrator settings
+	uint64_t compute_scene_hash(const Scene &scene, const Camera &camera, const RenderSettings &settings);
+
+	/// Zip-compressed float EXR with the progressive state as metadata, replaced atomically
+	bool write_checkpoint(const std::string &path, const CheckpointData &data);
+	bool read_checkpoint(const std::string &path, CheckpointData &data);
+
+	/// Writes checkpoints on a background thread so compression and IO never stall rendering
+	class CheckpointWriter
+	{
+	public:
+		CheckpointWriter();
+		~CheckpointWriter(); // Finishes the pending checkpoint
+
+		CheckpointWriter(const CheckpointWriter &) = delete;
+		CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+		/// True while a checkpoint is queued or being written, callers skip a checkpoint instead of waiting
+		bool is_busy() const;
+
+		void submit(const std::string &path, CheckpointData &&data);
+
+		/// Blocks until the pending checkpoint is on disk
+		void wait();
+
+	private:
+		void writer_loop();
+
+	private:
+		mutable std::mutex m_mutex;
+		std::condition_variable m_work_cv;
+		std::condition_variable m_done_cv;
+
+		std::string m_path;
+		CheckpointData m_data;
+		bool m_pending = false; // Queued or in progress
+		bool m_stop = false;
+
+		std::thread m_thread; // Last, it starts using the members above on construction
+	};
+
+} // namespace render
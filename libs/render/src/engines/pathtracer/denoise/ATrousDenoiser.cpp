@@ -0,0 +1,281 @@
+#include "ATrousDenoiser.h"
+
+#include "utils/ThreadPool.h"
+#include "render_assert.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Generates the filter kernel for every SIMD target Highway supports and
+// dispatches to the best one for the running CPU.
+#undef HWY_TARGET_INCLUDE
+#define HWY_TARGET_INCLUDE "engines/pathtracer/denoise/ATrousDenoiser.cpp" // this file
+#include <hwy/foreach_target.h>											  // must come before highway.h
+#include <hwy/highway.h>
+#include <hwy/contrib/math/math-inl.h>
+
+namespace render
+{
+	struct FilterRowArgs
+	{
+		const float *color_in = nullptr; // 3 planes
+		float *color_out = nullptr;		 // 3 planes
+		const float *normal = nullptr;	 // 3 planes (sums)
+		const float *depth = nullptr;	 // 1 plane (sums)
+		size_t plane_stride = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t y = 0;
+		uint32_t step = 1;
+		float inv_sigma_color2 = 1.0f;
+		float inv_sigma_normal = 1.0f;
+		float inv_sigma_depth = 1.0f;
+		float normal_scale2 = 1.0f; // Normals are sums, dot products need scale^2
+	};
+}
+
+HWY_BEFORE_NAMESPACE();
+namespace render
+{
+	namespace HWY_NAMESPACE
+	{
+		namespace hn = hwy::HWY_NAMESPACE;
+
+		// B3 spline taps for |offset| = 0, 1, 2
+		constexpr float ATROUS_KERNEL[3] = {3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+
+		// Taps whose edge-stopping distance exceeds this weigh less than exp(-16) = 1e-7 of the center tap and are skipped,
+		// which saves most of the exp calls once the color tolerance has shrunk in the later iterations
+		constexpr float MAX_DISTANCE = 16.0f;
+
+		void FilterRow(const FilterRowArgs &args)
+		{
+			const hn::ScalableTag<float> d;
+			const hn::RebindToSigned<decltype(d)> di;
+			const size_t lanes = hn::Lanes(d);
+
+			const uint32_t width = args.width;
+			const size_t stride = args.plane_stride;
+
+			const float *in_r = args.color_in;
+			const float *in_g = in_r + stride;
+			const float *in_b = in_g + stride;
+			const float *n_x = args.normal;
+			const float *n_y = n_x + stride;
+			const float *n_z = n_y + stride;
+			float *out_r = args.color_out;
+			float *out_g = out_r + stride;
+			float *out_b = out_g + stride;
+
+			const auto zero = hn::Zero(d);
+			const auto one = hn::Set(d, 1.0f);
+			const auto max_distance = hn::Set(d, MAX_DISTANCE);
+			const auto min_weight = hn::Set(d, 1e-20f); // Lanes past the end of the row have no taps at all
+			const auto depth_epsilon = hn::Set(d, 1e-6f);
+			const auto inv_sigma_color2 = hn::Set(d, args.inv_sigma_color2);
+			const auto inv_sigma_normal = hn::Set(d, args.inv_sigma_normal);
+			const auto inv_sigma_depth = hn::Set(d, args.inv_sigma_depth);
+			const auto normal_scale2 = hn::Set(d, args.normal_scale2);
+			const auto zero_column = hn::Zero(di);
+			const auto last_column = hn::Set(di, static_cast<int32_t>(width) - 1);
+
+			const int step = static_cast<int>(args.step);
+			const uint32_t reach = 2 * args.step; // Columns the kernel reaches to each side
+			const size_t row = static_cast<size_t>(args.y) * width;
+
+			// All 25 taps of a group of pixels accumulate in registers, the center values are loaded once
+			for (uint32_t x = 0; x < width; x += static_cast<uint32_t>(lanes))
+			{
+				const size_t count = std::min(lanes, static_cast<size_t>(width - x));
+				const size_t p = row + x;
+				const auto lane_mask = hn::FirstN(d, count);
+
+				const auto pr = hn::LoadN(d, in_r + p, count);
+				const auto pg = hn::LoadN(d, in_g + p, count);
+				const auto pb = hn::LoadN(d, in_b + p, count);
+				const auto pnx = hn::LoadN(d, n_x + p, count);
+				const auto pny = hn::LoadN(d, n_y + p, count);
+				const auto pnz = hn::LoadN(d, n_z + p, count);
+				const auto pz = hn::LoadN(d, args.depth + p, count);
+
+				auto acc_r = zero;
+				auto acc_g = zero;
+				auto acc_b = zero;
+				auto acc_w = zero;
+
+				// Groups near the left and right edge gather clamped columns and give taps outside the image zero weight
+				const bool interior = x >= reach && x + count + reach <= width;
+
+				for (int j = -2; j <= 2; j++)
+				{
+					const int neighbor_y = static_cast<int>(args.y) + j * step;
+					if (neighbor_y < 0 || neighbor_y >= static_cast<int>(args.height))
+						continue;
+					const size_t neighbor_row = static_cast<size_t>(neighbor_y) * width;
+
+					for (int i = -2; i <= 2; i++)
+					{
+						const int offset = i * step;
+						auto valid = lane_mask;
+						hn::VFromD<decltype(d)> qr, qg, qb, qnx, qny, qnz, qz;
+						if (interior)
+						{
+							const size_t q = neighbor_row + x + offset;
+							qr = hn::LoadN(d, in_r + q, count);
+							qg = hn::LoadN(d, in_g + q, count);
+							qb = hn::LoadN(d, in_b + q, count);
+							qnx = hn::LoadN(d, n_x + q, count);
+							qny = hn::LoadN(d, n_y + q, count);
+							qnz = hn::LoadN(d, n_z + q, count);
+							qz = hn::LoadN(d, args.depth + q, count);
+						}
+						else
+						{
+							const auto columns = hn::Iota(di, static_cast<int32_t>(x) + offset);
+							valid = hn::And(valid, hn::RebindMask(d, hn::And(hn::Ge(columns, zero_column), hn::Le(columns, last_column))));
+							const auto index = hn::Min(hn::Max(columns, zero_column), last_column);
+							qr = hn::GatherIndex(d, in_r + neighbor_row, index);
+							qg = hn::GatherIndex(d, in_g + neighbor_row, index);
+							qb = hn::GatherIndex(d, in_b + neighbor_row, index);
+							qnx = hn::GatherIndex(d, n_x + neighbor_row, index);
+							qny = hn::GatherIndex(d, n_y + neighbor_row, index);
+							qnz = hn::GatherIndex(d, n_z + neighbor_row, index);
+							qz = hn::GatherIndex(d, args.depth + neighbor_row, index);
+						}
+
+						// Color distance
+						const auto dr = hn::Sub(qr, pr);
+						const auto dg = hn::Sub(qg, pg);
+						const auto db = hn::Sub(qb, pb);
+						const auto color_dist = hn::Mul(hn::MulAdd(dr, dr, hn::MulAdd(dg, dg, hn::Mul(db, db))), inv_sigma_color2);
+
+						// Normal distance, 1 - cos
+						const auto n_dot = hn::Mul(hn::MulAdd(pnx, qnx, hn::MulAdd(pny, qny, hn::Mul(pnz, qnz))), normal_scale2);
+						const auto normal_dist = hn::Mul(hn::Max(hn::Sub(one, n_dot), zero), inv_sigma_normal);
+
+						// Relative depth distance, invariant to the accumulation scale. An approximate reciprocal is plenty for a weight
+						const auto depth_dist = hn::Mul(hn::Mul(hn::Abs(hn::Sub(pz, qz)), hn::ApproximateReciprocal(hn::Add(hn::Max(pz, qz), depth_epsilon))),
+														inv_sigma_depth);
+
+						// The center tap is never skipped, so the weight sum of every stored lane stays positive
+						const auto distance = hn::Add(color_dist, hn::Add(normal_dist, depth_dist));
+						if (i != 0 || j != 0)
+						{
+							valid = hn::And(valid, hn::Le(distance, max_distance));
+							if (hn::AllFalse(d, valid))
+								continue;
+						}
+
+						const auto tap_weight = hn::Set(d, ATROUS_KERNEL[i < 0 ? -i : i] * ATROUS_KERNEL[j < 0 ? -j : j]);
+						const auto weight = hn::IfThenElseZero(valid, hn::Mul(tap_weight, hn::Exp(d, hn::Neg(distance))));
+
+						acc_r = hn::MulAdd(weight, qr, acc_r);
+						acc_g = hn::MulAdd(weight, qg, acc_g);
+						acc_b = hn::MulAdd(weight, qb, acc_b);
+						acc_w = hn::Add(weight, acc_w);
+					}
+				}
+
+				const auto inv_weight = hn::Div(one, hn::Max(acc_w, min_weight));
+				hn::StoreN(hn::Mul(acc_r, inv_weight), d, out_r + p, count);
+				hn::StoreN(hn::Mul(acc_g, inv_weight), d, out_g + p, count);
+				hn::StoreN(hn::Mul(acc_b, inv_weight), d, out_b + p, count);
+			}
+		}
+
+	} // namespace HWY_NAMESPACE
+} // namespace render
+HWY_AFTER_NAMESPACE();
+
+#if HWY_ONCE
+
+namespace render
+{
+	HWY_EXPORT(FilterRow);
+
+	namespace
+	{
+		constexpr float MIN_ALBEDO = 1e-3f;
+		constexpr uint32_t ROWS_PER_TASK = 4;
+	}
+
+	void ATrousDenoiser::denoise(const DenoiserInput &input, uint32_t width, uint32_t height, const DenoiserSettings &settings,
+								 ThreadPool &thread_pool, float *output_rgba)
+	{
+		verify(input.color && input.albedo && input.normal && input.depth, "Denoiser input is missing buffers");
+		verify(input.color_channels == 3 || input.color_channels == 4, "Denoiser color must be RGB or RGBA");
+
+		const size_t pixel_count = static_cast<size_t>(width) * height;
+		m_ping.resize(pixel_count * 3);
+		m_pong.resize(pixel_count * 3);
+
+		const float scale = input.sample_scale;
+		const size_t channels = input.color_channels;
+		const float *albedo_r = input.albedo;
+		const float *albedo_g = albedo_r + pixel_count;
+		const float *albedo_b = albedo_g + pixel_count;
+
+		// Average and demodulate by albedo into SoA planes
+		thread_pool.parallel_for(height, ROWS_PER_TASK, [&](uint32_t begin, uint32_t end) {
+			float *r = m_ping.data();
+			float *g = r + pixel_count;
+			float *b = g + pixel_count;
+			for (size_t i = static_cast<size_t>(begin) * width; i < static_cast<size_t>(end) * width; i++)
+			{
+				const float *color = input.color + channels * i;
+				r[i] = color[0] * scale / std::max(albedo_r[i] * scale, MIN_ALBEDO);
+				g[i] = color[1] * scale / std::max(albedo_g[i] * scale, MIN_ALBEDO);
+				b[i] = color[2] * scale / std::max(albedo_b[i] * scale, MIN_ALBEDO);
+			}
+		});
+
+		// Wavelet iterations with growing hole size, ping-pong between buffers
+		for (uint32_t iteration = 0; iteration < settings.iterations; iteration++)
+		{
+			FilterRowArgs args;
+			args.color_in = m_ping.data();
+			args.color_out = m_pong.data();
+			args.normal = input.normal;
+			args.depth = input.depth;
+			args.plane_stride = pixel_count;
+			args.width = width;
+			args.height = height;
+			args.step = 1u << iteration;
+			// Color tolerance halves every iteration as the image gets smoother
+			const float sigma_color = settings.sigma_color / static_cast<float>(1u << iteration);
+			args.inv_sigma_color2 = 1.0f / (sigma_color * sigma_color);
+			args.inv_sigma_normal = 1.0f / settings.sigma_normal;
+			args.inv_sigma_depth = 1.0f / settings.sigma_depth;
+			args.normal_scale2 = scale * scale;
+
+			thread_pool.parallel_for(height, ROWS_PER_TASK, [&](uint32_t begin, uint32_t end) {
+				FilterRowArgs row_args = args;
+				for (uint32_t y = begin; y < end; y++)
+				{
+					row_args.y = y;
+					HWY_DYNAMIC_DISPATCH(FilterRow)(row_args);
+				}
+			});
+
+			std::swap(m_ping, m_pong);
+		}
+
+		// Remodulate and write interleaved RGBA
+		thread_pool.parallel_for(height, ROWS_PER_TASK, [&](uint32_t begin, uint32_t end) {
+			const float *r = m_ping.data();
+			const float *g = r + pixel_count;
+			const float *b = g + pixel_count;
+			for (size_t i = static_cast<size_t>(begin) * width; i < static_cast<size_t>(end) * width; i++)
+			{
+				output_rgba[4 * i + 0] = r[i] * std::max(albedo_r[i] * scale, MIN_ALBEDO);
+				output_rgba[4 * i + 1] = g[i] * std::max(albedo_g[i] * scale, MIN_ALBEDO);
+				output_rgba[4 * i + 2] = b[i] * std::max(albedo_b[i] * scale, MIN_ALBEDO);
+				output_rgba[4 * i + 3] = channels == 4 ? input.color[4 * i + 3] * scale : 1.0f;
+			}
+		});
+	}
+
+} // namespace render
+
+#endif // HWY_ONCE
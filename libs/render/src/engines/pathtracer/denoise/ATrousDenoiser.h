@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace render
+{
+
+	class ThreadPool;
+
+	struct DenoiserSettings
+	{
+		uint32_t iterations = 5; // Filter footprint doubles every iteration
+		float sigma_color = 0.5f;
+		float sigma_normal = 0.1f;
+		float sigma_depth = 0.1f;
+	};
+
+	/// Beauty and feature buffers as accumulated by the path tracer (per-pixel sums)
+	struct DenoiserInput
+	{
+		const float *color = nullptr;  // Interleaved RGB or RGBA
+		uint32_t color_channels = 4;   // 3 or 4, missing alpha is 1
+		const float *albedo = nullptr; // SoA planes R, G, B
+		const float *normal = nullptr; // SoA planes X, Y, Z
+		const float *depth = nullptr;  // Single plane
+		float sample_scale = 1.0f;	   // 1 / accumulated samples
+	};
+
+	/// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010)
+	/// Lighting is demodulated by first-hit albedo so surface detail is not blurred,
+	/// edges are preserved by color, normal and relative depth stopping functions
+	class ATrousDenoiser
+	{
+	public:
+		/// Writes the averaged, filtered image as interleaved RGBA
+		void denoise(const DenoiserInput &input, uint32_t width, uint32_t height, const DenoiserSettings &settings,
+					 ThreadPool &thread_pool, float *output_rgba);
+
+	private:
+		// Demodulated color ping-pong buffers, 3 planes each
+		std::vector<float> m_ping;
+		std::vector<float> m_pong;
+	};
+
+} // namespace render
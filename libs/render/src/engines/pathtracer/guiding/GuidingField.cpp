@@ -0,0 +1,292 @@
+#include "GuidingField.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/constants.hpp>
+
+namespace render
+{
+	namespace
+	{
+		// A quadrant holding more than this share of a tree's weight is subdivided, Müller et al. use 1%
+		constexpr float SUBDIVISION_THRESHOLD = 0.01f;
+		constexpr uint32_t MAX_DIRECTIONAL_DEPTH = 20;
+
+		// Regions are split once an iteration records more than c * sqrt(2^k) samples in them
+		constexpr float SPATIAL_SPLIT_SAMPLES = 12000.0f;
+		constexpr size_t MAX_REGIONS = 1 << 16;
+
+		constexpr float ONE_MINUS_EPSILON = 0x1.fffffep-1f;
+		constexpr uint32_t NO_NODE = ~0u;
+
+		glm::vec2 direction_to_square(const glm::vec3 &direction)
+		{
+			const float cos_theta = std::clamp(direction.z, -1.0f, 1.0f);
+			float phi = std::atan2(direction.y, direction.x);
+			if (phi < 0.0f)
+				phi += glm::two_pi<float>();
+			return glm::vec2(std::min((cos_theta + 1.0f) * 0.5f, ONE_MINUS_EPSILON), std::min(phi / glm::two_pi<float>(), ONE_MINUS_EPSILON));
+		}
+
+		glm::vec3 square_to_direction(const glm::vec2 &point)
+		{
+			const float cos_theta = 2.0f * point.x - 1.0f;
+			const float sin_theta = std::sqrt(std::max(0.0f, 1.0f - cos_theta * cos_theta));
+			const float phi = glm::two_pi<float>() * point.y;
+			return glm::vec3(sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta);
+		}
+
+		// Quadrant of a point in the unit square, which is remapped into the quadrant's own unit square
+		uint32_t descend(glm::vec2 &point)
+		{
+			const uint32_t x = point.x >= 0.5f ? 1 : 0;
+			const uint32_t y = point.y >= 0.5f ? 1 : 0;
+			point = point * 2.0f - glm::vec2(static_cast<float>(x), static_cast<float>(y));
+			return x + 2 * y;
+		}
+
+		// Picks index 0 with probability p and rescales u to [0,1) within the picked interval
+		uint32_t pick(float &u, float p)
+		{
+			if (u < p)
+			{
+				u = std::min(u / p, ONE_MINUS_EPSILON);
+				return 0;
+			}
+			u = std::min((u - p) / (1.0f - p), ONE_MINUS_EPSILON);
+			return 1;
+		}
+	}
+
+	DirectionalTree::Node::Node()
+	{
+		for (auto &sum : sums)
+			sum.store(0.0f, std::memory_order_relaxed);
+	}
+
+	DirectionalTree::Node::Node(const Node &other) : children(other.children)
+	{
+		for (uint32_t i = 0; i < 4; i++)
+			sums[i].store(other.sums[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	DirectionalTree::Node &DirectionalTree::Node::operator=(const Node &other)
+	{
+		children = other.children;
+		for (uint32_t i = 0; i < 4; i++)
+			sums[i].store(other.sums[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		return *this;
+	}
+
+	DirectionalTree::DirectionalTree() : m_nodes(1)
+	{
+	}
+
+	float DirectionalTree::get_total() const
+	{
+		float total = 0.0f;
+		for (const auto &sum : m_nodes[0].sums)
+			total += sum.load(std::memory_order_relaxed);
+		return total;
+	}
+
+	void DirectionalTree::record(const glm::vec3 &direction, float weight) const
+	{
+		glm::vec2 point = direction_to_square(direction);
+		uint32_t index = 0;
+		while (true)
+		{
+			const Node &node = m_nodes[index];
+			const uint32_t quadrant = descend(point);
+			node.sums[quadrant].fetch_add(weight, std::memory_order_relaxed);
+			if (node.children[quadrant] == 0)
+				return;
+			index = node.children[quadrant];
+		}
+	}
+
+	glm::vec3 DirectionalTree::sample(glm::vec2 u) const
+	{
+		u = glm::min(u, glm::vec2(ONE_MINUS_EPSILON));
+		glm::vec2 origin(0.0f);
+		float size = 1.0f;
+		uint32_t index = 0;
+		while (true)
+		{
+			const Node &node = m_nodes[index];
+			float sums[4];
+			for (uint32_t i = 0; i < 4; i++)
+				sums[i] = node.sums[i].load(std::memory_order_relaxed);
+			const float left = sums[0] + sums[2];
+			const float total = left + sums[1] + sums[3];
+			if (total <= 0.0f)
+				break; // Nothing recorded below, uniform over the node
+
+			// Column from the marginal, then row within the column
+			const uint32_t x = pick(u.x, left / total);
+			const float column = sums[x] + sums[x + 2];
+			const uint32_t y = pick(u.y, sums[x] / column);
+			const uint32_t quadrant = x + 2 * y;
+
+			size *= 0.5f;
+			origin += glm::vec2(static_cast<float>(x), static_cast<float>(y)) * size;
+			if (node.children[quadrant] == 0)
+				break;
+			index = node.children[quadrant];
+		}
+		return square_to_direction(origin + u * size);
+	}
+
+	float DirectionalTree::pdf(const glm::vec3 &direction) const
+	{
+		glm::vec2 point = direction_to_square(direction);
+		float density = 1.0f;
+		uint32_t index = 0;
+		while (true)
+		{
+			const Node &node = m_nodes[index];
+			float total = 0.0f;
+			for (const auto &sum : node.sums)
+				total += sum.load(std::memory_order_relaxed);
+			if (total <= 0.0f)
+				break;
+
+			const uint32_t quadrant = descend(point);
+			density *= 4.0f * node.sums[quadrant].load(std::memory_order_relaxed) / total;
+			if (node.children[quadrant] == 0)
+				break;
+			index = node.children[quadrant];
+		}
+		return density / (4.0f * glm::pi<float>());
+	}
+
+	void DirectionalTree::refine_from(const DirectionalTree &source)
+	{
+		m_nodes.assign(1, Node{});
+		const float total = source.get_total();
+		if (total <= 0.0f)
+			return;
+
+		// Quadrants below a source leaf have no recorded weights of their own, they get an even share of it
+		struct Entry
+		{
+			uint32_t source = NO_NODE;
+			uint32_t node = 0;
+			uint32_t depth = 1;
+			float weight = 0.0f;
+		};
+		std::vector<Entry> stack{{0, 0, 1, total}};
+		while (!stack.empty())
+		{
+			const Entry entry = stack.back();
+			stack.pop_back();
+			for (uint32_t quadrant = 0; quadrant < 4; quadrant++)
+			{
+				const float weight = entry.source != NO_NODE ? source.m_nodes[entry.source].sums[quadrant].load(std::memory_order_relaxed)
+															 : entry.weight * 0.25f;
+				if (entry.depth >= MAX_DIRECTIONAL_DEPTH || weight <= total * SUBDIVISION_THRESHOLD)
+					continue;
+
+				const uint32_t child = static_cast<uint32_t>(m_nodes.size());
+				m_nodes.emplace_back();
+				m_nodes[entry.node].children[quadrant] = child;
+
+				const uint32_t source_child = entry.source != NO_NODE ? source.m_nodes[entry.source].children[quadrant] : 0;
+				stack.push_back({source_child != 0 ? source_child : NO_NODE, child, entry.depth + 1, weight});
+			}
+		}
+	}
+
+	GuidingField::Region::Region(const Region &other)
+		: sampling(other.sampling), recording(other.recording), sample_count(other.sample_count.load(std::memory_order_relaxed))
+	{
+	}
+
+	void GuidingField::reset(const glm::vec3 &bounds_min, const glm::vec3 &bounds_max)
+	{
+		// A cube keeps the cyclic axis splits roughly isotropic
+		const glm::vec3 size = glm::max(bounds_max - bounds_min, glm::vec3(0.0f));
+		m_extent = std::max(std::max({size.x, size.y, size.z}) * 1.01f, 1e-3f);
+		m_origin = (bounds_min + bounds_max) * 0.5f - glm::vec3(m_extent * 0.5f);
+
+		m_nodes.assign(1, Node{});
+		m_regions.clear();
+		m_regions.emplace_back();
+		m_iteration = 0;
+		m_iteration_frames = 0;
+	}
+
+	const GuidingField::Region &GuidingField::lookup(const glm::vec3 &position) const
+	{
+		glm::vec3 point = glm::clamp((position - m_origin) / m_extent, 0.0f, ONE_MINUS_EPSILON);
+		uint32_t index = 0;
+		while (m_nodes[index].children[0] != 0)
+		{
+			const Node &node = m_nodes[index];
+			const uint32_t child = point[node.axis] >= 0.5f ? 1 : 0;
+			point[node.axis] = point[node.axis] * 2.0f - static_cast<float>(child);
+			index = node.children[child];
+		}
+		return m_regions[m_nodes[index].region];
+	}
+
+	void GuidingField::record(const Region &region, const glm::vec3 &direction, float radiance, float pdf)
+	{
+		// Every sample counts towards splitting the region, black ones included
+		region.sample_count.fetch_add(1, std::memory_order_relaxed);
+		const float weight = radiance / pdf;
+		if (pdf > 0.0f && weight > 0.0f && std::isfinite(weight))
+			region.recording.record(direction, weight);
+	}
+
+	void GuidingField::finish_frame()
+	{
+		if (!is_training() || m_nodes.empty())
+			return;
+		if (++m_iteration_frames < (1u << m_iteration))
+			return;
+		end_iteration();
+		m_iteration++;
+		m_iteration_frames = 0;
+	}
+
+	void GuidingField::end_iteration()
+	{
+		// Split crowded regions, both halves start from the distribution recorded for the whole region.
+		// Children are appended and visited by the same loop, so a region splits as often as its count allows
+		const float split_samples = SPATIAL_SPLIT_SAMPLES * std::sqrt(static_cast<float>(1u << m_iteration));
+		for (size_t n = 0; n < m_nodes.size() && m_regions.size() < MAX_REGIONS; n++)
+		{
+			if (m_nodes[n].children[0] != 0)
+				continue;
+			const uint32_t region = m_nodes[n].region;
+			const uint32_t sample_count = m_regions[region].sample_count.load(std::memory_order_relaxed);
+			if (static_cast<float>(sample_count) <= split_samples)
+				continue;
+
+			const uint32_t axis = (m_nodes[n].axis + 1) % 3;
+			const uint32_t first = static_cast<uint32_t>(m_nodes.size());
+			const Region half = m_regions[region];
+			m_regions.push_back(half);
+			m_regions[region].sample_count.store(sample_count / 2, std::memory_order_relaxed);
+			m_regions.back().sample_count.store(sample_count / 2, std::memory_order_relaxed);
+
+			Node child;
+			child.axis = axis;
+			child.region = region;
+			m_nodes.push_back(child);
+			child.region = static_cast<uint32_t>(m_regions.size() - 1);
+			m_nodes.push_back(child);
+			m_nodes[n].children = {first, first + 1};
+		}
+
+		for (Region &region : m_regions)
+		{
+			region.sampling = region.recording;
+			region.recording.refine_from(region.sampling);
+			region.sample_count.store(0, std::memory_order_relaxed);
+		}
+	}
+
+} // namespace render
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace render
+{
+
+	/// Incident radiance over the sphere of directions, learned from path samples.
+	/// A quadtree over the cylindrical (cos theta, phi) square, the mapping preserves area so the
+	/// solid angle pdf is the density on the square over 4 pi
+	class DirectionalTree
+	{
+	public:
+		DirectionalTree();
+
+		/// Adds weight to the leaf containing the direction and to its ancestors, lock-free
+		void record(const glm::vec3 &direction, float weight) const;
+
+		bool is_empty() const { return get_total() <= 0.0f; }
+
+		/// Direction with probability proportional to the recorded weight, uniform over the sphere while empty
+		glm::vec3 sample(glm::vec2 u) const;
+		float pdf(const glm::vec3 &direction) const;
+
+		/// Replaces this tree by the structure of source, subdivided where source recorded a large share of
+		/// its weight, with all weights cleared
+		void refine_from(const DirectionalTree &source);
+
+	private:
+		struct Node
+		{
+			Node();
+			Node(const Node &other);
+			Node &operator=(const Node &other);
+
+			// Weight recorded per quadrant, quadrant = x half + 2 * y half
+			mutable std::array<std::atomic<float>, 4> sums;
+			std::array<uint32_t, 4> children{}; // 0 = leaf quadrant, the root is never a child
+		};
+
+		float get_total() const;
+
+		std::vector<Node> m_nodes;
+	};
+
+	/// Spatial binary tree over the scene bounds, each region holds the directional distribution
+	/// of the radiance arriving there (Müller et al. 2017, "Practical Path Guiding").
+	/// Training runs in iterations of 2^k frames: paths sample the distribution of the previous
+	/// iteration and record into a fresh one, between iterations crowded regions are split and
+	/// directional trees refined. Recording is lock-free, the structure only changes in finish_frame()
+	class GuidingField
+	{
+	public:
+		struct Region
+		{
+			Region() = default;
+			Region(const Region &other);
+
+			DirectionalTree sampling;
+			DirectionalTree recording;
+			mutable std::atomic<uint32_t> sample_count{0};
+		};
+
+		/// Restarts training over an axis-aligned box
+		void reset(const glm::vec3 &bounds_min, const glm::vec3 &bounds_max);
+		bool is_initialized() const { return !m_nodes.empty(); }
+
+		const Region &lookup(const glm::vec3 &position) const;
+
+		/// Records the radiance arriving at a region from a direction sampled with the given pdf
+		static void record(const Region &region, const glm::vec3 &direction, float radiance, float pdf);
+
+		bool is_training() const { return m_iteration < TRAINING_ITERATIONS; }
+
+		/// Counts a rendered frame, ends the training iteration once it has 2^iteration frames
+		void finish_frame();
+
+	private:
+		void end_iteration();
+
+		// Sampling distributions stay fixed once 2^TRAINING_ITERATIONS - 1 frames have trained them
+		static constexpr uint32_t TRAINING_ITERATIONS = 10;
+
+		struct Node
+		{
+			uint32_t axis = 0;
+			std::array<uint32_t, 2> children{}; // 0 = leaf
+			uint32_t region = 0;
+		};
+
+		std::vector<Node> m_nodes;
+		std::vector<Region> m_regions;
+		glm::vec3 m_origin{0.0f};
+		float m_extent = 1.0f; // Edge of the cube enclosing the bounds
+
+		uint32_t m_iteration = 0;
+		uint32_t m_iteration_frames = 0;
+	};
+
+} // namespace render
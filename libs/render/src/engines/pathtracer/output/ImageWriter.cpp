@@ -0,0 +1,283 @@
+#include "ImageWriter.h"
+
+#include "render/Log.h"
+#include "utils/Math.h"
+
+#include <OpenImageIO/imageio.h>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+namespace render
+{
+	namespace
+	{
+		const char *const AOV_CHANNEL_NAMES[AOV_TYPE_COUNT][3] = {
+			{"albedo.R", "albedo.G", "albedo.B"},
+			{"normal.X", "normal.Y", "normal.Z"},
+			{"depth.Z"},
+			{"id"},
+			{"samples"},
+		};
+		const char *const COLOR_CHANNEL_NAMES[4] = {"R", "G", "B", "A"};
+
+		bool is_exr(const std::string &path)
+		{
+			std::string extension = std::filesystem::path(path).extension().string();
+			std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			return extension == ".exr";
+		}
+
+		// Images are written under a temporary name and renamed, so readers never see a partially written file
+		std::filesystem::path partial_path(const std::filesystem::path &path)
+		{
+			std::filesystem::path partial = path;
+			partial.replace_filename(path.stem().string() + ".partial" + path.extension().string());
+			return partial;
+		}
+
+		bool write_pixels(const std::string &path, const OIIO::ImageSpec &spec, OIIO::TypeDesc format, const void *pixels)
+		{
+			const std::filesystem::path partial = partial_path(path);
+			auto output = OIIO::ImageOutput::create(partial.string());
+			if (!output || !output->open(partial.string(), spec) || !output->write_image(format, pixels) || !output->close())
+			{
+				Log::error("Failed to write image {}: {}", path, output ? output->geterror() : OIIO::geterror());
+				return false;
+			}
+
+			std::error_code error;
+			std::filesystem::rename(partial, path, error);
+			if (error)
+			{
+				Log::error("Failed to replace image {}: {}", path, error.message());
+				return false;
+			}
+			return true;
+		}
+
+		/// Samples of pixel p, counted per pixel once a render region made them differ
+		float pixel_sample_count(const ImageSnapshot &snapshot, size_t p)
+		{
+			const std::vector<float> &sample_counts = snapshot.aov_planes[static_cast<uint32_t>(AOVType::SampleCount)];
+			return sample_counts.empty() ? static_cast<float>(snapshot.sample_count) : sample_counts[p];
+		}
+
+		float pixel_scale(const ImageSnapshot &snapshot, size_t p)
+		{
+			const float samples = pixel_sample_count(snapshot, p);
+			return samples > 0.0f ? 1.0f / samples : 0.0f;
+		}
+
+		bool write_exr(const std::string &path, const ImageOutputOptions &options, const ImageSnapshot &snapshot)
+		{
+			const size_t pixel_count = static_cast<size_t>(snapshot.width) * snapshot.height;
+
+			std::vector<std::string> channel_names;
+			for (uint32_t c = 0; c < snapshot.channels; c++)
+				channel_names.push_back(COLOR_CHANNEL_NAMES[c]);
+
+			uint32_t aov_mask = 0;
+			for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+			{
+				const AOVType type = static_cast<AOVType>(i);
+				// The sample count is derived, every other AOV needs accumulated planes
+				if (!(options.aov_mask & aov_bit(type)) || (type != AOVType::SampleCount && snapshot.aov_planes[i].empty()))
+					continue;
+				aov_mask |= aov_bit(type);
+				for (uint32_t c = 0; c < aov_channel_count(type); c++)
+					channel_names.push_back(aov_channel_name(type, c));
+			}
+
+			const size_t channel_count = channel_names.size();
+			const OIIO::TypeDesc format = options.pixel_type == ImagePixelType::Half ? OIIO::TypeDesc::HALF : OIIO::TypeDesc::FLOAT;
+			OIIO::ImageSpec spec(snapshot.width, snapshot.height, static_cast<int>(channel_count), format);
+			spec.channelnames = std::move(channel_names);
+			spec.attribute("compression", options.compression);
+			spec.attribute("render:samples", static_cast<int>(snapshot.sample_count));
+			if (options.tile_size > 0)
+			{
+				spec.tile_width = static_cast<int>(options.tile_size);
+				spec.tile_height = static_cast<int>(options.tile_size);
+			}
+
+			// Averaged, interleaved floats, OIIO converts to half while encoding
+			std::vector<float> pixels(pixel_count * channel_count);
+			for (size_t p = 0; p < pixel_count; p++)
+			{
+				float *out = pixels.data() + p * channel_count;
+				const float scale = pixel_scale(snapshot, p);
+				for (uint32_t c = 0; c < snapshot.channels; c++)
+					*out++ = snapshot.color[p * snapshot.channels + c] * scale;
+
+				for (uint32_t i = 0; i < AOV_TYPE_COUNT; i++)
+				{
+					const AOVType type = static_cast<AOVType>(i);
+					if (!(aov_mask & aov_bit(type)))
+						continue;
+					const std::vector<float> &planes = snapshot.aov_planes[i];
+					for (uint32_t c = 0; c < aov_channel_count(type); c++)
+					{
+						switch (type)
+						{
+						case AOVType::SampleCount:
+							*out++ = pixel_sample_count(snapshot, p);
+							break;
+						case AOVType::NodeID:
+							*out++ = planes[c * pixel_count + p];
+							break;
+						default:
+							*out++ = planes[c * pixel_count + p] * scale;
+							break;
+						}
+					}
+				}
+			}
+
+			return write_pixels(path, spec, OIIO::TypeDesc::FLOAT, pixels.data());
+		}
+
+		bool write_ldr(const std::string &path, const ImageSnapshot &snapshot)
+		{
+			const size_t pixel_count = static_cast<size_t>(snapshot.width) * snapshot.height;
+
+			auto to_byte = [](float linear) {
+				return static_cast<uint8_t>(std::clamp(Math::linearToSRGB(std::max(linear, 0.0f)), 0.0f, 1.0f) * 255.0f + 0.5f);
+			};
+
+			std::vector<uint8_t> pixels(pixel_count * 4);
+			for (size_t p = 0; p < pixel_count; p++)
+			{
+				const float *in = snapshot.color.data() + p * snapshot.channels;
+				const float scale = pixel_scale(snapshot, p);
+				pixels[p * 4 + 0] = to_byte(in[0] * scale);
+				pixels[p * 4 + 1] = to_byte(in[1] * scale);
+				pixels[p * 4 + 2] = to_byte(in[2] * scale);
+				// Alpha is linear coverage
+				const float alpha = snapshot.channels == 4 ? in[3] * scale : 1.0f;
+				pixels[p * 4 + 3] = static_cast<uint8_t>(std::clamp(alpha, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+
+			OIIO::ImageSpec spec(snapshot.width, snapshot.height, 4, OIIO::TypeDesc::UINT8);
+			spec.attribute("oiio:ColorSpace", "sRGB");
+			return write_pixels(path, spec, OIIO::TypeDesc::UINT8, pixels.data());
+		}
+	}
+
+	const char *aov_channel_name(AOVType type, uint32_t channel)
+	{
+		return AOV_CHANNEL_NAMES[static_cast<uint32_t>(type)][channel];
+	}
+
+	bool write_image_file(const std::string &path, const ImageOutputOptions &options, const ImageSnapshot &snapshot)
+	{
+		if (snapshot.sample_count == 0 || snapshot.width == 0 || snapshot.height == 0)
+		{
+			Log::error("Nothing rendered yet, not writing {}", path);
+			return false;
+		}
+		return is_exr(path) ? write_exr(path, options, snapshot) : write_ldr(path, snapshot);
+	}
+
+	ImageWriter::ImageWriter(uint32_t thread_count, uint32_t max_queued)
+		: m_max_queued(std::max(max_queued, 1u))
+	{
+		for (uint32_t i = 0; i < std::max(thread_count, 1u); i++)
+			m_threads.emplace_back(&ImageWriter::worker_loop, this);
+	}
+
+	ImageWriter::~ImageWriter()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = true;
+		}
+		m_work_cv.notify_all();
+		for (std::thread &thread : m_threads)
+			thread.join();
+	}
+
+	ImageSnapshot ImageWriter::acquire_snapshot()
+	{
+		std::lock_guard lock(m_mutex);
+		if (m_free_snapshots.empty())
+			return {};
+		ImageSnapshot snapshot = std::move(m_free_snapshots.back());
+		m_free_snapshots.pop_back();
+		return snapshot;
+	}
+
+	bool ImageWriter::is_full() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_pending >= m_max_queued;
+	}
+
+	void ImageWriter::submit(const std::string &path, const ImageOutputOptions &options, ImageSnapshot &&snapshot)
+	{
+		{
+			std::unique_lock lock(m_mutex);
+
+			// A write of the same path that has not started yet would be overwritten right away, replace its snapshot
+			auto queued = std::ranges::find(m_queue, path, &Job::path);
+			if (queued != m_queue.end())
+			{
+				std::swap(queued->snapshot, snapshot);
+				queued->options = options;
+				if (m_free_snapshots.size() < m_max_queued)
+					m_free_snapshots.push_back(std::move(snapshot));
+				return;
+			}
+
+			m_done_cv.wait(lock, [this] { return m_pending < m_max_queued; });
+			m_queue.push_back({path, options, std::move(snapshot)});
+			m_pending++;
+		}
+		m_work_cv.notify_one();
+	}
+
+	void ImageWriter::wait()
+	{
+		std::unique_lock lock(m_mutex);
+		m_done_cv.wait(lock, [this] { return m_pending == 0; });
+	}
+
+	std::deque<ImageWriter::Job>::iterator ImageWriter::find_ready_job()
+	{
+		return std::ranges::find_if(m_queue, [this](const Job &job) { return std::ranges::find(m_writing, job.path) == m_writing.end(); });
+	}
+
+	void ImageWriter::worker_loop()
+	{
+		std::unique_lock lock(m_mutex);
+		while (true)
+		{
+			// Queued writes are still finished on shutdown, a path being written waits for that write to finish
+			auto ready = m_queue.end();
+			m_work_cv.wait(lock, [&] {
+				ready = find_ready_job();
+				return ready != m_queue.end() || (m_stop && m_queue.empty());
+			});
+			if (ready == m_queue.end())
+				return;
+
+			Job job = std::move(*ready);
+			m_queue.erase(ready);
+			m_writing.push_back(job.path);
+			lock.unlock();
+
+			write_image_file(job.path, job.options, job.snapshot);
+
+			lock.lock();
+			m_writing.erase(std::ranges::find(m_writing, job.path));
+			// Keep the buffers for the next snapshot, one per queue slot is enough
+			if (m_free_snapshots.size() < m_max_queued)
+				m_free_snapshots.push_back(std::move(job.snapshot));
+			m_pending--;
+			m_done_cv.notify_all();
+			m_work_cv.notify_all();
+		}
+	}
+
+} // namespace render
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "render/Types.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace render
+{
+
+	/// Copy of the accumulation sums taken on the render thread, everything else happens on a writer thread
+	struct ImageSnapshot
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t channels = 0; // Color channels, see AccumulationLayout
+		uint32_t sample_count = 0;
+
+		std::vector<float> color;									 // Interleaved sums
+		std::array<std::vector<float>, AOV_TYPE_COUNT> aov_planes; // Channel-major sums, empty when not written
+																	 // SampleCount holds per-pixel counts whenever they differ
+	};
+
+	/// Channel name of an AOV in EXR files, e.g. "albedo.R"
+	const char *aov_channel_name(AOVType type, uint32_t channel);
+
+	/// Averages the sums and writes them, EXR keeps linear values and AOV layers, other formats get 8-bit sRGB
+	bool write_image_file(const std::string &path, const ImageOutputOptions &options, const ImageSnapshot &snapshot);
+
+	/// Small pool of threads encoding and writing snapshots, with recycled snapshot buffers
+	class ImageWriter
+	{
+	public:
+		explicit ImageWriter(uint32_t thread_count = 2, uint32_t max_queued = 4);
+		~ImageWriter(); // Finishes every queued write
+
+		ImageWriter(const ImageWriter &) = delete;
+		ImageWriter &operator=(const ImageWriter &) = delete;
+
+		/// Snapshot holding the buffers of an earlier write, so steady-state snapshots do not allocate
+		ImageSnapshot acquire_snapshot();
+
+		/// True when max_queued writes are pending, callers should skip the snapshot rather than wait
+		bool is_full() const;
+
+		/// Queues the write, blocks while the queue is full.
+		/// Writes of one path happen in submission order, a newer snapshot replaces one still waiting for the same path
+		void submit(const std::string &path, const ImageOutputOptions &options, ImageSnapshot &&snapshot);
+
+		/// Blocks until every queued image is written
+		void wait();
+
+	private:
+		struct Job
+		{
+			std::string path;
+			ImageOutputOptions options;
+			ImageSnapshot snapshot;
+		};
+
+		/// First queued job whose path no other thread is writing, end() when there is none
+		std::deque<Job>::iterator find_ready_job();
+		void worker_loop();
+
+	private:
+		const uint32_t m_max_queued;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_work_cv;
+		std::condition_variable m_done_cv;
+		std::deque<Job> m_queue;
+		uint32_t m_pending = 0;				// Queued or being written
+		std::vector<std::string> m_writing; // Paths of the writes in progress
+		std::vector<ImageSnapshot> m_free_snapshots;
+		bool m_stop = false;
+
+		std::vector<std::thread> m_threads;
+	};
+
+} // namespace render
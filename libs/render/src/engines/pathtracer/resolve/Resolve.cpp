@@ -0,0 +1,273 @@
+#include "Resolve.h"
+
+#include "utils/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Generates the resolve kernels for every SIMD target Highway supports and
+// dispatches to the best one for the running CPU.
+#undef HWY_TARGET_INCLUDE
+#define HWY_TARGET_INCLUDE "engines/pathtracer/resolve/Resolve.cpp" // this file
+#include <hwy/foreach_target.h>									   // must come before highway.h
+#include <hwy/highway.h>
+
+HWY_BEFORE_NAMESPACE();
+namespace render
+{
+	namespace HWY_NAMESPACE
+	{
+		namespace hn = hwy::HWY_NAMESPACE;
+
+		// color_scale includes the exposure, alpha_scale does not
+		template <class D, class V>
+		HWY_INLINE void LoadScaledColor(D d, const float *HWY_RESTRICT color, uint32_t channels, V color_scale, V alpha_scale, V &r, V &g, V &b,
+										V &a)
+		{
+			if (channels == 4)
+			{
+				hn::LoadInterleaved4(d, color, r, g, b, a);
+				a = hn::Mul(a, alpha_scale);
+			}
+			else
+			{
+				hn::LoadInterleaved3(d, color, r, g, b);
+				a = hn::Set(d, 1.0f);
+			}
+			r = hn::Mul(r, color_scale);
+			g = hn::Mul(g, color_scale);
+			b = hn::Mul(b, color_scale);
+		}
+
+		// Both kernels process whole vectors from begin and return where they stopped, the caller finishes the tail
+
+		size_t ResolveRGBA8(const float *HWY_RESTRICT color, uint32_t channels, size_t begin, size_t end, float scale, float exposure,
+							uint32_t *HWY_RESTRICT output)
+		{
+			const hn::ScalableTag<float> d;
+			const hn::RebindToSigned<decltype(d)> di;
+			const hn::RebindToUnsigned<decltype(d)> du;
+			const size_t lanes = hn::Lanes(d);
+
+			const auto color_scale = hn::Set(d, scale * exposure);
+			const auto alpha_scale = hn::Set(d, scale);
+			const auto zero = hn::Zero(d);
+			const auto one = hn::Set(d, 1.0f);
+			const auto max_byte = hn::Set(d, 255.0f);
+
+			// Clamp to [0,1] and truncate to a byte, same as the scalar path
+			auto to_byte = [&](auto v) { return hn::BitCast(du, hn::ConvertTo(di, hn::Mul(hn::Min(hn::Max(v, zero), one), max_byte))); };
+
+			size_t i = begin;
+			for (; i + lanes <= end; i += lanes)
+			{
+				hn::VFromD<decltype(d)> r, g, b, a;
+				LoadScaledColor(d, color + channels * i, channels, color_scale, alpha_scale, r, g, b, a);
+
+				const auto packed = hn::Or(hn::Or(hn::ShiftLeft<24>(to_byte(r)), hn::ShiftLeft<16>(to_byte(g))),
+										   hn::Or(hn::ShiftLeft<8>(to_byte(b)), to_byte(a)));
+				hn::StoreU(packed, du, output + i);
+			}
+			return i;
+		}
+
+		size_t ResolveRGBA16F(const float *HWY_RESTRICT color, uint32_t channels, size_t begin, size_t end, float scale, float exposure,
+							  uint16_t *HWY_RESTRICT output)
+		{
+			const hn::ScalableTag<float> d;
+			const hn::Rebind<hwy::float16_t, decltype(d)> dh;
+			const hn::RebindToUnsigned<decltype(dh)> du16;
+			const size_t lanes = hn::Lanes(d);
+
+			const auto color_scale = hn::Set(d, scale * exposure);
+			const auto alpha_scale = hn::Set(d, scale);
+
+			auto to_half_bits = [&](auto v) { return hn::BitCast(du16, hn::DemoteTo(dh, v)); };
+
+			size_t i = begin;
+			for (; i + lanes <= end; i += lanes)
+			{
+				hn::VFromD<decltype(d)> r, g, b, a;
+				LoadScaledColor(d, color + channels * i, channels, color_scale, alpha_scale, r, g, b, a);
+				hn::StoreInterleaved4(to_half_bits(r), to_half_bits(g), to_half_bits(b), to_half_bits(a), du16, output + 4 * i);
+			}
+			return i;
+		}
+
+	} // namespace HWY_NAMESPACE
+} // namespace render
+HWY_AFTER_NAMESPACE();
+
+#if HWY_ONCE
+
+namespace render
+{
+	HWY_EXPORT(ResolveRGBA8);
+	HWY_EXPORT(ResolveRGBA16F);
+
+	namespace
+	{
+		constexpr uint32_t PIXELS_PER_TASK = 16 * 1024;
+
+		inline uint32_t task_count(size_t pixel_count)
+		{
+			return static_cast<uint32_t>((pixel_count + PIXELS_PER_TASK - 1) / PIXELS_PER_TASK);
+		}
+
+		inline float scaled_channel(const ResolveInput &input, size_t pixel, uint32_t channel)
+		{
+			if (channel == 3 && input.channels == 3)
+				return 1.0f;
+			const float scale = channel == 3 ? input.scale : input.scale * input.exposure;
+			return input.color[input.channels * pixel + channel] * scale;
+		}
+	}
+
+	void resolve_rgba8(const ResolveInput &input, uint32_t *output, ThreadPool &thread_pool)
+	{
+		thread_pool.parallel_for(task_count(input.pixel_count), 1, [&](uint32_t task_begin, uint32_t task_end) {
+			const size_t begin = static_cast<size_t>(task_begin) * PIXELS_PER_TASK;
+			const size_t end = std::min(static_cast<size_t>(task_end) * PIXELS_PER_TASK, input.pixel_count);
+
+			size_t i = HWY_DYNAMIC_DISPATCH(ResolveRGBA8)(input.color, input.channels, begin, end, input.scale, input.exposure, output);
+			for (; i < end; i++)
+			{
+				auto to_byte = [&](uint32_t channel) { return (uint8_t)(std::clamp(scaled_channel(input, i, channel), 0.0f, 1.0f) * 255.0f); };
+				output[i] = (to_byte(0) << 24) | (to_byte(1) << 16) | (to_byte(2) << 8) | to_byte(3);
+			}
+		});
+	}
+
+	void resolve_rgba16f(const ResolveInput &input, uint16_t *output, ThreadPool &thread_pool)
+	{
+		thread_pool.parallel_for(task_count(input.pixel_count), 1, [&](uint32_t task_begin, uint32_t task_end) {
+			const size_t begin = static_cast<size_t>(task_begin) * PIXELS_PER_TASK;
+			const size_t end = std::min(static_cast<size_t>(task_end) * PIXELS_PER_TASK, input.pixel_count);
+
+			size_t i = HWY_DYNAMIC_DISPATCH(ResolveRGBA16F)(input.color, input.channels, begin, end, input.scale, input.exposure, output);
+			for (; i < end; i++)
+			{
+				for (uint32_t channel = 0; channel < 4; channel++)
+					output[4 * i + channel] = float_to_half(scaled_channel(input, i, channel));
+			}
+		});
+	}
+
+	float compute_auto_exposure(const ResolveInput &input, float target_luminance, ThreadPool &thread_pool)
+	{
+		// Per-task partial sums, added in task order so the result does not depend on scheduling
+		const uint32_t tasks = task_count(input.pixel_count);
+		std::vector<double> log_sums(tasks, 0.0);
+		thread_pool.parallel_for(tasks, 1, [&](uint32_t task_begin, uint32_t task_end) {
+			for (uint32_t task = task_begin; task < task_end; task++)
+			{
+				const size_t begin = static_cast<size_t>(task) * PIXELS_PER_TASK;
+				const size_t end = std::min(begin + PIXELS_PER_TASK, input.pixel_count);
+				double sum = 0.0;
+				for (size_t i = begin; i < end; i++)
+				{
+					const float *color = input.color + input.channels * i;
+					const float luminance = (0.2126f * color[0] + 0.7152f * color[1] + 0.0722f * color[2]) * input.scale;
+					// The offset keeps black pixels from sending the average to zero
+					sum += std::log(1e-4 + std::max(luminance, 0.0f));
+				}
+				log_sums[task] = sum;
+			}
+		});
+
+		if (input.pixel_count == 0)
+			return 1.0f;
+		double log_sum = 0.0;
+		for (double sum : log_sums)
+			log_sum += sum;
+		const double average = std::exp(log_sum / static_cast<double>(input.pixel_count));
+		return static_cast<float>(target_luminance / average);
+	}
+
+	void average_samples(const float *sums, uint32_t channels, const float *sample_counts, size_t pixel_count, float *output,
+						 ThreadPool &thread_pool)
+	{
+		thread_pool.parallel_for(task_count(pixel_count), 1, [&](uint32_t task_begin, uint32_t task_end) {
+			const size_t begin = static_cast<size_t>(task_begin) * PIXELS_PER_TASK;
+			const size_t end = std::min(static_cast<size_t>(task_end) * PIXELS_PER_TASK, pixel_count);
+			for (size_t i = begin; i < end; i++)
+			{
+				const float scale = sample_counts[i] > 0.0f ? 1.0f / sample_counts[i] : 0.0f;
+				for (uint32_t channel = 0; channel < channels; channel++)
+					output[channels * i + channel] = sums[channels * i + channel] * scale;
+			}
+		});
+	}
+
+	uint16_t float_to_half(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		const uint32_t sign = (bits >> 16) & 0x8000u;
+		const uint32_t magnitude = bits & 0x7fffffffu;
+
+		// Inf and NaN (keep NaN quiet)
+		if (magnitude >= 0x7f800000u)
+			return static_cast<uint16_t>(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u));
+
+		// Rounds to infinity, 65520 is halfway between the largest half and infinity
+		if (magnitude >= 0x477ff000u)
+			return static_cast<uint16_t>(sign | 0x7c00u);
+
+		// Half subnormals, below 2^-14
+		if (magnitude < 0x38800000u)
+		{
+			if (magnitude < 0x33000000u) // Below 2^-25, rounds to zero
+				return static_cast<uint16_t>(sign);
+
+			const uint32_t exponent = magnitude >> 23;
+			const uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+			const uint32_t shift = 126 - exponent;
+			uint32_t half = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (half & 1u)))
+				half++;
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		// Normals, rebias the exponent and round the dropped 13 mantissa bits
+		uint32_t half = (magnitude - 0x38000000u) >> 13;
+		const uint32_t remainder = magnitude & 0x1fffu;
+		if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+			half++;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	float half_to_float(uint16_t value)
+	{
+		const uint32_t sign = (static_cast<uint32_t>(value) & 0x8000u) << 16;
+		const uint32_t exponent = (value >> 10) & 0x1fu;
+		const uint32_t mantissa = value & 0x3ffu;
+
+		uint32_t bits;
+		if (exponent == 0)
+		{
+			const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+			return sign ? -magnitude : magnitude;
+		}
+		else if (exponent == 31)
+		{
+			bits = sign | 0x7f800000u | (mantissa << 13);
+		}
+		else
+		{
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		}
+
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+} // namespace render
+
+#endif // HWY_ONCE
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace render
+{
+
+	class ThreadPool;
+
+	/// Accumulated float sums to display/output formats
+	/// Input is interleaved RGB or RGBA (channels = 3 or 4), missing alpha resolves to 1
+	struct ResolveInput
+	{
+		const float *color = nullptr;
+		uint32_t channels = 4;
+		size_t pixel_count = 0;
+		float scale = 1.0f;	   // 1 / accumulated samples
+		float exposure = 1.0f; // Multiplies color after scale, alpha is left alone
+	};
+
+	/// Clamped, packed 8-bit RGBA (see rgba_to_uint32)
+	void resolve_rgba8(const ResolveInput &input, uint32_t *output, ThreadPool &thread_pool);
+
+	/// Unclamped half-float RGBA, 4 x uint16_t per pixel
+	void resolve_rgba16f(const ResolveInput &input, uint16_t *output, ThreadPool &thread_pool);
+
+	/// Exposure that maps the log-average luminance of the image to target_luminance (Reinhard et al. 2002 key value)
+	float compute_auto_exposure(const ResolveInput &input, float target_luminance, ThreadPool &thread_pool);
+
+	/// Divides each pixel's sums by its own sample count, for accumulations whose pixels differ (render regions)
+	/// The result resolves with scale 1, pixels without samples become 0. Channel-major planes average one channel at a time.
+	void average_samples(const float *sums, uint32_t channels, const float *sample_counts, size_t pixel_count, float *output,
+						 ThreadPool &thread_pool);
+
+	/// IEEE 754 binary16 conversion, round to nearest even
+	uint16_t float_to_half(float value);
+	float half_to_float(uint16_t value);
+
+} // namespace render
@@ -0,0 +1,101 @@
+#include "EfficiencyCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace render
+{
+	namespace
+	{
+		// Cells per axis of the cube enclosing the scene
+		constexpr uint32_t GRID_RESOLUTION = 32;
+
+		// Vertices a cell needs before its factor is trusted
+		constexpr uint64_t MIN_CELL_SAMPLES = 64;
+
+		// Bounds of q as in EARS, splitting more than 20 ways rarely pays off and q = 0 would be biased
+		constexpr float MIN_SPLITTING_FACTOR = 0.05f;
+		constexpr float MAX_SPLITTING_FACTOR = 20.0f;
+
+		uint32_t to_cell(float coordinate)
+		{
+			return std::min(static_cast<uint32_t>(std::max(coordinate, 0.0f)), GRID_RESOLUTION - 1);
+		}
+	}
+
+	void EfficiencyCache::reset(const glm::vec3 &bounds_min, const glm::vec3 &bounds_max)
+	{
+		const glm::vec3 size = glm::max(bounds_max - bounds_min, glm::vec3(0.0f));
+		const float extent = std::max(std::max({size.x, size.y, size.z}) * 1.01f, 1e-3f);
+		m_origin = (bounds_min + bounds_max) * 0.5f - glm::vec3(extent * 0.5f);
+		m_inverse_cell_size = static_cast<float>(GRID_RESOLUTION) / extent;
+
+		// Cells hold atomics, so the grid is replaced instead of assigned
+		m_cells = std::vector<Cell>(static_cast<size_t>(GRID_RESOLUTION) * GRID_RESOLUTION * GRID_RESOLUTION);
+		m_path_variance.store(0.0f, std::memory_order_relaxed);
+		m_path_cost.store(0.0f, std::memory_order_relaxed);
+		m_path_count.store(0, std::memory_order_relaxed);
+		m_path_variance_total = 0.0;
+		m_path_cost_total = 0.0;
+		m_path_count_total = 0;
+	}
+
+	uint32_t EfficiencyCache::lookup(const glm::vec3 &position) const
+	{
+		const glm::vec3 grid = (position - m_origin) * m_inverse_cell_size;
+		return (to_cell(grid.z) * GRID_RESOLUTION + to_cell(grid.y)) * GRID_RESOLUTION + to_cell(grid.x);
+	}
+
+	float EfficiencyCache::get_splitting_factor(uint32_t cell, float throughput) const
+	{
+		const float scale = m_cells[cell].factor_scale;
+		if (scale < 0.0f)
+			return 0.0f;
+		return std::clamp(throughput * scale, MIN_SPLITTING_FACTOR, MAX_SPLITTING_FACTOR);
+	}
+
+	void EfficiencyCache::record_vertex(uint32_t cell, float relative_second_moment, float cost) const
+	{
+		const Cell &target = m_cells[cell];
+		target.second_moment.fetch_add(relative_second_moment, std::memory_order_relaxed);
+		target.cost.fetch_add(cost, std::memory_order_relaxed);
+		target.count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void EfficiencyCache::record_paths(float relative_variance, float cost, uint32_t count) const
+	{
+		m_path_variance.fetch_add(relative_variance, std::memory_order_relaxed);
+		m_path_cost.fetch_add(cost, std::memory_order_relaxed);
+		m_path_count.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void EfficiencyCache::finish_frame()
+	{
+		if (m_cells.empty())
+			return;
+
+		m_path_variance_total += m_path_variance.exchange(0.0f, std::memory_order_relaxed);
+		m_path_cost_total += m_path_cost.exchange(0.0f, std::memory_order_relaxed);
+		m_path_count_total += m_path_count.exchange(0, std::memory_order_relaxed);
+
+		const double pixel_variance = m_path_count_total > 0 ? m_path_variance_total / static_cast<double>(m_path_count_total) : 0.0;
+		const double path_cost = m_path_count_total > 0 ? m_path_cost_total / static_cast<double>(m_path_count_total) : 0.0;
+		const bool has_image_estimate = pixel_variance > 0.0 && path_cost > 0.0;
+
+		for (Cell &cell : m_cells)
+		{
+			cell.second_moment_total += cell.second_moment.exchange(0.0f, std::memory_order_relaxed);
+			cell.cost_total += cell.cost.exchange(0.0f, std::memory_order_relaxed);
+			cell.count_total += cell.count.exchange(0, std::memory_order_relaxed);
+			if (!has_image_estimate || cell.count_total < MIN_CELL_SAMPLES)
+				continue;
+
+			// Every vertex traced at least its continuation ray, a region that only received black paths gets the smallest factor
+			const double count = static_cast<double>(cell.count_total);
+			const double second_moment = cell.second_moment_total / count;
+			const double cost = std::max(cell.cost_total / count, 1.0);
+			cell.factor_scale = static_cast<float>(std::sqrt(second_moment * path_cost / (pixel_variance * cost)));
+		}
+	}
+
+} // namespace render
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace render
+{
+
+	/// Per-region estimates for efficiency-aware Russian roulette and splitting (Rath et al. 2022, "EARS").
+	/// The factor minimizing variance times cost at a path vertex is
+	///   q = T * sqrt(M2(x) * C / (V * C(x)))
+	/// with T the vertex throughput, M2(x) the second moment of the radiance arriving at x relative to the pixel,
+	/// C(x) the rays traced after x, V the relative variance of a pixel sample and C the rays of a camera path.
+	/// Paths below q survive with probability q, paths above split into about q branches.
+	/// Regions are the cells of a uniform grid over the scene bounds. Paths record into per-frame atomic sums,
+	/// finish_frame() folds them into the factors the next frame reads
+	class EfficiencyCache
+	{
+	public:
+		/// Forgets every estimate, cells cover the cube enclosing the box
+		void reset(const glm::vec3 &bounds_min, const glm::vec3 &bounds_max);
+		bool is_initialized() const { return !m_cells.empty(); }
+
+		uint32_t lookup(const glm::vec3 &position) const;
+
+		/// Clamped factor of a vertex with the given throughput, 0 while the region has too few samples
+		float get_splitting_factor(uint32_t cell, float throughput) const;
+
+		/// A path vertex, relative second moment of the radiance it received and the rays traced after it
+		void record_vertex(uint32_t cell, float relative_second_moment, float cost) const;
+
+		/// Sums over camera paths of their squared error relative to the pixel estimate and their rays
+		void record_paths(float relative_variance, float cost, uint32_t count) const;
+
+		void finish_frame();
+
+	private:
+		struct Cell
+		{
+			// Recorded during the frame
+			mutable std::atomic<float> second_moment{0.0f};
+			mutable std::atomic<float> cost{0.0f};
+			mutable std::atomic<uint32_t> count{0};
+
+			// Every frame since the reset, in double as they grow without bound
+			double second_moment_total = 0.0;
+			double cost_total = 0.0;
+			uint64_t count_total = 0;
+
+			float factor_scale = -1.0f; // q / T, negative while unknown
+		};
+
+		std::vector<Cell> m_cells;
+		glm::vec3 m_origin{0.0f};
+		float m_inverse_cell_size = 1.0f;
+
+		mutable std::atomic<float> m_path_variance{0.0f};
+		mutable std::atomic<float> m_path_cost{0.0f};
+		mutable std::atomic<uint32_t> m_path_count{0};
+		double m_path_variance_total = 0.0;
+		double m_path_cost_total = 0.0;
+		uint64_t m_path_count_total = 0;
+	};
+
+} // namespace render
@@ -0,0 +1,326 @@
+#include "Sampler.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace render
+{
+	namespace
+	{
+		// ------------------------------------------------------------------
+		// Hashing helpers
+		// ------------------------------------------------------------------
+
+		inline uint32_t hash_u32(uint32_t x)
+		{
+			x ^= x >> 16;
+			x *= 0x7feb352dU;
+			x ^= x >> 15;
+			x *= 0x846ca68bU;
+			x ^= x >> 16;
+			return x;
+		}
+
+		inline uint32_t hash_combine(uint32_t seed, uint32_t value)
+		{
+			return seed ^ (hash_u32(value) + 0x9e3779b9U + (seed << 6) + (seed >> 2));
+		}
+
+		inline uint32_t reverse_bits(uint32_t x)
+		{
+			x = ((x >> 1) & 0x55555555U) | ((x & 0x55555555U) << 1);
+			x = ((x >> 2) & 0x33333333U) | ((x & 0x33333333U) << 2);
+			x = ((x >> 4) & 0x0F0F0F0FU) | ((x & 0x0F0F0F0FU) << 4);
+			x = ((x >> 8) & 0x00FF00FFU) | ((x & 0x00FF00FFU) << 8);
+			return (x >> 16) | (x << 16);
+		}
+
+		inline float to_unit_float(uint32_t x)
+		{
+			// Top 24 bits so the result is strictly below 1.0
+			return static_cast<float>(x >> 8) * 0x1p-24f;
+		}
+
+		// Laine-Karras style permutation, Burley 2020 "Practical Hash-based Owen Scrambling"
+		inline uint32_t laine_karras_permutation(uint32_t x, uint32_t seed)
+		{
+			x += seed;
+			x ^= x * 0x6c50b47cU;
+			x ^= x * 0xb82f1e52U;
+			x ^= x * 0xc7afe638U;
+			x ^= x * 0x8d22f6e6U;
+			return x;
+		}
+
+		inline uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed)
+		{
+			x = reverse_bits(x);
+			x = laine_karras_permutation(x, seed);
+			return reverse_bits(x);
+		}
+
+		// ------------------------------------------------------------------
+		// Sobol generator matrices (precomputed at compile time)
+		// ------------------------------------------------------------------
+
+		// Higher dimensions are padded (Burley 2020): every 1D or 2D draw shuffles the index by its own
+		// dimension seed and scrambles the first two Sobol dimensions, which form a (0,2)-sequence
+		constexpr uint32_t SOBOL_DIMENSIONS = 2;
+		constexpr uint32_t SOBOL_BITS = 32;
+
+		using SobolMatrices = std::array<std::array<uint32_t, SOBOL_BITS>, SOBOL_DIMENSIONS>;
+
+		constexpr SobolMatrices make_sobol_matrices()
+		{
+			// Dimension 0 is van der Corput, dimension 1 comes from the degree 1 primitive polynomial x + 1:
+			// v[0] = 1 and v[i] = v[i - 1] ^ (v[i - 1] >> 1)
+			SobolMatrices matrices{};
+			for (uint32_t bit = 0; bit < SOBOL_BITS; bit++)
+				matrices[0][bit] = 1U << (31 - bit);
+
+			auto &v = matrices[1];
+			v[0] = 1U << 31;
+			for (uint32_t i = 1; i < SOBOL_BITS; i++)
+				v[i] = v[i - 1] ^ (v[i - 1] >> 1);
+			return matrices;
+		}
+
+		constexpr SobolMatrices SOBOL_MATRICES = make_sobol_matrices();
+
+		inline uint32_t sobol(uint32_t index, uint32_t dim)
+		{
+			uint32_t result = 0;
+			for (uint32_t bit = 0; index != 0; index >>= 1, bit++)
+				result ^= (index & 1U) * SOBOL_MATRICES[dim][bit];
+			return result;
+		}
+
+		// ------------------------------------------------------------------
+		// Blue noise tile (precomputed once, void-and-cluster style ranking)
+		// ------------------------------------------------------------------
+
+		constexpr uint32_t BLUE_NOISE_SIZE = 64;
+		constexpr uint32_t BLUE_NOISE_MASK = BLUE_NOISE_SIZE - 1;
+
+		std::vector<float> generate_blue_noise_tile()
+		{
+			constexpr uint32_t size = BLUE_NOISE_SIZE;
+			constexpr uint32_t count = size * size;
+			constexpr float sigma = 1.9f;
+
+			// Toroidal gaussian energy kernel indexed by wrapped offset
+			std::vector<float> kernel(count);
+			for (uint32_t dy = 0; dy < size; dy++)
+			{
+				for (uint32_t dx = 0; dx < size; dx++)
+				{
+					const float wx = static_cast<float>(std::min(dx, size - dx));
+					const float wy = static_cast<float>(std::min(dy, size - dy));
+					kernel[dy * size + dx] = std::exp(-(wx * wx + wy * wy) / (2.0f * sigma * sigma));
+				}
+			}
+
+			// Tiny deterministic jitter breaks ties so the ranking doesn't degrade into a lattice
+			std::vector<float> energy(count);
+			for (uint32_t i = 0; i < count; i++)
+				energy[i] = to_unit_float(hash_u32(i)) * 1e-4f;
+
+			std::vector<uint8_t> occupied(count, 0);
+			std::vector<float> tile(count);
+
+			// Repeatedly insert into the largest void, the insertion order is the rank
+			for (uint32_t rank = 0; rank < count; rank++)
+			{
+				uint32_t best = 0;
+				float best_energy = std::numeric_limits<float>::max();
+				for (uint32_t i = 0; i < count; i++)
+				{
+					if (!occupied[i] && energy[i] < best_energy)
+					{
+						best_energy = energy[i];
+						best = i;
+					}
+				}
+
+				occupied[best] = 1;
+				tile[best] = (static_cast<float>(rank) + 0.5f) / static_cast<float>(count);
+
+				const uint32_t bx = best % size;
+				const uint32_t by = best / size;
+				for (uint32_t y = 0; y < size; y++)
+				{
+					const uint32_t ky = ((y - by) & BLUE_NOISE_MASK) * size;
+					for (uint32_t x = 0; x < size; x++)
+						energy[y * size + x] += kernel[ky + ((x - bx) & BLUE_NOISE_MASK)];
+				}
+			}
+
+			return tile;
+		}
+
+		const std::vector<float> &blue_noise_tile()
+		{
+			static const std::vector<float> tile = generate_blue_noise_tile();
+			return tile;
+		}
+
+		// ------------------------------------------------------------------
+		// Sampler implementations
+		// ------------------------------------------------------------------
+
+		/// Purely random samples from a per-path PCG hash
+		class IndependentSampler : public Sampler
+		{
+		public:
+			explicit IndependentSampler(uint32_t seed) : m_seed(seed) {}
+
+			SamplerType get_type() const override { return SamplerType::Independent; }
+
+			void start_pixel_sample(SamplerState &state, uint32_t x, uint32_t y, uint32_t sample_index) const override
+			{
+				state.pixel_x = x;
+				state.pixel_y = y;
+				state.sample_index = sample_index;
+				state.dimension = 0;
+				state.pixel_seed = hash_combine(hash_combine(m_seed, x), y);
+				state.rng_state = hash_combine(state.pixel_seed, sample_index);
+			}
+
+			float get_1d(SamplerState &state) const override
+			{
+				state.dimension++;
+				return next_float(state.rng_state);
+			}
+
+			glm::vec2 get_2d(SamplerState &state) const override
+			{
+				state.dimension += 2;
+				const float u = next_float(state.rng_state);
+				return glm::vec2(u, next_float(state.rng_state));
+			}
+
+		private:
+			static float next_float(uint32_t &state)
+			{
+				state = state * 747796405U + 2891336453U;
+				uint32_t result = ((state >> ((state >> 28) + 4)) ^ state) * 277803737U;
+				result = (result >> 22) ^ result;
+				return to_unit_float(result);
+			}
+
+			uint32_t m_seed;
+		};
+
+		/// Owen-scrambled Sobol, padded per dimension pair by shuffling the sample index
+		class SobolSampler : public Sampler
+		{
+		public:
+			explicit SobolSampler(uint32_t seed) : m_seed(seed) {}
+
+			SamplerType get_type() const override { return SamplerType::Sobol; }
+
+			void start_pixel_sample(SamplerState &state, uint32_t x, uint32_t y, uint32_t sample_index) const override
+			{
+				state.pixel_x = x;
+				state.pixel_y = y;
+				state.sample_index = sample_index;
+				state.dimension = 0;
+				state.pixel_seed = hash_combine(hash_combine(m_seed, x), y);
+			}
+
+			float get_1d(SamplerState &state) const override
+			{
+				const uint32_t dim_seed = hash_combine(state.pixel_seed, state.dimension++);
+				const uint32_t index = nested_uniform_scramble(state.sample_index, dim_seed);
+				return to_unit_float(nested_uniform_scramble(sobol(index, 0), hash_u32(dim_seed)));
+			}
+
+			glm::vec2 get_2d(SamplerState &state) const override
+			{
+				const uint32_t dim_seed = hash_combine(state.pixel_seed, state.dimension);
+				state.dimension += 2;
+				const uint32_t index = nested_uniform_scramble(state.sample_index, dim_seed);
+				return glm::vec2(
+					to_unit_float(nested_uniform_scramble(sobol(index, 0), hash_combine(dim_seed, 0))),
+					to_unit_float(nested_uniform_scramble(sobol(index, 1), hash_combine(dim_seed, 1))));
+			}
+
+		private:
+			uint32_t m_seed;
+		};
+
+		/// One Owen-scrambled Sobol sequence shared by every pixel, decorrelated per pixel
+		/// by a toroidal shift taken from a blue noise tile. Error is pushed to high frequencies.
+		class BlueNoiseSampler : public Sampler
+		{
+		public:
+			explicit BlueNoiseSampler(uint32_t seed) : m_seed(seed), m_tile(blue_noise_tile()) {}
+
+			SamplerType get_type() const override { return SamplerType::BlueNoise; }
+
+			void start_pixel_sample(SamplerState &state, uint32_t x, uint32_t y, uint32_t sample_index) const override
+			{
+				state.pixel_x = x;
+				state.pixel_y = y;
+				state.sample_index = sample_index;
+				state.dimension = 0;
+				state.pixel_seed = 0;
+			}
+
+			float get_1d(SamplerState &state) const override
+			{
+				const uint32_t dim = state.dimension++;
+				const uint32_t dim_seed = hash_combine(m_seed, dim);
+				const uint32_t index = nested_uniform_scramble(state.sample_index, dim_seed);
+				const float value = to_unit_float(nested_uniform_scramble(sobol(index, 0), hash_u32(dim_seed)));
+				return wrap(value + dither(state, dim));
+			}
+
+			glm::vec2 get_2d(SamplerState &state) const override
+			{
+				const uint32_t dim = state.dimension;
+				state.dimension += 2;
+				const uint32_t dim_seed = hash_combine(m_seed, dim);
+				const uint32_t index = nested_uniform_scramble(state.sample_index, dim_seed);
+				const float u = to_unit_float(nested_uniform_scramble(sobol(index, 0), hash_combine(dim_seed, 0)));
+				const float v = to_unit_float(nested_uniform_scramble(sobol(index, 1), hash_combine(dim_seed, 1)));
+				return glm::vec2(wrap(u + dither(state, dim)), wrap(v + dither(state, dim + 1)));
+			}
+
+		private:
+			float dither(const SamplerState &state, uint32_t dim) const
+			{
+				// Each dimension reads the tile at a different toroidal offset
+				const uint32_t shift = hash_u32(dim + 1);
+				const uint32_t x = (state.pixel_x + shift) & BLUE_NOISE_MASK;
+				const uint32_t y = (state.pixel_y + (shift >> 8)) & BLUE_NOISE_MASK;
+				return m_tile[y * BLUE_NOISE_SIZE + x];
+			}
+
+			static float wrap(float value)
+			{
+				return value >= 1.0f ? value - 1.0f : value;
+			}
+
+			uint32_t m_seed;
+			const std::vector<float> &m_tile;
+		};
+	}
+
+	std::unique_ptr<Sampler> Sampler::create(SamplerType type, uint32_t seed)
+	{
+		switch (type)
+		{
+		case SamplerType::Independent:
+			return std::make_unique<IndependentSampler>(seed);
+		case SamplerType::Sobol:
+			return std::make_unique<SobolSampler>(seed);
+		case SamplerType::BlueNoise:
+			return std::make_unique<BlueNoiseSampler>(seed);
+		}
+		return std::make_unique<IndependentSampler>(seed);
+	}
+
+} // namespace render
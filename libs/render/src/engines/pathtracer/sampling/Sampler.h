@@ -0,0 +1,79 @@
+#pragma once
+
+#include "render/Types.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+
+namespace render
+{
+
+	/// Per-path sampler state, lives on the stack of the tracing thread.
+	/// Samplers themselves are immutable so one instance can be shared by all threads.
+	struct SamplerState
+	{
+		uint32_t pixel_x = 0;
+		uint32_t pixel_y = 0;
+		uint32_t sample_index = 0;
+		uint32_t dimension = 0;
+		uint32_t pixel_seed = 0;
+		uint32_t rng_state = 0; // Only used by the independent sampler
+	};
+
+	/// Fixed dimension layout so each bounce draws from its own dimensions
+	/// of the sequence regardless of how many samples earlier bounces used.
+	namespace SampleDimension
+	{
+		constexpr uint32_t CAMERA_LENS = 0; // 2D, thin lens aperture
+		constexpr uint32_t FIRST_BOUNCE = 2;
+
+		// Offsets within a bounce
+		constexpr uint32_t BOUNCE_DIRECTION = 0; // 2D
+		constexpr uint32_t RUSSIAN_ROULETTE = 2; // 1D
+		constexpr uint32_t GUIDING = 3;			 // 1D, picks guided or BSDF sampling
+		constexpr uint32_t PER_BOUNCE = 4;
+
+		inline uint32_t for_bounce(uint32_t bounce, uint32_t offset) { return FIRST_BOUNCE + bounce * PER_BOUNCE + offset; }
+
+		/// Added to the dimensions of a split path branch. Hashed, so nested splits never share dimensions
+		/// with each other or with the unsplit path, which adds 0
+		inline uint32_t for_branch(uint32_t parent_offset, uint32_t bounce, uint32_t branch)
+		{
+			uint32_t hash = parent_offset ^ (bounce * 0x9E3779B9u) ^ (branch * 0x85EBCA6Bu);
+			hash ^= hash >> 16;
+			hash *= 0x7FEB352Du;
+			hash ^= hash >> 15;
+			return hash | 0x100u; // Never near 0, where the unsplit path's dimensions are
+		}
+	}
+
+	/// Pluggable sample generator interface
+	/// Implementations map (pixel, sample index, dimension) to a value in [0,1)
+	class Sampler
+	{
+	public:
+		virtual ~Sampler() = default;
+
+		virtual SamplerType get_type() const = 0;
+
+		virtual void start_pixel_sample(SamplerState &state, uint32_t x, uint32_t y, uint32_t sample_index) const = 0;
+		virtual float get_1d(SamplerState &state) const = 0;
+		virtual glm::vec2 get_2d(SamplerState &state) const = 0;
+
+		static void set_dimension(SamplerState &state, uint32_t dimension) { state.dimension = dimension; }
+
+		/// State for a path branch split off the path of state, which draws from dimensions shifted by
+		/// SampleDimension::for_branch. The independent sampler ignores dimensions, its stream is reseeded instead
+		static SamplerState start_branch(const SamplerState &state, uint32_t dimension_offset)
+		{
+			SamplerState branch = state;
+			branch.rng_state = (state.rng_state ^ dimension_offset) * 0x2C1B3C6Du;
+			return branch;
+		}
+
+		static std::unique_ptr<Sampler> create(SamplerType type, uint32_t seed = 0);
+	};
+
+} // namespace render
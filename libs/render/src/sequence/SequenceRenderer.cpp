@@ -0,0 +1,96 @@
+#include "render/SequenceRenderer.h"
+
+#include "render/Log.h"
+
+#include "render_assert.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+
+namespace render
+{
+	namespace
+	{
+		double seconds_since(std::chrono::steady_clock::time_point start)
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	void SequenceRenderer::render(const std::vector<SequenceFrame> &frames, const SequenceOptions &options)
+	{
+		verify(m_path_tracer.get_scene() != nullptr, "Scene not set before rendering a sequence");
+
+		m_frame_stats.clear();
+		m_frame_stats.reserve(frames.size());
+		if (frames.empty())
+			return;
+
+		const uint32_t samples = std::max(options.samples_per_frame, 1u);
+
+		apply_frame(frames[0]);
+		m_path_tracer.update_scene_async();
+
+		for (uint32_t frame = 0; frame < frames.size(); frame++)
+		{
+			SequenceFrameStats stats;
+			stats.frame = frame;
+
+			// The first pass waits for the BVH update started during the previous frame's output
+			auto start = std::chrono::steady_clock::now();
+			for (uint32_t sample = 0; sample < samples; sample++)
+				m_path_tracer.render();
+			stats.render_seconds = seconds_since(start);
+
+			const PathTracer::SceneUpdateStats scene_update = m_path_tracer.get_last_scene_update();
+			stats.build_seconds = scene_update.build_seconds;
+			stats.build_wait_seconds = std::min(scene_update.wait_seconds, scene_update.build_seconds);
+			stats.refit = scene_update.refit;
+
+			// Start the next frame's BVH update, it only touches Embree and overlaps the resolve and output below
+			if (frame + 1 < frames.size())
+			{
+				apply_frame(frames[frame + 1]);
+				m_path_tracer.update_scene_async();
+			}
+
+			start = std::chrono::steady_clock::now();
+			const PathTracer::RenderResult &result = m_path_tracer.get_render_result();
+			if (!options.output_pattern.empty())
+				m_path_tracer.write_image(format_frame_path(options.output_pattern, frame), options.image_options);
+			stats.output_seconds = seconds_since(start);
+
+			Log::info("Frame {}: {} {:.2f} ms ({:.2f} ms overlapped), render {:.2f} ms, output {:.2f} ms", frame, stats.refit ? "refit" : "build",
+					  stats.build_seconds * 1e3, (stats.build_seconds - stats.build_wait_seconds) * 1e3, stats.render_seconds * 1e3,
+					  stats.output_seconds * 1e3);
+
+			m_frame_stats.push_back(stats);
+			if (m_frame_callback)
+				m_frame_callback(stats, result);
+		}
+
+		m_path_tracer.wait_for_image_writes();
+	}
+
+	std::string SequenceRenderer::format_frame_path(const std::string &pattern, uint32_t frame)
+	{
+		const size_t first = pattern.find('#');
+		if (first == std::string::npos)
+			return pattern;
+		const size_t last = pattern.find_first_not_of('#', first);
+		const size_t width = (last == std::string::npos ? pattern.size() : last) - first;
+		return pattern.substr(0, first) + std::format("{:0{}}", frame, width) + pattern.substr(first + width);
+	}
+
+	void SequenceRenderer::apply_frame(const SequenceFrame &frame)
+	{
+		Scene &scene = *m_path_tracer.get_scene();
+		for (const NodeTransform &node_transform : frame.transforms)
+		{
+			if (!scene.SetNodeTransform(node_transform.node, node_transform.transform))
+				Log::warn("Sequence frame moves unknown node {}", node_transform.node);
+		}
+	}
+
+} // namespace render
@@ -1,13 +1,19 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RENDER_MATH_SSE 1
+#endif
+
 namespace render {
 
-#if 0 // Placeholder - shared math utilities
     /// Shared mathematical utilities for rendering
-    /// Contains common math functions used across different rendering techniques
+    /// Scalar, inlined versions used per path; batched SIMD versions are in MathBatch.h
     namespace Math {
 
         // Constants
@@ -16,28 +22,159 @@ namespace render {
         constexpr float INV_PI = 0.31830988618f;
         constexpr float EPSILON = 1e-6f;
 
+        // Cody-Waite split of pi/2 for argument reduction, the first two parts are exact in float
+        constexpr float PI_OVER_2_HI = 1.5703125f;
+        constexpr float PI_OVER_2_MID = 4.837512969970703125e-4f;
+        constexpr float PI_OVER_2_LO = 7.54978995489188216e-8f;
+        constexpr float TWO_OVER_PI = 0.636619772367581343f;
+
+        // Minimax polynomials on [-pi/4, pi/4] (Cephes sinf/cosf)
+        constexpr float SIN_C1 = -1.6666654611e-1f;
+        constexpr float SIN_C2 = 8.3321608736e-3f;
+        constexpr float SIN_C3 = -1.9515295891e-4f;
+        constexpr float COS_C1 = 4.166664568298827e-2f;
+        constexpr float COS_C2 = -1.388731625493765e-3f;
+        constexpr float COS_C3 = 2.443315711809948e-5f;
+
+        /// 1/sqrt(x) from the hardware estimate plus one Newton-Raphson step, ~3e-7 relative error
+        inline float fastRsqrt(float x) {
+#ifdef RENDER_MATH_SSE
+            const float estimate = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+            return estimate * (1.5f - 0.5f * x * estimate * estimate);
+#else
+            return 1.0f / std::sqrt(x);
+#endif
+        }
+
+        inline glm::vec3 fastNormalize(const glm::vec3& v) {
+            return v * fastRsqrt(glm::dot(v, v));
+        }
+
+        /// Polynomial sine and cosine, ~1 ulp for |x| up to a few thousand
+        inline void sincos(float x, float& s, float& c) {
+            const float j = std::floor(x * TWO_OVER_PI + 0.5f);
+            const int32_t quadrant = static_cast<int32_t>(j);
+
+            float r = x - j * PI_OVER_2_HI;
+            r -= j * PI_OVER_2_MID;
+            r -= j * PI_OVER_2_LO;
+            const float r2 = r * r;
+
+            const float sin_r = r + r * r2 * (SIN_C1 + r2 * (SIN_C2 + r2 * SIN_C3));
+            const float cos_r = 1.0f - 0.5f * r2 + r2 * r2 * (COS_C1 + r2 * (COS_C2 + r2 * COS_C3));
+
+            // Odd quadrants swap sine and cosine, signs follow the quadrant
+            const bool swap = (quadrant & 1) != 0;
+            s = swap ? cos_r : sin_r;
+            c = swap ? sin_r : cos_r;
+            if (quadrant & 2)
+                s = -s;
+            if ((quadrant + 1) & 2)
+                c = -c;
+        }
+
         // Vector utilities
-        glm::vec3 reflect(const glm::vec3& incident, const glm::vec3& normal);
-        glm::vec3 refract(const glm::vec3& incident, const glm::vec3& normal, float eta);
-        glm::vec3 faceForward(const glm::vec3& n, const glm::vec3& i);
+        inline glm::vec3 reflect(const glm::vec3& incident, const glm::vec3& normal) {
+            return incident - 2.0f * glm::dot(incident, normal) * normal;
+        }
+
+        /// Returns false on total internal reflection
+        inline bool refract(const glm::vec3& incident, const glm::vec3& normal, float eta, glm::vec3& refracted) {
+            const float cos_i = -glm::dot(incident, normal);
+            const float k = 1.0f - eta * eta * (1.0f - cos_i * cos_i);
+            if (k < 0.0f)
+                return false;
+            refracted = eta * incident + (eta * cos_i - std::sqrt(k)) * normal;
+            return true;
+        }
 
-        // Coordinate system construction
-        void buildOrthonormalBasis(const glm::vec3& n, glm::vec3& tangent, glm::vec3& bitangent);
-        glm::mat3 tangentToWorld(const glm::vec3& normal);
+        inline glm::vec3 faceForward(const glm::vec3& n, const glm::vec3& i) {
+            return glm::dot(n, i) < 0.0f ? n : -n;
+        }
+
+        /// Branchless orthonormal basis around a unit normal (Duff et al. 2017)
+        inline void buildOrthonormalBasis(const glm::vec3& n, glm::vec3& tangent, glm::vec3& bitangent) {
+            const float sign = std::copysign(1.0f, n.z);
+            const float a = -1.0f / (sign + n.z);
+            const float b = n.x * n.y * a;
+            tangent = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+            bitangent = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+        }
+
+        inline glm::mat3 tangentToWorld(const glm::vec3& normal) {
+            glm::vec3 tangent, bitangent;
+            buildOrthonormalBasis(normal, tangent, bitangent);
+            return glm::mat3(tangent, bitangent, normal);
+        }
+
+        /// Cosine-weighted direction around a unit normal, u.x maps to cos^2(theta), u.y to phi
+        inline glm::vec3 sampleCosineHemisphere(const glm::vec3& normal, const glm::vec2& u) {
+            const float cos_theta = std::sqrt(u.x);
+            const float sin_theta = std::sqrt(std::max(0.0f, 1.0f - u.x));
+            float sin_phi, cos_phi;
+            sincos(TWO_PI * u.y, sin_phi, cos_phi);
+
+            glm::vec3 tangent, bitangent;
+            buildOrthonormalBasis(normal, tangent, bitangent);
+            return (sin_theta * cos_phi) * tangent + (sin_theta * sin_phi) * bitangent + cos_theta * normal;
+        }
 
         // Color space conversions
-        glm::vec3 linearToSRGB(const glm::vec3& linear);
-        glm::vec3 sRGBToLinear(const glm::vec3& srgb);
+        inline float linearToSRGB(float linear) {
+            return linear <= 0.0031308f ? 12.92f * linear : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+        }
+
+        inline float sRGBToLinear(float srgb) {
+            return srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+        }
+
+        inline glm::vec3 linearToSRGB(const glm::vec3& linear) {
+            return glm::vec3(linearToSRGB(linear.x), linearToSRGB(linear.y), linearToSRGB(linear.z));
+        }
+
+        inline glm::vec3 sRGBToLinear(const glm::vec3& srgb) {
+            return glm::vec3(sRGBToLinear(srgb.x), sRGBToLinear(srgb.y), sRGBToLinear(srgb.z));
+        }
 
         // Tonemapping operators
-        glm::vec3 acesTonemap(const glm::vec3& hdr, float exposure = 1.0f);
-        glm::vec3 reinhardTonemap(const glm::vec3& hdr, float exposure = 1.0f);
+        /// Narkowicz's ACES filmic fit, per channel
+        inline float acesTonemap(float x) {
+            return std::clamp((x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f), 0.0f, 1.0f);
+        }
+
+        inline glm::vec3 acesTonemap(const glm::vec3& hdr, float exposure = 1.0f) {
+            const glm::vec3 x = hdr * exposure;
+            return glm::vec3(acesTonemap(x.x), acesTonemap(x.y), acesTonemap(x.z));
+        }
+
+        inline glm::vec3 reinhardTonemap(const glm::vec3& hdr, float exposure = 1.0f) {
+            const glm::vec3 x = hdr * exposure;
+            return x / (x + 1.0f);
+        }
 
         // Utility functions
-        float luminance(const glm::vec3& color);
-        float schlickFresnel(float cosTheta, float f0);
-        bool solveQuadratic(float a, float b, float c, float& t0, float& t1);
+        inline float luminance(const glm::vec3& color) {
+            return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+        }
+
+        inline float schlickFresnel(float cosTheta, float f0) {
+            const float m = std::clamp(1.0f - cosTheta, 0.0f, 1.0f);
+            const float m2 = m * m;
+            return f0 + (1.0f - f0) * m2 * m2 * m;
+        }
+
+        /// Real roots of a*t^2 + b*t + c with t0 <= t1, numerically stable form
+        inline bool solveQuadratic(float a, float b, float c, float& t0, float& t1) {
+            const float discriminant = b * b - 4.0f * a * c;
+            if (discriminant < 0.0f)
+                return false;
+            const float q = -0.5f * (b + std::copysign(std::sqrt(discriminant), b));
+            t0 = q / a;
+            t1 = c / q;
+            if (t0 > t1)
+                std::swap(t0, t1);
+            return true;
+        }
     }
-#endif
 
-}
\ No newline at end of file
+}
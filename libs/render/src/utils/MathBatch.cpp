@@ -0,0 +1,270 @@
+#include "MathBatch.h"
+#include "Math.h"
+
+#include <algorithm>
+
+// Generates the batch kernels for every SIMD target Highway supports and
+// dispatches to the best one for the running CPU.
+#undef HWY_TARGET_INCLUDE
+#define HWY_TARGET_INCLUDE "utils/MathBatch.cpp" // this file
+#include <hwy/foreach_target.h>					 // must come before highway.h
+#include <hwy/highway.h>
+
+HWY_BEFORE_NAMESPACE();
+namespace render
+{
+	namespace HWY_NAMESPACE
+	{
+		namespace hn = hwy::HWY_NAMESPACE;
+
+		// Vector ports of the Math.h kernels, kept operation for operation identical to the scalar code
+
+		template <class D, class V = hn::VFromD<D>>
+		HWY_INLINE V FastRsqrt(D d, V x)
+		{
+			const V estimate = hn::ApproximateReciprocalSqrt(x);
+			const V half_x = hn::Mul(hn::Set(d, 0.5f), x);
+			return hn::Mul(estimate, hn::NegMulAdd(hn::Mul(half_x, estimate), estimate, hn::Set(d, 1.5f)));
+		}
+
+		template <class D, class V = hn::VFromD<D>>
+		HWY_INLINE void SinCos(D d, V x, V &s, V &c)
+		{
+			const hn::RebindToSigned<D> di;
+
+			const V j = hn::Floor(hn::MulAdd(x, hn::Set(d, Math::TWO_OVER_PI), hn::Set(d, 0.5f)));
+			const auto quadrant = hn::ConvertTo(di, j);
+
+			V r = hn::NegMulAdd(j, hn::Set(d, Math::PI_OVER_2_HI), x);
+			r = hn::NegMulAdd(j, hn::Set(d, Math::PI_OVER_2_MID), r);
+			r = hn::NegMulAdd(j, hn::Set(d, Math::PI_OVER_2_LO), r);
+			const V r2 = hn::Mul(r, r);
+
+			V sin_poly = hn::MulAdd(r2, hn::Set(d, Math::SIN_C3), hn::Set(d, Math::SIN_C2));
+			sin_poly = hn::MulAdd(r2, sin_poly, hn::Set(d, Math::SIN_C1));
+			const V sin_r = hn::MulAdd(hn::Mul(r, r2), sin_poly, r);
+
+			V cos_poly = hn::MulAdd(r2, hn::Set(d, Math::COS_C3), hn::Set(d, Math::COS_C2));
+			cos_poly = hn::MulAdd(r2, cos_poly, hn::Set(d, Math::COS_C1));
+			const V cos_r = hn::MulAdd(hn::Mul(r2, r2), cos_poly, hn::NegMulAdd(hn::Set(d, 0.5f), r2, hn::Set(d, 1.0f)));
+
+			// Odd quadrants swap, bit 1 of the quadrant moves into the sign bit
+			const auto swap = hn::RebindMask(d, hn::Ne(hn::And(quadrant, hn::Set(di, 1)), hn::Zero(di)));
+			const V sin_sign = hn::BitCast(d, hn::ShiftLeft<30>(hn::And(quadrant, hn::Set(di, 2))));
+			const V cos_sign = hn::BitCast(d, hn::ShiftLeft<30>(hn::And(hn::Add(quadrant, hn::Set(di, 1)), hn::Set(di, 2))));
+			s = hn::Xor(hn::IfThenElse(swap, cos_r, sin_r), sin_sign);
+			c = hn::Xor(hn::IfThenElse(swap, sin_r, cos_r), cos_sign);
+		}
+
+		template <class D, class V = hn::VFromD<D>>
+		HWY_INLINE void OrthonormalBasis(D d, V nx, V ny, V nz, V &tx, V &ty, V &tz, V &bx, V &by, V &bz)
+		{
+			const V one = hn::Set(d, 1.0f);
+			const V sign = hn::CopySign(one, nz);
+			const V a = hn::Neg(hn::Div(one, hn::Add(sign, nz)));
+			const V b = hn::Mul(hn::Mul(nx, ny), a);
+			tx = hn::MulAdd(hn::Mul(sign, hn::Mul(nx, nx)), a, one);
+			ty = hn::Mul(sign, b);
+			tz = hn::Neg(hn::Mul(sign, nx));
+			bx = b;
+			by = hn::MulAdd(hn::Mul(ny, ny), a, sign);
+			bz = hn::Neg(ny);
+		}
+
+		void FastRsqrtBatch(const float *HWY_RESTRICT x, float *HWY_RESTRICT result, size_t count)
+		{
+			const hn::ScalableTag<float> d;
+			const size_t lanes = hn::Lanes(d);
+			for (size_t i = 0; i < count; i += lanes)
+			{
+				const size_t n = std::min(lanes, count - i);
+				hn::StoreN(FastRsqrt(d, hn::LoadN(d, x + i, n)), d, result + i, n);
+			}
+		}
+
+		void SinCosBatch(const float *x, float *s, float *c, size_t count)
+		{
+			const hn::ScalableTag<float> d;
+			const size_t lanes = hn::Lanes(d);
+			for (size_t i = 0; i < count; i += lanes)
+			{
+				const size_t n = std::min(lanes, count - i);
+				hn::VFromD<decltype(d)> sin_v, cos_v;
+				SinCos(d, hn::LoadN(d, x + i, n), sin_v, cos_v);
+				hn::StoreN(sin_v, d, s + i, n);
+				hn::StoreN(cos_v, d, c + i, n);
+			}
+		}
+
+		void OrthonormalBasisBatch(Math::ConstVec3Streams normals, Math::Vec3Streams tangents, Math::Vec3Streams bitangents, size_t count)
+		{
+			const hn::ScalableTag<float> d;
+			const size_t lanes = hn::Lanes(d);
+			for (size_t i = 0; i < count; i += lanes)
+			{
+				const size_t n = std::min(lanes, count - i);
+				hn::VFromD<decltype(d)> tx, ty, tz, bx, by, bz;
+				OrthonormalBasis(d, hn::LoadN(d, normals.x + i, n), hn::LoadN(d, normals.y + i, n), hn::LoadN(d, normals.z + i, n),
+								 tx, ty, tz, bx, by, bz);
+				hn::StoreN(tx, d, tangents.x + i, n);
+				hn::StoreN(ty, d, tangents.y + i, n);
+				hn::StoreN(tz, d, tangents.z + i, n);
+				hn::StoreN(bx, d, bitangents.x + i, n);
+				hn::StoreN(by, d, bitangents.y + i, n);
+				hn::StoreN(bz, d, bitangents.z + i, n);
+			}
+		}
+
+		void CosineHemisphereBatch(Math::ConstVec3Streams normals, const float *u1, const float *u2, Math::Vec3Streams directions, size_t count)
+		{
+			const hn::ScalableTag<float> d;
+			const size_t lanes = hn::Lanes(d);
+			const auto zero = hn::Zero(d);
+			const auto one = hn::Set(d, 1.0f);
+			const auto two_pi = hn::Set(d, Math::TWO_PI);
+
+			for (size_t i = 0; i < count; i += lanes)
+			{
+				const size_t n = std::min(lanes, count - i);
+				const auto nx = hn::LoadN(d, normals.x + i, n);
+				const auto ny = hn::LoadN(d, normals.y + i, n);
+				const auto nz = hn::LoadN(d, normals.z + i, n);
+				const auto v1 = hn::LoadN(d, u1 + i, n);
+
+				const auto cos_theta = hn::Sqrt(v1);
+				const auto sin_theta = hn::Sqrt(hn::Max(zero, hn::Sub(one, v1)));
+				hn::VFromD<decltype(d)> sin_phi, cos_phi;
+				SinCos(d, hn::Mul(two_pi, hn::LoadN(d, u2 + i, n)), sin_phi, cos_phi);
+
+				hn::VFromD<decltype(d)> tx, ty, tz, bx, by, bz;
+				OrthonormalBasis(d, nx, ny, nz, tx, ty, tz, bx, by, bz);
+
+				const auto local_x = hn::Mul(sin_theta, cos_phi);
+				const auto local_y = hn::Mul(sin_theta, sin_phi);
+				hn::StoreN(hn::MulAdd(local_x, tx, hn::MulAdd(local_y, bx, hn::Mul(cos_theta, nx))), d, directions.x + i, n);
+				hn::StoreN(hn::MulAdd(local_x, ty, hn::MulAdd(local_y, by, hn::Mul(cos_theta, ny))), d, directions.y + i, n);
+				hn::StoreN(hn::MulAdd(local_x, tz, hn::MulAdd(local_y, bz, hn::Mul(cos_theta, nz))), d, directions.z + i, n);
+			}
+		}
+
+		void AcesTonemapBatch(float *HWY_RESTRICT values, size_t count, float exposure)
+		{
+			const hn::ScalableTag<float> d;
+			const size_t lanes = hn::Lanes(d);
+			const auto scale = hn::Set(d, exposure);
+			const auto zero = hn::Zero(d);
+			const auto one = hn::Set(d, 1.0f);
+
+			for (size_t i = 0; i < count; i += lanes)
+			{
+				const size_t n = std::min(lanes, count - i);
+				const auto x = hn::Mul(hn::LoadN(d, values + i, n), scale);
+				const auto numerator = hn::Mul(x, hn::MulAdd(hn::Set(d, 2.51f), x, hn::Set(d, 0.03f)));
+				const auto denominator = hn::MulAdd(x, hn::MulAdd(hn::Set(d, 2.43f), x, hn::Set(d, 0.59f)), hn::Set(d, 0.14f));
+				hn::StoreN(hn::Min(hn::Max(hn::Div(numerator, denominator), zero), one), d, values + i, n);
+			}
+		}
+
+		void ReinhardTonemapBatch(float *HWY_RESTRICT values, size_t count, float exposure)
+		{
+			const hn::ScalableTag<float> d;
+			const size_t lanes = hn::Lanes(d);
+			const auto scale = hn::Set(d, exposure);
+			const auto one = hn::Set(d, 1.0f);
+
+			for (size_t i = 0; i < count; i += lanes)
+			{
+				const size_t n = std::min(lanes, count - i);
+				const auto x = hn::Mul(hn::LoadN(d, values + i, n), scale);
+				hn::StoreN(hn::Div(x, hn::Add(x, one)), d, values + i, n);
+			}
+		}
+
+		void ComposeHierarchyBatch(const uint32_t *HWY_RESTRICT parents, const float *HWY_RESTRICT locals, float *worlds, size_t begin, size_t end)
+		{
+			// One matrix column per vector, targets narrower than four lanes take each column in pieces
+			const hn::CappedTag<float, 4> d;
+			const size_t lanes = hn::Lanes(d);
+
+			for (size_t i = begin; i < end; i++)
+			{
+				const float *parent = worlds + static_cast<size_t>(parents[i]) * 16;
+				const float *local = locals + i * 16;
+				float *world = worlds + i * 16;
+
+				for (size_t row = 0; row < 4; row += lanes)
+				{
+					const auto p0 = hn::LoadU(d, parent + row);
+					const auto p1 = hn::LoadU(d, parent + 4 + row);
+					const auto p2 = hn::LoadU(d, parent + 8 + row);
+					const auto p3 = hn::LoadU(d, parent + 12 + row);
+					for (size_t column = 0; column < 4; column++)
+					{
+						const float *l = local + column * 4;
+						auto result = hn::Mul(p0, hn::Set(d, l[0]));
+						result = hn::MulAdd(p1, hn::Set(d, l[1]), result);
+						result = hn::MulAdd(p2, hn::Set(d, l[2]), result);
+						result = hn::MulAdd(p3, hn::Set(d, l[3]), result);
+						hn::StoreU(result, d, world + column * 4 + row);
+					}
+				}
+			}
+		}
+
+	} // namespace HWY_NAMESPACE
+} // namespace render
+HWY_AFTER_NAMESPACE();
+
+#if HWY_ONCE
+
+namespace render
+{
+	HWY_EXPORT(FastRsqrtBatch);
+	HWY_EXPORT(SinCosBatch);
+	HWY_EXPORT(OrthonormalBasisBatch);
+	HWY_EXPORT(CosineHemisphereBatch);
+	HWY_EXPORT(AcesTonemapBatch);
+	HWY_EXPORT(ReinhardTonemapBatch);
+	HWY_EXPORT(ComposeHierarchyBatch);
+
+	namespace Math
+	{
+		void fastRsqrtBatch(const float *x, float *result, size_t count)
+		{
+			HWY_DYNAMIC_DISPATCH(FastRsqrtBatch)(x, result, count);
+		}
+
+		void sincosBatch(const float *x, float *s, float *c, size_t count)
+		{
+			HWY_DYNAMIC_DISPATCH(SinCosBatch)(x, s, c, count);
+		}
+
+		void buildOrthonormalBasisBatch(ConstVec3Streams normals, Vec3Streams tangents, Vec3Streams bitangents, size_t count)
+		{
+			HWY_DYNAMIC_DISPATCH(OrthonormalBasisBatch)(normals, tangents, bitangents, count);
+		}
+
+		void sampleCosineHemisphereBatch(ConstVec3Streams normals, const float *u1, const float *u2, Vec3Streams directions, size_t count)
+		{
+			HWY_DYNAMIC_DISPATCH(CosineHemisphereBatch)(normals, u1, u2, directions, count);
+		}
+
+		void acesTonemapBatch(float *values, size_t count, float exposure)
+		{
+			HWY_DYNAMIC_DISPATCH(AcesTonemapBatch)(values, count, exposure);
+		}
+
+		void reinhardTonemapBatch(float *values, size_t count, float exposure)
+		{
+			HWY_DYNAMIC_DISPATCH(ReinhardTonemapBatch)(values, count, exposure);
+		}
+
+		void composeHierarchyBatch(const uint32_t *parents, const float *locals, float *worlds, size_t begin, size_t end)
+		{
+			HWY_DYNAMIC_DISPATCH(ComposeHierarchyBatch)(parents, locals, worlds, begin, end);
+		}
+	}
+
+} // namespace render
+
+#endif // HWY_ONCE
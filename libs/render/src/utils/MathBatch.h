@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace render {
+
+    /// Batched SoA versions of the Math.h kernels
+    /// Compiled for every SIMD target Highway supports (SSE4, AVX2, AVX-512, NEON, ...) and
+    /// dispatched at runtime to the widest one the CPU has. Results match the scalar versions
+    /// up to rounding. Outputs may alias inputs of the same component.
+    namespace Math {
+
+        struct Vec3Streams {
+            float* x = nullptr;
+            float* y = nullptr;
+            float* z = nullptr;
+        };
+
+        struct ConstVec3Streams {
+            const float* x = nullptr;
+            const float* y = nullptr;
+            const float* z = nullptr;
+        };
+
+        void fastRsqrtBatch(const float* x, float* result, size_t count);
+
+        void sincosBatch(const float* x, float* s, float* c, size_t count);
+
+        void buildOrthonormalBasisBatch(ConstVec3Streams normals, Vec3Streams tangents, Vec3Streams bitangents, size_t count);
+
+        /// u1 and u2 are the two sample dimensions, same mapping as sampleCosineHemisphere
+        void sampleCosineHemisphereBatch(ConstVec3Streams normals, const float* u1, const float* u2, Vec3Streams directions, size_t count);
+
+        /// In place on any float stream, every value is treated as an independent channel
+        void acesTonemapBatch(float* values, size_t count, float exposure = 1.0f);
+        void reinhardTonemapBatch(float* values, size_t count, float exposure = 1.0f);
+
+        /// worlds[i] = worlds[parents[i]] * locals[i] for i in [begin, end), in order
+        /// Matrices are column-major 4x4 (glm::mat4 layout). Every parent index must be smaller than its child's,
+        /// then one forward pass over a topologically ordered array resolves the whole hierarchy.
+        void composeHierarchyBatch(const uint32_t* parents, const float* locals, float* worlds, size_t begin, size_t end);
+    }
+
+}
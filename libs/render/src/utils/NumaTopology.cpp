@@ -0,0 +1,206 @@
+#include "NumaTopology.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <fstream>
+#include <sched.h>
+#include <string>
+#endif
+
+namespace render
+{
+	namespace
+	{
+#if defined(__linux__)
+		/// Parses a sysfs CPU or node list such as "0-15,32-47"
+		std::vector<uint32_t> parse_index_list(const std::string &list)
+		{
+			std::vector<uint32_t> cpus;
+			size_t position = 0;
+			while (position < list.size())
+			{
+				size_t end = list.find(',', position);
+				if (end == std::string::npos)
+					end = list.size();
+
+				const std::string range = list.substr(position, end - position);
+				const size_t dash = range.find('-');
+				try
+				{
+					const uint32_t first = static_cast<uint32_t>(std::stoul(range.substr(0, dash)));
+					const uint32_t last = dash == std::string::npos ? first : static_cast<uint32_t>(std::stoul(range.substr(dash + 1)));
+					for (uint32_t cpu = first; cpu <= last; cpu++)
+						cpus.push_back(cpu);
+				}
+				catch (const std::exception &)
+				{
+					// Trailing newline or an empty node
+				}
+				position = end + 1;
+			}
+			return cpus;
+		}
+
+		std::vector<uint32_t> read_index_list(const std::string &path)
+		{
+			std::ifstream file(path);
+			std::string list;
+			if (!file || !std::getline(file, list))
+				return {};
+			return parse_index_list(list);
+		}
+#endif
+
+		/// CPUs in the affinity mask of the process, empty when the OS does not tell
+		std::vector<uint32_t> get_allowed_cpus()
+		{
+			std::vector<uint32_t> cpus;
+#if defined(__linux__)
+			cpu_set_t allowed;
+			CPU_ZERO(&allowed);
+			if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+				return cpus;
+			for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			{
+				if (CPU_ISSET(cpu, &allowed))
+					cpus.push_back(cpu);
+			}
+#endif
+			return cpus;
+		}
+	}
+
+	uint32_t NumaTopology::get_cpu_count() const
+	{
+		uint32_t count = 0;
+		for (const Domain &domain : domains)
+			count += static_cast<uint32_t>(domain.cpus.size());
+		return count;
+	}
+
+	NumaTopology NumaTopology::single_domain(uint32_t cpu_count)
+	{
+		// Inside taskset or a cpuset cgroup the first CPUs of the machine may not be ours
+		const std::vector<uint32_t> allowed = get_allowed_cpus();
+		if (cpu_count == 0)
+			cpu_count = allowed.empty() ? std::max(1u, std::thread::hardware_concurrency()) : static_cast<uint32_t>(allowed.size());
+
+		NumaTopology topology;
+		topology.domains.emplace_back();
+		for (uint32_t cpu = 0; cpu < cpu_count; cpu++)
+			topology.domains[0].cpus.push_back(allowed.empty() ? cpu : allowed[cpu % allowed.size()]);
+		return topology;
+	}
+
+	NumaTopology NumaTopology::with_cpu_count(uint32_t cpu_count) const
+	{
+		if (cpu_count == 0 || cpu_count >= get_cpu_count())
+			return *this;
+
+		NumaTopology topology;
+		for (const Domain &domain : domains)
+			topology.domains.push_back({domain.node, {}});
+
+		for (uint32_t slot = 0, taken = 0; taken < cpu_count; slot++)
+		{
+			for (size_t d = 0; d < domains.size() && taken < cpu_count; d++)
+			{
+				if (slot < domains[d].cpus.size())
+				{
+					topology.domains[d].cpus.push_back(domains[d].cpus[slot]);
+					taken++;
+				}
+			}
+		}
+
+		std::erase_if(topology.domains, [](const Domain &domain) { return domain.cpus.empty(); });
+		return topology;
+	}
+
+	NumaTopology NumaTopology::detect()
+	{
+		NumaTopology topology;
+
+#if defined(__linux__)
+		// Only CPUs in the affinity mask count, containers and taskset restrict it
+		const std::vector<uint32_t> allowed = get_allowed_cpus();
+
+		// Node numbers may have holes, the online list names the ones that exist
+		for (uint32_t node : read_index_list("/sys/devices/system/node/online"))
+		{
+			Domain domain;
+			domain.node = node;
+			for (uint32_t cpu : read_index_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"))
+			{
+				if (allowed.empty() || std::ranges::binary_search(allowed, cpu))
+					domain.cpus.push_back(cpu);
+			}
+			if (!domain.cpus.empty())
+				topology.domains.push_back(std::move(domain));
+		}
+#elif defined(_WIN32)
+		ULONG highest_node = 0;
+		if (GetNumaHighestNodeNumber(&highest_node))
+		{
+			for (USHORT node = 0; node <= highest_node; node++)
+			{
+				GROUP_AFFINITY affinity{};
+				if (!GetNumaNodeProcessorMaskEx(node, &affinity))
+					continue;
+
+				Domain domain;
+				domain.node = node;
+				for (uint32_t bit = 0; bit < 64; bit++)
+				{
+					if (affinity.Mask & (KAFFINITY(1) << bit))
+						domain.cpus.push_back(static_cast<uint32_t>(affinity.Group) * 64 + bit);
+				}
+				if (!domain.cpus.empty())
+					topology.domains.push_back(std::move(domain));
+			}
+		}
+#endif
+
+		if (topology.domains.empty())
+			return single_domain();
+		return topology;
+	}
+
+	bool pin_current_thread(const std::vector<uint32_t> &cpus)
+	{
+		if (cpus.empty())
+			return false;
+
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (uint32_t cpu : cpus)
+		{
+			if (cpu < CPU_SETSIZE)
+				CPU_SET(cpu, &set);
+		}
+		return sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+		// A NUMA node never spans processor groups
+		GROUP_AFFINITY affinity{};
+		affinity.Group = static_cast<WORD>(cpus.front() / 64);
+		for (uint32_t cpu : cpus)
+		{
+			if (cpu / 64 == affinity.Group)
+				affinity.Mask |= KAFFINITY(1) << (cpu % 64);
+		}
+		return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#else
+		// macOS has no hard affinity, the scheduler decides
+		return false;
+#endif
+	}
+
+} // namespace render
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace render
+{
+
+	/// NUMA domains and the logical CPUs of each that this process may run on
+	/// Machines without NUMA information report a single domain with every CPU
+	struct NumaTopology
+	{
+		struct Domain
+		{
+			uint32_t node = 0;			// OS node number
+			std::vector<uint32_t> cpus; // Logical CPU indices
+		};
+
+		std::vector<Domain> domains;
+
+		uint32_t get_domain_count() const { return static_cast<uint32_t>(domains.size()); }
+		uint32_t get_cpu_count() const;
+
+		static NumaTopology detect();
+
+		/// The first thread_count CPUs taken round-robin over the domains, so a smaller pool still spans every domain
+		NumaTopology with_cpu_count(uint32_t cpu_count) const;
+
+		/// The CPUs this process may run on in one domain, used when placement should not matter.
+		/// CPUs repeat when cpu_count exceeds the affinity mask
+		static NumaTopology single_domain(uint32_t cpu_count = 0); // 0 = every CPU the process may run on
+	};
+
+	/// Restricts the calling thread to the given logical CPUs, returns false when the OS refused
+	bool pin_current_thread(const std::vector<uint32_t> &cpus);
+
+} // namespace render
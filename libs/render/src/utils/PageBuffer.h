@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace render
+{
+
+	/// Page-aligned array of trivial values that is left uninitialized on allocation
+	/// The OS places each page on the NUMA domain of the thread that writes it first, std::vector would
+	/// zero everything on the allocating thread, so the owner decides who touches which page
+	template <typename T>
+	class PageBuffer
+	{
+		static_assert(std::is_trivial_v<T>, "PageBuffer skips construction");
+
+	public:
+		static constexpr size_t PAGE_SIZE = 4096;
+
+		PageBuffer() = default;
+		~PageBuffer() { release(); }
+
+		PageBuffer(PageBuffer &&other) noexcept
+			: m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0))
+		{
+		}
+
+		PageBuffer &operator=(PageBuffer &&other) noexcept
+		{
+			if (this != &other)
+			{
+				release();
+				m_data = std::exchange(other.m_data, nullptr);
+				m_size = std::exchange(other.m_size, 0);
+			}
+			return *this;
+		}
+
+		PageBuffer(const PageBuffer &) = delete;
+		PageBuffer &operator=(const PageBuffer &) = delete;
+
+		/// Replaces the contents with size uninitialized values, pages are not committed until written
+		void allocate(size_t size)
+		{
+			release();
+			if (size == 0)
+				return;
+			m_data = static_cast<T *>(::operator new(size * sizeof(T), std::align_val_t{PAGE_SIZE}));
+			m_size = size;
+		}
+
+		void release()
+		{
+			if (m_data)
+				::operator delete(m_data, std::align_val_t{PAGE_SIZE});
+			m_data = nullptr;
+			m_size = 0;
+		}
+
+		T *data() { return m_data; }
+		const T *data() const { return m_data; }
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		T *begin() { return m_data; }
+		T *end() { return m_data + m_size; }
+		const T *begin() const { return m_data; }
+		const T *end() const { return m_data + m_size; }
+
+		T &operator[](size_t index) { return m_data[index]; }
+		const T &operator[](size_t index) const { return m_data[index]; }
+
+	private:
+		T *m_data = nullptr;
+		size_t m_size = 0;
+	};
+
+} // namespace render
@@ -0,0 +1,225 @@
+#include "ThreadPool.h"
+#include "render/Profiler.h"
+
+#include <algorithm>
+#include <format>
+
+namespace render
+{
+
+	ThreadPool::ThreadPool(uint32_t thread_count)
+	{
+		if (thread_count == 0)
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+		start_workers(NumaTopology::single_domain(thread_count), thread_count, ThreadAffinity::None);
+	}
+
+	ThreadPool::ThreadPool(const NumaTopology &topology, ThreadAffinity affinity)
+	{
+		start_workers(topology, std::max(1u, topology.get_cpu_count()), affinity);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = true;
+		}
+		m_work_cv.notify_all();
+		for (auto &worker : m_workers)
+			worker.join();
+	}
+
+	void ThreadPool::start_workers(const NumaTopology &topology, uint32_t thread_count, ThreadAffinity affinity)
+	{
+		m_topology = topology.domains.empty() ? NumaTopology::single_domain(thread_count) : topology;
+
+		const uint32_t domain_count = m_topology.get_domain_count();
+		m_job_cursors = std::make_unique<DomainCursor[]>(domain_count);
+		m_domain_threads.assign(domain_count, 0);
+
+		// A single domain is left to the OS scheduler, pinning would only take away flexibility
+		const bool pin_domain = affinity == ThreadAffinity::NumaDomain && domain_count > 1;
+		const bool pin_core = affinity == ThreadAffinity::Core;
+
+		// The calling thread is never pinned, it may be an application thread with its own affinity.
+		// Where placement matters it only waits and its slot gets a pinned worker instead
+		m_caller_runs = affinity == ThreadAffinity::None || domain_count == 1;
+		const uint32_t first_worker = m_caller_runs ? 1 : 0;
+
+		// Threads are handed out in domain order, the calling thread takes the first slot of domain 0 when it runs chunks
+		m_workers.reserve(thread_count - first_worker);
+		uint32_t domain = 0;
+		uint32_t slot = 0;
+		for (uint32_t i = 0; i < thread_count; i++)
+		{
+			while (domain + 1 < domain_count && slot >= m_topology.domains[domain].cpus.size())
+			{
+				domain++;
+				slot = 0;
+			}
+
+			const std::vector<uint32_t> &domain_cpus = m_topology.domains[domain].cpus;
+			std::vector<uint32_t> cpus;
+			if (pin_domain)
+				cpus = domain_cpus;
+			else if (pin_core && slot < domain_cpus.size())
+				cpus = {domain_cpus[slot]};
+
+			m_domain_threads[domain]++;
+			if (i >= first_worker)
+				m_workers.emplace_back([this, i, domain, cpus = std::move(cpus)]() mutable {
+					Profiler::set_thread_name(std::format("Render worker {} (domain {})", i, domain));
+					worker_loop(domain, std::move(cpus));
+				});
+			slot++;
+		}
+	}
+
+	std::vector<uint32_t> ThreadPool::get_domain_offsets(uint32_t count, uint32_t alignment) const
+	{
+		alignment = std::max(1u, alignment);
+		const uint32_t domain_count = get_domain_count();
+		const uint64_t thread_count = get_thread_count();
+
+		std::vector<uint32_t> offsets(domain_count + 1, 0);
+		uint64_t threads_before = 0;
+		for (uint32_t d = 1; d < domain_count; d++)
+		{
+			threads_before += m_domain_threads[d - 1];
+			const uint64_t units = (static_cast<uint64_t>(count) * threads_before / thread_count + alignment / 2) / alignment;
+			offsets[d] = std::clamp(static_cast<uint32_t>(std::min<uint64_t>(units * alignment, count)), offsets[d - 1], count);
+		}
+		offsets[domain_count] = count;
+		return offsets;
+	}
+
+	void ThreadPool::parallel_for(uint32_t count, uint32_t grain_size, const RangeFunction &function)
+	{
+		// One band owned by domain 0, the other domains steal from the start, as with a plain shared counter
+		std::vector<uint32_t> offsets(get_domain_count() + 1, count);
+		offsets[0] = 0;
+		parallel_for_domains(offsets, grain_size, function);
+	}
+
+	void ThreadPool::parallel_for_domains(const std::vector<uint32_t> &offsets, uint32_t grain_size, const RangeFunction &function, bool steal)
+	{
+		const uint32_t domain_count = get_domain_count();
+		if (offsets.size() != domain_count + 1 || offsets.back() == offsets.front())
+			return;
+
+		grain_size = std::max(1u, grain_size);
+		if (m_workers.empty() || offsets.back() - offsets.front() <= grain_size)
+		{
+			for (uint32_t d = 0; d < domain_count; d++)
+			{
+				if (offsets[d] < offsets[d + 1])
+					function(offsets[d], offsets[d + 1]);
+			}
+			return;
+		}
+
+		std::lock_guard submit_lock(m_submit_mutex);
+		{
+			std::lock_guard lock(m_mutex);
+			m_job_function = &function;
+			m_job_grain = grain_size;
+			m_job_steal = steal;
+			for (uint32_t d = 0; d < domain_count; d++)
+			{
+				m_job_cursors[d].next.store(offsets[d], std::memory_order_relaxed);
+				m_job_cursors[d].end = offsets[d + 1];
+			}
+			m_pending_workers = static_cast<uint32_t>(m_workers.size());
+			m_generation++;
+		}
+		m_work_cv.notify_all();
+
+		if (m_caller_runs)
+			run_chunks(0);
+
+		std::unique_lock lock(m_mutex);
+		m_done_cv.wait(lock, [this]() { return m_pending_workers == 0; });
+		m_job_function = nullptr;
+	}
+
+	void ThreadPool::run_on_all_threads(const ThreadFunction &function)
+	{
+		if (m_workers.empty())
+		{
+			function();
+			return;
+		}
+
+		std::lock_guard submit_lock(m_submit_mutex);
+		{
+			std::lock_guard lock(m_mutex);
+			m_job_broadcast = &function;
+			m_pending_workers = static_cast<uint32_t>(m_workers.size());
+			m_generation++;
+		}
+		m_work_cv.notify_all();
+
+		if (m_caller_runs)
+			function();
+
+		std::unique_lock lock(m_mutex);
+		m_done_cv.wait(lock, [this]() { return m_pending_workers == 0; });
+		m_job_broadcast = nullptr;
+	}
+
+	void ThreadPool::worker_loop(uint32_t domain, std::vector<uint32_t> cpus)
+	{
+		if (!cpus.empty())
+			pin_current_thread(cpus);
+
+		uint64_t seen_generation = 0;
+		while (true)
+		{
+			{
+				std::unique_lock lock(m_mutex);
+				m_work_cv.wait(lock, [&]() { return m_stop || m_generation != seen_generation; });
+				if (m_stop)
+					return;
+				seen_generation = m_generation;
+			}
+
+			run_job(domain);
+
+			std::lock_guard lock(m_mutex);
+			if (--m_pending_workers == 0)
+				m_done_cv.notify_one();
+		}
+	}
+
+	void ThreadPool::run_job(uint32_t domain)
+	{
+		if (m_job_broadcast)
+			(*m_job_broadcast)();
+		else
+			run_chunks(domain);
+	}
+
+	void ThreadPool::run_chunks(uint32_t domain)
+	{
+		// Own band first, then help the other domains in order, or only those nobody else would run
+		const uint32_t domain_count = get_domain_count();
+		for (uint32_t i = 0; i < domain_count; i++)
+		{
+			const uint32_t band = (domain + i) % domain_count;
+			if (i > 0 && !m_job_steal && m_domain_threads[band] > 0)
+				continue;
+
+			DomainCursor &cursor = m_job_cursors[band];
+			while (true)
+			{
+				const uint32_t begin = cursor.next.fetch_add(m_job_grain, std::memory_order_relaxed);
+				if (begin >= cursor.end)
+					break;
+				(*m_job_function)(begin, std::min(begin + m_job_grain, cursor.end));
+			}
+		}
+	}
+
+} // namespace render
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "NumaTopology.h"
+#include "render/Types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace render
+{
+
+	/// Persistent worker pool for data-parallel loops inside the render library
+	/// The calling thread participates, so a pool of N threads spawns N - 1 workers, unless workers are pinned to domains
+	class ThreadPool
+	{
+	public:
+		using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+		using ThreadFunction = std::function<void()>;
+
+		explicit ThreadPool(uint32_t thread_count = 0); // 0 = hardware concurrency
+
+		/// One thread per CPU of the topology, the calling thread counts as the first thread of domain 0.
+		/// NumaDomain affinity pins workers to their domain only when there is more than one. Once workers are pinned
+		/// over several domains, every CPU gets a pinned worker and the unpinned calling thread only waits for them,
+		/// so no chunk ever runs on an unknown domain
+		explicit ThreadPool(const NumaTopology &topology, ThreadAffinity affinity = ThreadAffinity::NumaDomain);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		uint32_t get_thread_count() const { return static_cast<uint32_t>(m_workers.size()) + (m_caller_runs ? 1 : 0); }
+		uint32_t get_domain_count() const { return static_cast<uint32_t>(m_domain_threads.size()); }
+		uint32_t get_domain_thread_count(uint32_t domain) const { return m_domain_threads[domain]; }
+
+		/// Splits [0, count) into chunks of grain_size and blocks until every chunk ran
+		void parallel_for(uint32_t count, uint32_t grain_size, const RangeFunction &function);
+
+		/// Splits [0, count) into one contiguous band per domain, sized by the domain's thread count
+		/// Returns get_domain_count() + 1 offsets, every band boundary is a multiple of alignment
+		std::vector<uint32_t> get_domain_offsets(uint32_t count, uint32_t alignment = 1) const;
+
+		/// Like parallel_for, but the threads of domain d take chunks of [offsets[d], offsets[d + 1]) first
+		/// and only help other domains once their own band is done, so the same band runs on the same domain every call.
+		/// Without steal a band only runs on its own domain (bands of domains without threads excepted),
+		/// for first-touch placement where a single stolen chunk puts pages on the wrong node
+		void parallel_for_domains(const std::vector<uint32_t> &offsets, uint32_t grain_size, const RangeFunction &function, bool steal = true);
+
+		/// Runs function once on every thread of the pool, e.g. to let all of them join an Embree build
+		/// The calling thread runs it too unless it only waits, see the topology constructor
+		void run_on_all_threads(const ThreadFunction &function);
+
+	private:
+		/// Next chunk of one domain's band, on its own cache line so domains do not contend
+		struct alignas(64) DomainCursor
+		{
+			std::atomic<uint32_t> next{0};
+			uint32_t end = 0;
+		};
+
+		void start_workers(const NumaTopology &topology, uint32_t thread_count, ThreadAffinity affinity);
+		void worker_loop(uint32_t domain, std::vector<uint32_t> cpus);
+		void run_job(uint32_t domain);
+		void run_chunks(uint32_t domain);
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::vector<uint32_t> m_domain_threads; // Threads per domain, including the caller in domain 0 when it runs chunks
+		bool m_caller_runs = true;				// False when workers are pinned over several domains
+
+		std::mutex m_submit_mutex; // Serializes parallel_for calls from different threads
+		std::mutex m_mutex;
+		std::condition_variable m_work_cv;
+		std::condition_variable m_done_cv;
+
+		// Current job, published under m_mutex
+		const RangeFunction *m_job_function = nullptr;
+		const ThreadFunction *m_job_broadcast = nullptr; // Set instead of m_job_function by run_on_all_threads
+		uint32_t m_job_grain = 1;
+		bool m_job_steal = true;
+		std::unique_ptr<DomainCursor[]> m_job_cursors; // One per domain
+		uint32_t m_pending_workers = 0;
+		uint64_t m_generation = 0;
+		bool m_stop = false;
+
+		NumaTopology m_topology;
+	};
+
+} // namespace render
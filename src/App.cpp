@@ -6,9 +6,11 @@
 #include <stdio.h>
 #include <stdexcept>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 
 #include "renderer/GraphicsContext.h"
+#include "DefaultScene.h"
 
 #include <SDL3/SDL.h>
 
@@ -17,6 +19,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "render/Log.h"
+#include "render/Color.h"
+#include "render/Profiler.h"
 
 // Factory handles the specific implementation
 
@@ -28,6 +32,8 @@
 #endif
 
 static void SetDarkThemeColors();
+static void AOVToRGBA8(const render::PathTracer::AOVBuffer &aov, std::vector<uint32_t> &pixels);
+static void DrawProfilerWindow(render::ProfileFrame &frame);
 
 App *App::s_Instance = nullptr;
 
@@ -87,6 +93,7 @@ App::App()
 	render::Log::set_callback([](render::LogLevel level, std::string_view msg) {
 		const char* level_str = "INFO";
 		switch(level) {
+			case render::LogLevel::Trace: level_str = "TRACE"; break;
 			case render::LogLevel::Debug: level_str = "DEBUG"; break;
 			case render::LogLevel::Warn:  level_str = "WARN";  break;
 			case render::LogLevel::Error: level_str = "ERROR"; break;
@@ -96,30 +103,7 @@ App::App()
 
 	{
 		m_path_tracer = render::PathTracer::create_path_tracer(render::PathTracer::BackendType::CPU_EMBREE);
-		m_render_scene = std::make_shared<render::Scene>();
-		
-		{
-			auto sphere = m_render_scene->CreateNode<render::SphereObject>("123");
-			sphere->SetRadius(1.0f);
-			sphere->SetPosition(glm::vec3(0.0f, -1.0f, 5.0f));
-		}
-
-		{
-			auto sphere = m_render_scene->CreateNode<render::SphereObject>("123");
-			sphere->SetRadius(100.0f);
-			sphere->SetPosition(glm::vec3(0.0f, -102.0f, 5.0f));
-		}
-
-		int dims = 5;
-		for (int x = -dims; x <= dims; x += 2)
-		{
-			for (int y = -dims; y <= dims; y += 2)
-			{
-				auto s = m_render_scene->CreateNode<render::SphereObject>("sphere");
-				s->SetRadius(0.5f);
-				s->SetPosition(glm::vec3((float)x, (float)y, 10.0f));
-			}
-		}
+		m_render_scene = create_default_scene();
 
 		// Initialize render settings
 		auto render_settings = std::make_shared<render::RenderSettings>();
@@ -150,11 +134,13 @@ void App::run()
 
 	ImGuiIO &io = ImGui::GetIO();
 	(void)io;
+	render::Profiler::set_thread_name("Main");
 	// Main loop
 	bool done = false;
 	uint32_t frame = 1;
 	while (!done)
 	{
+		render::Profiler::begin_frame();
 		// Poll and handle events (inputs, window resize, etc.)
 		// You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants to use your inputs.
 		// - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application, or clear/overwrite your copy of the mouse data.
@@ -230,9 +216,17 @@ void App::run()
 			{
 				m_path_tracer->render();
 				const auto &result = m_path_tracer->get_render_result();
-				if (result.width > 0 && result.height > 0)
+				const auto *aov = m_display_aov ? m_path_tracer->get_aov(*m_display_aov) : nullptr;
+				RENDER_PROFILE_SCOPE("Texture upload");
+				if (aov)
+				{
+					AOVToRGBA8(*aov, m_viewport_data);
+					SDL_UpdateTexture((SDL_Texture *)test_tex->get_texture(), nullptr,
+									  m_viewport_data.data(),
+									  aov->width * sizeof(uint32_t));
+				}
+				else if (result.format == render::OutputFormat::RGBA8 && result.width > 0 && result.height > 0)
 				{
-					
 					SDL_UpdateTexture((SDL_Texture *)test_tex->get_texture(), nullptr,
 									  result.image_buffer.data(),
 									  result.width * sizeof(uint32_t));
@@ -307,6 +301,95 @@ void App::run()
 			// Renderer info
 			ImGui::Separator();
 			ImGui::Text("Renderer Backend: Embree");
+			const render::PathTracer::MemoryStats memory = m_path_tracer->get_memory_stats();
+			ImGui::Text("BVH Memory: %.1f MB (peak %.1f MB)", memory.current_bytes / (1024.0 * 1024.0), memory.peak_bytes / (1024.0 * 1024.0));
+
+			auto render_settings = m_path_tracer->get_settings();
+			const char *sampler_types[] = {"Independent", "Sobol (Owen)", "Blue Noise"};
+			int current_sampler = static_cast<int>(render_settings->getSamplerType());
+			if (ImGui::Combo("Sampler", &current_sampler, sampler_types, 3))
+			{
+				render_settings->setSamplerType(static_cast<render::SamplerType>(current_sampler));
+			}
+
+			bool denoise = render_settings->getDenoise();
+			if (ImGui::Checkbox("Denoise", &denoise))
+			{
+				render_settings->setDenoise(denoise);
+			}
+
+			bool path_guiding = render_settings->getPathGuiding();
+			if (ImGui::Checkbox("Path Guiding", &path_guiding))
+			{
+				render_settings->setPathGuiding(path_guiding);
+			}
+
+			bool efficient_roulette = render_settings->getRouletteMode() == render::RouletteMode::Efficiency;
+			if (ImGui::Checkbox("Efficient Roulette", &efficient_roulette))
+			{
+				render_settings->setRouletteMode(efficient_roulette ? render::RouletteMode::Efficiency : render::RouletteMode::Throughput);
+			}
+
+			// Crop window, pixels outside keep their samples while the region converges
+			render::RenderRegion region = render_settings->getRenderRegion();
+			bool use_region = !region.isEmpty();
+			if (ImGui::Checkbox("Render Region", &use_region))
+			{
+				if (use_region)
+					region = {render_settings->getWidth() / 4, render_settings->getHeight() / 4, render_settings->getWidth() / 2, render_settings->getHeight() / 2};
+				else
+					region = {};
+				render_settings->setRenderRegion(region);
+			}
+			if (use_region)
+			{
+				int rect[4] = {(int)region.x, (int)region.y, (int)region.width, (int)region.height};
+				if (ImGui::DragInt4("Region (x, y, w, h)", rect, 1.0f, 0, (int)std::max(render_settings->getWidth(), render_settings->getHeight())))
+					render_settings->setRenderRegion({(uint32_t)rect[0], (uint32_t)rect[1], (uint32_t)std::max(rect[2], 1), (uint32_t)std::max(rect[3], 1)});
+			}
+
+			// Written on background threads, AOV layers are included for the enabled AOVs
+			if (ImGui::Button("Save EXR"))
+			{
+				render::ImageOutputOptions options;
+				options.aov_mask = render_settings->getAOVMask();
+				m_path_tracer->write_image("render.exr", options);
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Save PNG"))
+			{
+				m_path_tracer->write_image("render.png");
+			}
+
+			// Camera controls
+			ImGui::Separator();
+			ImGui::Text("Camera:");
+			render::Camera &camera = m_render_scene->GetCamera();
+			glm::vec3 camera_position = camera.getPosition();
+			if (ImGui::DragFloat3("Position", &camera_position.x, 0.05f))
+			{
+				camera.setPosition(camera_position);
+			}
+			glm::vec3 camera_target = camera.getTarget();
+			if (ImGui::DragFloat3("Target", &camera_target.x, 0.05f))
+			{
+				camera.setTarget(camera_target);
+			}
+			float fov = camera.getFieldOfView();
+			if (ImGui::SliderFloat("FOV", &fov, 10.0f, 120.0f, "%.1f deg"))
+			{
+				camera.setFieldOfView(fov);
+			}
+			float aperture = camera.getAperture();
+			if (ImGui::SliderFloat("Aperture", &aperture, 0.0f, 0.5f))
+			{
+				camera.setAperture(aperture);
+			}
+			float focus_distance = camera.getFocusDistance();
+			if (ImGui::DragFloat("Focus Distance", &focus_distance, 0.05f, 0.1f, 100.0f))
+			{
+				camera.setFocusDistance(focus_distance);
+			}
 
 			// Tonemapping controls
 			ImGui::Separator();
@@ -315,12 +398,30 @@ void App::run()
 			ImGui::Separator();
 			ImGui::Text("Debug Options:");
 
+			// Show an AOV in the viewport instead of the beauty pass
+			const char *display_outputs[] = {"Beauty", "Albedo", "Normal", "Depth", "Node ID"};
+			int current_output = m_display_aov ? static_cast<int>(*m_display_aov) + 1 : 0;
+			if (ImGui::Combo("Display", &current_output, display_outputs, 5))
+			{
+				if (m_display_aov)
+					render_settings->setAOVEnabled(*m_display_aov, false);
+				m_display_aov.reset();
+				if (current_output > 0)
+				{
+					m_display_aov = static_cast<render::AOVType>(current_output - 1);
+					render_settings->setAOVEnabled(*m_display_aov, true);
+				}
+			}
+
 			ImGui::Separator();
 
 			ImGui::End();
 		}
 
+		DrawProfilerWindow(m_profile_frame);
+
 		// Rendering
+		RENDER_PROFILE_SCOPE("ImGui draw");
 		ImGui::Render();
 		SDL_SetRenderScale(GraphicsContext::getSDLRenderer(), io.DisplayFramebufferScale.x, io.DisplayFramebufferScale.y);
 		SDL_SetRenderDrawColorFloat(GraphicsContext::getSDLRenderer(), m_clear_color.x, m_clear_color.y, m_clear_color.z, m_clear_color.w);
@@ -330,6 +431,173 @@ void App::run()
 	}
 }
 
+static void AOVToRGBA8(const render::PathTracer::AOVBuffer &aov, std::vector<uint32_t> &pixels)
+{
+	const size_t pixel_count = static_cast<size_t>(aov.width) * aov.height;
+	pixels.resize(pixel_count);
+
+	auto to_byte = [](float value) { return (uint8_t)(std::clamp(value, 0.0f, 1.0f) * 255.0f); };
+
+	float max_depth = 0.0f;
+	if (aov.type == render::AOVType::Depth)
+	{
+		for (float depth : aov.planes)
+			max_depth = std::max(max_depth, depth);
+	}
+
+	for (size_t i = 0; i < pixel_count; i++)
+	{
+		float r = 0.0f, g = 0.0f, b = 0.0f;
+		switch (aov.type)
+		{
+		case render::AOVType::Albedo:
+			r = aov.planes[i];
+			g = aov.planes[pixel_count + i];
+			b = aov.planes[2 * pixel_count + i];
+			break;
+		case render::AOVType::Normal:
+			r = aov.planes[i] * 0.5f + 0.5f;
+			g = aov.planes[pixel_count + i] * 0.5f + 0.5f;
+			b = aov.planes[2 * pixel_count + i] * 0.5f + 0.5f;
+			break;
+		case render::AOVType::Depth:
+			r = g = b = max_depth > 0.0f ? 1.0f - aov.planes[i] / max_depth : 0.0f;
+			break;
+		case render::AOVType::NodeID:
+		{
+			// Random but stable color per ID
+			uint32_t id = (uint32_t)aov.planes[i];
+			uint32_t hash = id * 2654435761u;
+			r = id ? (float)((hash >> 0) & 0xFF) / 255.0f : 0.0f;
+			g = id ? (float)((hash >> 8) & 0xFF) / 255.0f : 0.0f;
+			b = id ? (float)((hash >> 16) & 0xFF) / 255.0f : 0.0f;
+			break;
+		}
+		default:
+			r = g = b = aov.planes[i];
+			break;
+		}
+		pixels[i] = render::rgba_to_uint32(to_byte(r), to_byte(g), to_byte(b), 255);
+	}
+}
+
+// Timeline of the last completed frame, one row per thread, plus the time per scope name
+static void DrawProfilerWindow(render::ProfileFrame &frame)
+{
+	ImGui::Begin("Profiler");
+
+	bool enabled = render::Profiler::is_enabled();
+	if (ImGui::Checkbox("Enabled", &enabled))
+		render::Profiler::set_enabled(enabled);
+	ImGui::SameLine();
+	if (ImGui::Button("Export Chrome Trace"))
+	{
+		if (render::Profiler::write_chrome_trace("profile.json"))
+			render::Log::info("Wrote profile.json, open it in chrome://tracing or ui.perfetto.dev");
+		else
+			render::Log::error("Failed to write profile.json");
+	}
+
+	// The previous frame stays on screen while profiling is off
+	if (enabled)
+		render::Profiler::get_last_frame(frame);
+	if (frame.events.empty())
+	{
+		ImGui::TextDisabled("No events recorded");
+		ImGui::End();
+		return;
+	}
+
+	const double frame_ms = (frame.end_ns - frame.start_ns) / 1e6;
+	ImGui::Text("Frame %.2f ms", frame_ms);
+
+	// Rows only for threads with events in this frame
+	std::vector<int> rows(frame.thread_names.size(), -1);
+	int row_count = 0;
+	for (const render::ProfileEvent &event : frame.events)
+	{
+		if (rows[event.thread] < 0)
+			rows[event.thread] = row_count++;
+	}
+
+	const float label_width = 180.0f;
+	const float row_height = ImGui::GetTextLineHeight() + 4.0f;
+	const ImVec2 origin = ImGui::GetCursorScreenPos();
+	const float width = std::max(ImGui::GetContentRegionAvail().x - label_width, 100.0f);
+	const float ns_to_pixels = width / static_cast<float>(frame.end_ns - frame.start_ns);
+	ImDrawList *draw_list = ImGui::GetWindowDrawList();
+
+	for (size_t thread = 0; thread < rows.size(); thread++)
+	{
+		if (rows[thread] >= 0)
+			draw_list->AddText(ImVec2(origin.x, origin.y + rows[thread] * row_height), ImGui::GetColorU32(ImGuiCol_Text), frame.thread_names[thread].c_str());
+	}
+
+	const ImVec2 mouse = ImGui::GetIO().MousePos;
+	const render::ProfileEvent *hovered = nullptr;
+	for (const render::ProfileEvent &event : frame.events)
+	{
+		const uint64_t start = std::max(event.start_ns, frame.start_ns) - frame.start_ns;
+		const uint64_t end = std::min(event.end_ns, frame.end_ns) - frame.start_ns;
+		const ImVec2 min(origin.x + label_width + start * ns_to_pixels, origin.y + rows[event.thread] * row_height);
+		const ImVec2 max(std::max(origin.x + label_width + end * ns_to_pixels, min.x + 1.0f), min.y + row_height - 1.0f);
+
+		// Stable color per scope name
+		const uint32_t hash = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(event.name) * 2654435761u);
+		draw_list->AddRectFilled(min, max, IM_COL32(80 + (hash & 0x7F), 80 + ((hash >> 8) & 0x7F), 80 + ((hash >> 16) & 0x7F), 255));
+		if (max.x - min.x > 40.0f)
+		{
+			draw_list->PushClipRect(min, max, true);
+			draw_list->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(0, 0, 0, 255), event.name);
+			draw_list->PopClipRect();
+		}
+		if (mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y)
+			hovered = &event;
+	}
+	ImGui::Dummy(ImVec2(label_width + width, row_count * row_height));
+	if (hovered && ImGui::IsWindowHovered())
+		ImGui::SetTooltip("%s\n%.3f ms", hovered->name, (hovered->end_ns - hovered->start_ns) / 1e6);
+
+	// Totals per scope name, tile scopes sum over all threads
+	struct ScopeTotal
+	{
+		const char *name;
+		double ms;
+		uint32_t count;
+	};
+	std::vector<ScopeTotal> totals;
+	for (const render::ProfileEvent &event : frame.events)
+	{
+		auto it = std::find_if(totals.begin(), totals.end(), [&](const ScopeTotal &total) { return total.name == event.name; });
+		if (it == totals.end())
+			it = totals.insert(totals.end(), {event.name, 0.0, 0});
+		it->ms += (event.end_ns - event.start_ns) / 1e6;
+		it->count++;
+	}
+	std::sort(totals.begin(), totals.end(), [](const ScopeTotal &a, const ScopeTotal &b) { return a.ms > b.ms; });
+
+	if (ImGui::BeginTable("Scopes", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+	{
+		ImGui::TableSetupColumn("Scope");
+		ImGui::TableSetupColumn("Total ms");
+		ImGui::TableSetupColumn("Count");
+		ImGui::TableHeadersRow();
+		for (const ScopeTotal &total : totals)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(total.name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", total.ms);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", total.count);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
+
 static void SetDarkThemeColors()
 {
 	ImGuiStyle &style = ImGui::GetStyle();
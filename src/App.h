@@ -6,11 +6,13 @@
 #include <cstdint>
 #include <vector>
 #include <memory>
+#include <optional>
 
 
 #include "render/Types.h"
 
 #include "render/PathTracer.h"
+#include "render/Profiler.h"
 #include "render/Scene.h"
 
 #include "renderer/Texture2D.h"
@@ -48,9 +50,12 @@ private:
 
 	ViewportMode m_viewport_mode = ViewportMode::CUSTOM_SIZE_512;
 	std::vector<uint32_t> m_viewport_data;
+	std::optional<render::AOVType> m_display_aov; // Beauty pass when empty
 
 	std::unique_ptr<Texture2D> test_tex;
 
+	render::ProfileFrame m_profile_frame; // Last completed frame shown in the profiler window
+
 private:
 
 	std::unique_ptr<render::PathTracer> m_path_tracer;
@@ -0,0 +1,33 @@
+#include "DefaultScene.h"
+
+#include <glm/glm.hpp>
+
+std::shared_ptr<render::Scene> create_default_scene()
+{
+	auto scene = std::make_shared<render::Scene>();
+
+	{
+		auto sphere = scene->CreateNode<render::SphereObject>("123");
+		sphere->SetRadius(1.0f);
+		sphere->SetPosition(glm::vec3(0.0f, -1.0f, 5.0f));
+	}
+
+	{
+		auto sphere = scene->CreateNode<render::SphereObject>("123");
+		sphere->SetRadius(100.0f);
+		sphere->SetPosition(glm::vec3(0.0f, -102.0f, 5.0f));
+	}
+
+	int dims = 5;
+	for (int x = -dims; x <= dims; x += 2)
+	{
+		for (int y = -dims; y <= dims; y += 2)
+		{
+			auto s = scene->CreateNode<render::SphereObject>("sphere");
+			s->SetRadius(0.5f);
+			s->SetPosition(glm::vec3((float)x, (float)y, 10.0f));
+		}
+	}
+
+	return scene;
+}
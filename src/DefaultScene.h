@@ -0,0 +1,8 @@
+#pragma once
+
+#include <memory>
+
+#include "render/Scene.h"
+
+// Scene shown by the editor and rendered by headless workers, every process builds an identical copy
+std::shared_ptr<render::Scene> create_default_scene();
@@ -0,0 +1,795 @@
+#include "Headless.h"
+
+#include "DefaultScene.h"
+
+#include "render/Distributed.h"
+#include "render/ImageMetrics.h"
+#include "render/MathBenchmark.h"
+#include "render/SequenceRenderer.h"
+
+#include <OpenImageIO/imageio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+namespace
+{
+	// Child process running `executable --worker address --threads thread_count`
+	class WorkerProcess
+	{
+	public:
+		bool spawn(const char *executable, const std::string &address, uint32_t thread_count)
+		{
+#ifdef _WIN32
+			std::string command_line = "\"" + std::string(executable) + "\" --worker " + address + " --threads " + std::to_string(thread_count);
+			STARTUPINFOA startup_info{};
+			startup_info.cb = sizeof(startup_info);
+			m_running = CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup_info, &m_process) != 0;
+#else
+			std::string worker_flag = "--worker";
+			std::string worker_address = address;
+			std::string threads_flag = "--threads";
+			std::string threads = std::to_string(thread_count);
+			char *argv[] = {const_cast<char *>(executable), worker_flag.data(), worker_address.data(), threads_flag.data(), threads.data(), nullptr};
+			m_running = posix_spawnp(&m_pid, executable, nullptr, nullptr, argv, environ) == 0;
+#endif
+			return m_running;
+		}
+
+		void join()
+		{
+			if (!m_running)
+				return;
+#ifdef _WIN32
+			WaitForSingleObject(m_process.hProcess, INFINITE);
+			CloseHandle(m_process.hProcess);
+			CloseHandle(m_process.hThread);
+#else
+			int status = 0;
+			waitpid(m_pid, &status, 0);
+#endif
+			m_running = false;
+		}
+
+	private:
+#ifdef _WIN32
+		PROCESS_INFORMATION m_process{};
+#else
+		pid_t m_pid = 0;
+#endif
+		bool m_running = false;
+	};
+
+	bool write_image(const std::string &path, const render::PathTracer::RenderResult &result)
+	{
+		// Unpack rgba_to_uint32 to byte order
+		std::vector<uint8_t> pixels(result.image_buffer.size() * 4);
+		for (size_t i = 0; i < result.image_buffer.size(); i++)
+		{
+			const uint32_t value = result.image_buffer[i];
+			pixels[i * 4 + 0] = (value >> 24) & 0xFF;
+			pixels[i * 4 + 1] = (value >> 16) & 0xFF;
+			pixels[i * 4 + 2] = (value >> 8) & 0xFF;
+			pixels[i * 4 + 3] = value & 0xFF;
+		}
+
+		auto output = OIIO::ImageOutput::create(path);
+		if (!output)
+			return false;
+		const OIIO::ImageSpec spec(result.width, result.height, 4, OIIO::TypeDesc::UINT8);
+		const bool written = output->open(path, spec) && output->write_image(OIIO::TypeDesc::UINT8, pixels.data());
+		output->close();
+		return written;
+	}
+
+	// Jittered grid of small spheres in front of the default camera, returns the ID of the last one
+	render::NodeID add_sphere_field(render::Scene &scene, uint32_t sphere_count)
+	{
+		const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(sphere_count))));
+		render::NodeID last = 0;
+		for (uint32_t i = 0; i < sphere_count; i++)
+		{
+			const float u = (static_cast<float>(i % side) + 0.5f) / static_cast<float>(side);
+			const float v = (static_cast<float>(i / side) + 0.5f) / static_cast<float>(side);
+			auto sphere = scene.CreateNode<render::SphereObject>("field");
+			sphere->SetRadius(4.0f / static_cast<float>(side));
+			sphere->SetPosition(glm::vec3(u * 8.0f - 4.0f, v * 8.0f - 4.0f, 8.0f + 0.5f * std::sin(static_cast<float>(i))));
+			last = sphere->GetID();
+		}
+		return last;
+	}
+
+	std::shared_ptr<render::Scene> create_sphere_field_scene()
+	{
+		auto scene = create_default_scene();
+		add_sphere_field(*scene, 400);
+		return scene;
+	}
+
+	// Scenes the convergence harness tracks, names are the golden file names
+	struct ReferenceScene
+	{
+		const char *name;
+		std::shared_ptr<render::Scene> (*create)();
+	};
+	const ReferenceScene REFERENCE_SCENES[] = {
+		{"default", &create_default_scene},
+		{"sphere-field", &create_sphere_field_scene},
+	};
+
+	constexpr uint32_t CONVERGENCE_RESOLUTION = 256;
+	constexpr uint32_t CONVERGENCE_POINTS = 5; // Error measured at seconds / 16, / 8, / 4, / 2 and / 1
+
+	struct ConvergencePoint
+	{
+		double seconds = 0.0; // Render time, excluding the measurement itself
+		uint32_t samples = 0;
+		render::ImageError error;
+	};
+
+	bool read_rgb_image(const std::string &path, uint32_t width, uint32_t height, std::vector<float> &rgb)
+	{
+		auto input = OIIO::ImageInput::open(path);
+		if (!input)
+			return false;
+		const OIIO::ImageSpec &spec = input->spec();
+		if (spec.width != static_cast<int>(width) || spec.height != static_cast<int>(height) || spec.nchannels < 3)
+		{
+			printf("Error: %s is not a %ux%u RGB image\n", path.c_str(), width, height);
+			return false;
+		}
+		rgb.resize(static_cast<size_t>(width) * height * 3);
+		const bool read = input->read_image(0, 0, 0, 3, OIIO::TypeDesc::FLOAT, rgb.data());
+		input->close();
+		return read;
+	}
+
+	bool write_rgb_image(const std::string &path, uint32_t width, uint32_t height, const std::vector<float> &rgb)
+	{
+		auto output = OIIO::ImageOutput::create(path);
+		if (!output)
+			return false;
+		const OIIO::ImageSpec spec(width, height, 3, OIIO::TypeDesc::FLOAT);
+		const bool written = output->open(path, spec) && output->write_image(OIIO::TypeDesc::FLOAT, rgb.data());
+		output->close();
+		return written;
+	}
+
+	// One "seconds samples rmse relative_mse" line per point
+	bool read_curve(const std::string &path, std::vector<ConvergencePoint> &curve)
+	{
+		FILE *file = fopen(path.c_str(), "r");
+		if (!file)
+			return false;
+		ConvergencePoint point;
+		while (fscanf(file, "%lf %u %lf %lf", &point.seconds, &point.samples, &point.error.rmse, &point.error.relative_mse) == 4)
+			curve.push_back(point);
+		fclose(file);
+		return curve.size() == CONVERGENCE_POINTS;
+	}
+
+	std::unique_ptr<render::PathTracer> create_reference_tracer(const ReferenceScene &reference_scene)
+	{
+		auto path_tracer = render::PathTracer::create_path_tracer(render::PathTracer::BackendType::CPU_EMBREE);
+		auto settings = std::make_shared<render::RenderSettings>();
+		settings->setResolution(CONVERGENCE_RESOLUTION, CONVERGENCE_RESOLUTION);
+		settings->setMaxBounces(8);
+		path_tracer->set_settings(settings);
+		path_tracer->set_scene(reference_scene.create());
+		return path_tracer;
+	}
+
+	// The golden image is rendered once, later runs measure against it
+	void load_golden_image(const ReferenceScene &reference_scene, const ConvergenceOptions &options, std::vector<float> &golden)
+	{
+		const std::string golden_path = (std::filesystem::path(options.golden_directory) / reference_scene.name).string() + ".exr";
+		if (std::filesystem::exists(golden_path))
+		{
+			if (!read_rgb_image(golden_path, CONVERGENCE_RESOLUTION, CONVERGENCE_RESOLUTION, golden))
+				throw std::runtime_error("Failed to read " + golden_path);
+			return;
+		}
+
+		printf("%s: rendering golden image at %u spp\n", reference_scene.name, options.reference_samples);
+		auto reference_tracer = create_reference_tracer(reference_scene);
+		for (uint32_t i = 0; i < options.reference_samples; i++)
+			reference_tracer->render();
+		render::PathTracer::AccumulationSnapshot snapshot;
+		reference_tracer->get_accumulation(snapshot);
+		render::average_accumulation(snapshot, golden);
+		if (!write_rgb_image(golden_path, CONVERGENCE_RESOLUTION, CONVERGENCE_RESOLUTION, golden))
+			throw std::runtime_error("Failed to write " + golden_path);
+	}
+
+	bool write_curve(const std::string &path, const std::vector<ConvergencePoint> &curve)
+	{
+		FILE *file = fopen(path.c_str(), "w");
+		if (!file)
+			return false;
+		for (const ConvergencePoint &point : curve)
+			fprintf(file, "%.6f %u %.9g %.9g\n", point.seconds, point.samples, point.error.rmse, point.error.relative_mse);
+		return fclose(file) == 0;
+	}
+}
+
+int run_worker(const std::string &address, uint32_t thread_count)
+{
+	try
+	{
+		render::ThreadingConfig threading;
+		threading.thread_count = thread_count;
+		return render::run_render_worker(address, create_default_scene(), threading) ? 0 : 1;
+	}
+	catch (const std::exception &e)
+	{
+		printf("Error: worker: %s\n", e.what());
+		return 1;
+	}
+}
+
+int run_coordinator(const char *executable, const CoordinatorOptions &options)
+{
+	std::vector<WorkerProcess> workers(options.spawn_workers ? options.worker_count : 0);
+
+	try
+	{
+		// Listen before spawning so no worker has to wait for the socket
+		auto coordinator = render::RenderCoordinator::create(options.address);
+
+		// Local workers split the cores instead of each starting a thread per core
+		const uint32_t worker_threads = std::max(1u, std::thread::hardware_concurrency() / options.worker_count);
+		for (WorkerProcess &worker : workers)
+		{
+			if (!worker.spawn(executable, options.address, worker_threads))
+				throw std::runtime_error("Failed to start worker process");
+		}
+
+		render::DistributedJob job;
+		job.target_samples = options.samples;
+		job.split_by_region = options.split_regions;
+
+		const auto start = std::chrono::steady_clock::now();
+		coordinator->start(job, options.worker_count);
+		coordinator->wait();
+		const double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Per-worker throughput against the wall clock throughput of the whole farm
+		const double pixels = static_cast<double>(job.width) * job.height;
+		double summed_throughput = 0.0;
+		for (const render::DistributedWorkerStats &stats : coordinator->get_worker_stats())
+		{
+			printf("Worker %u: %u spp in %.2f s, %.2f Msamples/s\n", stats.stream_index, stats.sample_count, stats.render_seconds,
+				   stats.samples_per_second * 1e-6);
+			summed_throughput += stats.samples_per_second;
+		}
+
+		const uint32_t samples = coordinator->get_sample_count();
+		const double farm_throughput = wall_seconds > 0.0 ? samples * pixels / wall_seconds : 0.0;
+		printf("Total: %u spp on %u workers in %.2f s, %.2f Msamples/s (workers sum to %.2f Msamples/s)\n", samples,
+			   options.worker_count, wall_seconds, farm_throughput * 1e-6, summed_throughput * 1e-6);
+
+		if (!options.output.empty() && !write_image(options.output, coordinator->get_render_result()))
+			printf("Error: failed to write %s\n", options.output.c_str());
+	}
+	catch (const std::exception &e)
+	{
+		printf("Error: coordinator: %s\n", e.what());
+		for (WorkerProcess &worker : workers)
+			worker.join();
+		return 1;
+	}
+
+	for (WorkerProcess &worker : workers)
+		worker.join();
+	return 0;
+}
+
+int run_sequence(uint32_t frame_count, uint32_t samples, const std::string &output_pattern)
+{
+	try
+	{
+		auto scene = create_default_scene();
+		auto path_tracer = render::PathTracer::create_path_tracer(render::PathTracer::BackendType::CPU_EMBREE);
+		auto settings = std::make_shared<render::RenderSettings>();
+		settings->setResolution(512, 512);
+		path_tracer->set_settings(settings);
+		path_tracer->set_scene(scene);
+
+		// The unit sphere circles its start position, everything else stays put so every frame is a refit
+		const render::SceneNode *orbiting = nullptr;
+		for (const auto &[id, node] : scene->GetAllNodes())
+		{
+			if (node->GetType() == render::NodeType::SPHERE_OBJECT && static_cast<const render::SphereObject *>(node)->GetRadius() == 1.0f)
+				orbiting = node;
+		}
+		if (!orbiting)
+			throw std::runtime_error("Default scene has no sphere to animate");
+
+		std::vector<render::SequenceFrame> frames(frame_count);
+		const render::Transform start = orbiting->GetLocalTransform();
+		for (uint32_t i = 0; i < frame_count; i++)
+		{
+			const float angle = 6.2831853f * static_cast<float>(i) / static_cast<float>(frame_count);
+			render::Transform transform = start;
+			transform.position += glm::vec3(std::cos(angle) - 1.0f, 0.0f, std::sin(angle));
+			frames[i].transforms.push_back({orbiting->GetID(), transform});
+		}
+
+		render::SequenceOptions options;
+		options.samples_per_frame = samples;
+		options.output_pattern = output_pattern;
+
+		render::SequenceRenderer sequence(*path_tracer);
+		sequence.render(frames, options);
+
+		// Overlapped build time ran next to the previous frame's resolve and output, only the wait delays the render
+		double build_seconds = 0.0, wait_seconds = 0.0, render_seconds = 0.0, output_seconds = 0.0;
+		for (const render::SequenceFrameStats &stats : sequence.get_frame_stats())
+		{
+			printf("Frame %u: %s %.2f ms (%.2f ms overlapped, %.2f ms waited), render %.2f ms, output %.2f ms\n", stats.frame,
+				   stats.refit ? "refit" : "build", stats.build_seconds * 1e3, (stats.build_seconds - stats.build_wait_seconds) * 1e3,
+				   stats.build_wait_seconds * 1e3, stats.render_seconds * 1e3, stats.output_seconds * 1e3);
+			build_seconds += stats.build_seconds;
+			wait_seconds += stats.build_wait_seconds;
+			render_seconds += stats.render_seconds;
+			output_seconds += stats.output_seconds;
+		}
+		printf("Total: build %.2f s (%.2f s overlapped), render %.2f s, output %.2f s over %u frames\n", build_seconds,
+			   build_seconds - wait_seconds, render_seconds, output_seconds, frame_count);
+	}
+	catch (const std::exception &e)
+	{
+		printf("Error: sequence: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
+
+int run_numa_benchmark(uint32_t samples)
+{
+	struct Placement
+	{
+		render::MemoryPlacement placement;
+		const char *name;
+	};
+	const Placement placements[] = {
+		{render::MemoryPlacement::FirstTouch, "first touch"},
+		{render::MemoryPlacement::Interleaved, "interleaved"},
+		{render::MemoryPlacement::SingleThread, "single thread"},
+	};
+
+	try
+	{
+		auto scene = create_default_scene();
+		auto path_tracer = render::PathTracer::create_path_tracer(render::PathTracer::BackendType::CPU_EMBREE);
+		auto settings = std::make_shared<render::RenderSettings>();
+		// Large enough that the accumulation buffer does not fit in the last level cache
+		settings->setResolution(1920, 1080);
+		path_tracer->set_settings(settings);
+		path_tracer->set_scene(scene);
+
+		const double pixel_count = static_cast<double>(settings->getWidth()) * settings->getHeight();
+		for (const Placement &placement : placements)
+		{
+			// The first frame reallocates and places the buffer, it is not timed
+			settings->setMemoryPlacement(placement.placement);
+			path_tracer->render();
+
+			const auto start = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < samples; i++)
+				path_tracer->render();
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			printf("%-14s %8.2f Msamples/s (%u samples in %.2f s)\n", placement.name, pixel_count * samples / seconds * 1e-6, samples,
+				   seconds);
+		}
+	}
+	catch (const std::exception &e)
+	{
+		printf("Error: NUMA benchmark: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
+
+int run_resolve_benchmark(uint32_t samples)
+{
+	struct Layout
+	{
+		render::AccumulationLayout layout;
+		const char *name;
+	};
+	const Layout layouts[] = {
+		{render::AccumulationLayout::RGB32F, "RGB32F"},
+		{render::AccumulationLayout::RGBA32F, "RGBA32F"},
+	};
+	struct Format
+	{
+		render::OutputFormat format;
+		const char *name;
+		size_t bytes_per_pixel;
+	};
+	const Format formats[] = {
+		{render::OutputFormat::RGBA8, "RGBA8", 4},
+		{render::OutputFormat::RGBA16F, "RGBA16F", 8},
+	};
+	constexpr uint32_t RESOLVE_REPEATS = 32;
+
+	try
+	{
+		auto scene = create_default_scene();
+		auto path_tracer = render::PathTracer::create_path_tracer(render::PathTracer::BackendType::CPU_EMBREE);
+		auto settings = std::make_shared<render::RenderSettings>();
+		// Same size as the NUMA benchmark, the buffers do not fit in the last level cache
+		settings->setResolution(1920, 1080);
+		path_tracer->set_settings(settings);
+		path_tracer->set_scene(scene);
+
+		const size_t pixel_count = static_cast<size_t>(settings->getWidth()) * settings->getHeight();
+		for (const Layout &layout : layouts)
+		{
+			// The layout change reallocates the accumulation, the samples only make the image non-trivial
+			settings->setAccumulationLayout(layout.layout);
+			for (uint32_t i = 0; i < samples; i++)
+				path_tracer->render();
+
+			const double accumulation_mb = pixel_count * render::accumulation_channel_count(layout.layout) * sizeof(float) / (1024.0 * 1024.0);
+			for (const Format &format : formats)
+			{
+				// Output format is read at resolve time, the first resolve allocates the output buffer and is not timed
+				settings->setOutputFormat(format.format);
+				path_tracer->get_render_result();
+
+				const auto start = std::chrono::steady_clock::now();
+				for (uint32_t i = 0; i < RESOLVE_REPEATS; i++)
+					path_tracer->get_render_result();
+				const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				printf("%-8s -> %-8s resolve %7.3f ms  accumulation %6.1f MB  output %6.1f MB\n", layout.name, format.name,
+					   seconds / RESOLVE_REPEATS * 1e3, accumulation_mb, pixel_count * format.bytes_per_pixel / (1024.0 * 1024.0));
+			}
+		}
+	}
+	catch (const std::exception &e)
+	{
+		printf("Error: resolve benchmark: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
+
+int run_denoise_benchmark(uint32_t samples)
+{
+	constexpr uint32_t DENOISE_REPEATS = 16;
+
+	try
+	{
+		auto scene = create_default_scene();
+		auto path_tracer = render::PathTracer::create_path_tracer(render::PathTracer::BackendType::CPU_EMBREE);
+		auto settings = std::make_shared<render::RenderSettings>();
+		settings->setResolution(1920, 1080);
+		path_tracer->set_settings(settings);
+		path_tracer->set_scene(scene);
+
+		// Toggling the denoiser restarts the accumulation, the samples give it a noisy image with feature buffers
+		const auto time_resolve = [&](bool denoise) {
+			settings->setDenoise(denoise);
+			for (uint32_t i = 0; i < samples; i++)
+				path_tracer->render();
+			// The first resolve allocates the buffers and is not timed
+			path_tracer->get_render_result();
+
+			const auto start = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < DENOISE_REPEATS; i++)
+				path_tracer->get_render_result();
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / DENOISE_REPEATS;
+		};
+
+		const double resolve_seconds = time_resolve(false);
+		const double denoised_seconds = time_resolve(true);
+		printf("1920x1080 at %u spp: resolve %.3f ms, resolve + denoise %.3f ms, denoise %.3f ms\n", samples, resolve_seconds * 1e3,
+			   denoised_seconds * 1e3, (denoised_seconds - resolve_seconds) * 1e3);
+	}
+	catch (const std::exception &e)
+	{
+		printf("Error: denoise benchmark: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
+
+int run_math_benchmark(uint32_t element_count)
+{
+	// Enough repeats that the fastest one runs with warm caches and a settled clock
+	constexpr uint32_t MATH_BENCHMARK_REPEATS = 16;
+
+	printf("%u elements, fastest of %u runs\n", element_count, MATH_BENCHMARK_REPEATS);
+	printf("%-24s %10s %10s %8s %12s\n", "kernel", "scalar ns", "batch ns", "speedup", "max diff");
+	for (const render::MathKernelTiming &timing : render::benchmark_math_kernels(element_count, MATH_BENCHMARK_REPEATS))
+	{
+		printf("%-24s %10.3f %10.3f %7.2fx %12.3g\n", timing.name, timing.scalar_ns, timing.batch_ns,
+			   timing.scalar_ns / std::max(timing.batch_ns, 1e-9), timing.max_difference);
+	}
+	return 0;
+}
+
+int run_bvh_benchmark(uint32_t sphere_count, uint32_t samples)
+{
+	struct Profile
+	{
+		render::BuildProfile profile;
+		const char *name;
+	};
+	const Profile profiles[] = {
+		{render::BuildProfile::Interactive, "interactive"},
+		{render::BuildProfile::Final, "final"},
+		{render::BuildProfile::Robust, "robust"},
+	};
+
+	try
+	{
+		// Default scene plus a jittered grid of small spheres in front of the camera
+		auto scene = create_default_scene();
+		const render::NodeID moved = add_sphere_field(*scene, sphere_count);
+
+		auto path_tracer = render::PathTracer::create_path_tracer(render::PathTracer::BackendType::CPU_EMBREE);
+		auto settings = std::make_shared<render::RenderSettings>();
+		settings->setResolution(1280, 720);
+		path_tracer->set_settings(settings);
+		path_tracer->set_scene(scene);
+
+		const double pixel_count = static_cast<double>(settings->getWidth()) * settings->getHeight();
+		printf("%u spheres, %u samples per profile\n", sphere_count, samples);
+		for (const Profile &profile : profiles)
+		{
+			// The profile change rebuilds on the next render
+			settings->setBuildProfile(profile.profile);
+			path_tracer->render();
+			const render::PathTracer::SceneUpdateStats build = path_tracer->get_last_scene_update();
+			const render::PathTracer::MemoryStats memory = path_tracer->get_memory_stats();
+
+			const auto start = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < samples; i++)
+				path_tracer->render();
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			// One moved sphere, a refit where the profile allows it
+			const render::SceneNode *node = scene->FindNode(moved);
+			render::Transform transform = node->GetLocalTransform();
+			transform.position.y += 0.01f;
+			scene->SetNodeTransform(moved, transform);
+			path_tracer->render();
+			const render::PathTracer::SceneUpdateStats update = path_tracer->get_last_scene_update();
+
+			printf("%-12s build %8.2f ms  %s %8.2f ms  %7.1f MB  %8.2f Msamples/s\n", profile.name, build.build_seconds * 1e3,
+				   update.refit ? "refit  " : "rebuild", update.build_seconds * 1e3, memory.current_bytes / (1024.0 * 1024.0),
+				   pixel_count * samples / seconds * 1e-6);
+		}
+	}
+	catch (const std::exception &e)
+	{
+		printf("Error: BVH benchmark: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
+
+int run_convergence(const ConvergenceOptions &options)
+{
+	bool regressed = false;
+	try
+	{
+		std::filesystem::create_directories(options.golden_directory);
+
+		for (const ReferenceScene &reference_scene : REFERENCE_SCENES)
+		{
+			const std::string curve_path = (std::filesystem::path(options.golden_directory) / reference_scene.name).string() + ".curve";
+
+			std::vector<float> golden;
+			load_golden_image(reference_scene, options, golden);
+
+			render::PathTracer::AccumulationSnapshot snapshot;
+			std::vector<float> image;
+
+			// Error at fixed render times, only render() is timed
+			auto path_tracer = create_reference_tracer(reference_scene);
+			std::vector<ConvergencePoint> curve;
+			double render_seconds = 0.0;
+			uint32_t samples = 0;
+			while (curve.size() < CONVERGENCE_POINTS)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				path_tracer->render();
+				render_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				samples++;
+
+				const auto target_seconds = [&](size_t point) { return options.seconds / static_cast<double>(1u << (CONVERGENCE_POINTS - 1 - point)); };
+				if (render_seconds < target_seconds(curve.size()))
+					continue;
+
+				path_tracer->get_accumulation(snapshot);
+				render::average_accumulation(snapshot, image);
+				const render::ImageError error = render::compare_images(image.data(), 3, golden.data(), 3, image.size() / 3);
+				// A frame longer than the gap between points covers several of them
+				while (curve.size() < CONVERGENCE_POINTS && render_seconds >= target_seconds(curve.size()))
+					curve.push_back({target_seconds(curve.size()), samples, error});
+			}
+
+			std::vector<ConvergencePoint> baseline;
+			const bool has_baseline = !options.update_baseline && read_curve(curve_path, baseline);
+			for (size_t i = 0; i < curve.size(); i++)
+			{
+				const ConvergencePoint &point = curve[i];
+				printf("%-14s %7.3f s %6u spp  RMSE %.6f  relMSE %.6g", reference_scene.name, point.seconds, point.samples, point.error.rmse,
+					   point.error.relative_mse);
+				if (has_baseline)
+				{
+					const double change = point.error.relative_mse / std::max(baseline[i].error.relative_mse, 1e-12) - 1.0;
+					const bool worse = change > options.tolerance;
+					printf("  baseline %.6g (%+.1f%%)%s", baseline[i].error.relative_mse, change * 100.0, worse ? "  REGRESSED" : "");
+					regressed |= worse;
+				}
+				printf("\n");
+			}
+
+			if (!has_baseline)
+			{
+				if (!write_curve(curve_path, curve))
+					throw std::runtime_error("Failed to write " + curve_path);
+				printf("%s: baseline written to %s\n", reference_scene.name, curve_path.c_str());
+			}
+		}
+	}
+	catch (const std::exception &e)
+	{
+		printf("Error: convergence: %s\n", e.what());
+		return 1;
+	}
+
+	if (regressed)
+		printf("Error at equal render time regressed by more than %.0f%%\n", options.tolerance * 100.0);
+	return regressed ? 1 : 0;
+}
+
+int run_roulette_benchmark(const ConvergenceOptions &options)
+{
+	struct Mode
+	{
+		render::RouletteMode mode;
+		const char *name;
+	};
+	const Mode modes[] = {
+		{render::RouletteMode::Throughput, "throughput"},
+		{render::RouletteMode::Efficiency, "efficiency"},
+	};
+
+	try
+	{
+		std::filesystem::create_directories(options.golden_directory);
+
+		for (const ReferenceScene &reference_scene : REFERENCE_SCENES)
+		{
+			std::vector<float> golden;
+			load_golden_image(reference_scene, options, golden);
+
+			// Efficiency is the inverse of error times render time, the learned factors pay for their own training
+			double baseline_efficiency = 0.0;
+			for (const Mode &mode : modes)
+			{
+				auto path_tracer = create_reference_tracer(reference_scene);
+				path_tracer->get_settings()->setRouletteMode(mode.mode);
+
+				double render_seconds = 0.0;
+				uint32_t samples = 0;
+				while (render_seconds < options.seconds)
+				{
+					const auto start = std::chrono::steady_clock::now();
+					path_tracer->render();
+					render_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					samples++;
+				}
+
+				render::PathTracer::AccumulationSnapshot snapshot;
+				std::vector<float> image;
+				path_tracer->get_accumulation(snapshot);
+				render::average_accumulation(snapshot, image);
+				const render::ImageError error = render::compare_images(image.data(), 3, golden.data(), 3, image.size() / 3);
+
+				const double efficiency = 1.0 / std::max(error.relative_mse * render_seconds, 1e-12);
+				if (baseline_efficiency == 0.0)
+					baseline_efficiency = efficiency;
+				printf("%-14s %-10s %7.3f s %6u spp  relMSE %.6g  relMSE x time %.6g  %.2fx\n", reference_scene.name, mode.name, render_seconds,
+					   samples, error.relative_mse, error.relative_mse * render_seconds, efficiency / baseline_efficiency);
+			}
+		}
+	}
+	catch (const std::exception &e)
+	{
+		printf("Error: roulette benchmark: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
+
+int run_sampler_benchmark(const ConvergenceOptions &options, uint32_t max_samples)
+{
+	struct Sampler
+	{
+		render::SamplerType type;
+		const char *name;
+	};
+	const Sampler samplers[] = {
+		{render::SamplerType::Independent, "independent"},
+		{render::SamplerType::Sobol, "sobol"},
+		{render::SamplerType::BlueNoise, "blue noise"},
+	};
+
+	try
+	{
+		std::filesystem::create_directories(options.golden_directory);
+
+		for (const ReferenceScene &reference_scene : REFERENCE_SCENES)
+		{
+			std::vector<float> golden;
+			load_golden_image(reference_scene, options, golden);
+
+			// Random sampling converges as spp^-0.5, a well stratified sequence approaches spp^-1 on smooth integrands
+			for (const Sampler &sampler : samplers)
+			{
+				auto path_tracer = create_reference_tracer(reference_scene);
+				path_tracer->get_settings()->setSamplerType(sampler.type);
+
+				printf("%-14s %-12s", reference_scene.name, sampler.name);
+				render::PathTracer::AccumulationSnapshot snapshot;
+				std::vector<float> image;
+				double first_rmse = 0.0, last_rmse = 0.0;
+				uint32_t samples = 0;
+				for (uint32_t checkpoint = 1; checkpoint <= max_samples; checkpoint *= 2)
+				{
+					while (samples < checkpoint)
+					{
+						path_tracer->render();
+						samples++;
+					}
+					path_tracer->get_accumulation(snapshot);
+					render::average_accumulation(snapshot, image);
+					last_rmse = render::compare_images(image.data(), 3, golden.data(), 3, image.size() / 3).rmse;
+					if (checkpoint == 1)
+						first_rmse = last_rmse;
+					printf(" %u:%.5f", checkpoint, last_rmse);
+				}
+
+				// Slope of the log-log error curve between the first and the last checkpoint
+				const double slope = samples > 1 && first_rmse > 0.0 && last_rmse > 0.0
+										 ? std::log(last_rmse / first_rmse) / std::log(static_cast<double>(samples))
+										 : 0.0;
+				printf("  rate spp^%.2f\n", slope);
+			}
+		}
+	}
+	catch (const std::exception &e)
+	{
+		printf("Error: sampler benchmark: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
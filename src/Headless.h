@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Command line modes that run without a window
+
+struct CoordinatorOptions
+{
+	std::string address = "tcp://127.0.0.1:47000";
+	uint32_t worker_count = 2;
+	uint32_t samples = 256;		// Samples per pixel over all workers
+	std::string output;			// Written when set, any format OpenImageIO can write
+	bool spawn_workers = true;	// Start the workers as child processes of this executable
+	bool split_regions = false;	// Workers render bands of rows instead of sample streams
+};
+
+struct ConvergenceOptions
+{
+	std::string golden_directory;	 // <scene>.exr references and <scene>.curve baselines, created when missing
+	uint32_t reference_samples = 4096; // Samples per pixel of a new golden image
+	float seconds = 8.0f;			 // Render time per scene, error is measured at 1/16, 1/8, ... of it
+	float tolerance = 0.1f;			 // Allowed relative MSE increase over the baseline at equal time
+	bool update_baseline = false;	 // Replace the stored curves with this run's
+};
+
+// Renders the default scene for a coordinator until it ends the job, returns the process exit code.
+// thread_count 0 uses every CPU
+int run_worker(const std::string &address, uint32_t thread_count = 0);
+
+// Renders the default scene on worker_count workers and reports per-worker throughput
+int run_coordinator(const char *executable, const CoordinatorOptions &options);
+
+// Renders frame_count frames of the default scene with an orbiting sphere and reports build vs. render time
+int run_sequence(uint32_t frame_count, uint32_t samples, const std::string &output_pattern);
+
+// Renders the default scene once per accumulation memory placement and reports samples per second for each
+int run_numa_benchmark(uint32_t samples);
+
+// Resolves the default scene with each accumulation layout and output format and reports resolve time and buffer sizes
+int run_resolve_benchmark(uint32_t samples);
+
+// Resolves the default scene at 1080p with and without the denoiser at its default settings and reports the difference
+int run_denoise_benchmark(uint32_t samples);
+
+// Times every batched SIMD math kernel against its scalar version over element_count elements and reports the speedup
+int run_math_benchmark(uint32_t element_count);
+
+// Builds a field of sphere_count spheres with each BVH build profile and reports build, update and trace times
+int run_bvh_benchmark(uint32_t sphere_count, uint32_t samples);
+
+// Renders every reference scene against its golden image and fails when the error at equal render time regressed
+int run_convergence(const ConvergenceOptions &options);
+
+// Renders every reference scene with each sampler and reports RMSE against its golden image at 1, 2, 4, ... max_samples spp
+int run_sampler_benchmark(const ConvergenceOptions &options, uint32_t max_samples);
+
+// Renders every reference scene for the same time with each roulette mode and reports relative MSE times render time
+int run_roulette_benchmark(const ConvergenceOptions &options);
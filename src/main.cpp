@@ -125,9 +125,131 @@ int main()
 #else
 
 #include "App.h"
+#include "Headless.h"
 
-int main()
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdio.h>
+
+static void PrintUsage(const char *executable)
+{
+	printf("Usage: %s [--worker <address> [--threads N]]\n"
+		   "       %s --coordinator <address> [--workers N] [--samples S] [--output file] [--no-spawn] [--split-regions]\n"
+		   "       %s --sequence <frames> [--samples S] [--output pattern_####.exr]\n"
+		   "       %s --numa-benchmark [--samples S]\n"
+		   "       %s --resolve-benchmark [--samples S]\n"
+		   "       %s --denoise-benchmark [--samples S]\n"
+		   "       %s --math-benchmark [elements]\n"
+		   "       %s --bvh-benchmark <spheres> [--samples S]\n"
+		   "       %s --convergence <golden dir> [--reference-samples S] [--seconds T] [--tolerance F] [--update-baseline]\n"
+		   "       %s --roulette-benchmark <golden dir> [--reference-samples S] [--seconds T]\n"
+		   "       %s --sampler-benchmark <golden dir> [--reference-samples S] [--samples S]\n"
+		   "Addresses are tcp://host:port or unix:///path\n",
+		   executable, executable, executable, executable, executable, executable, executable, executable, executable, executable,
+		   executable);
+}
+
+int main(int argc, char **argv)
 {
+	const char *worker_address = nullptr;
+	uint32_t worker_threads = 0;
+	bool coordinator = false;
+	uint32_t sequence_frames = 0;
+	bool numa_benchmark = false;
+	bool resolve_benchmark = false;
+	bool denoise_benchmark = false;
+	uint32_t math_benchmark_elements = 0;
+	uint32_t bvh_benchmark_spheres = 0;
+	bool roulette_benchmark = false;
+	bool sampler_benchmark = false;
+	CoordinatorOptions options;
+	ConvergenceOptions convergence;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "--worker") == 0 && has_value)
+			worker_address = argv[++i];
+		else if (strcmp(argv[i], "--threads") == 0 && has_value)
+			worker_threads = (uint32_t)std::max(atoi(argv[++i]), 0);
+		else if (strcmp(argv[i], "--coordinator") == 0 && has_value)
+		{
+			coordinator = true;
+			options.address = argv[++i];
+		}
+		else if (strcmp(argv[i], "--sequence") == 0 && has_value)
+			sequence_frames = (uint32_t)std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "--numa-benchmark") == 0)
+			numa_benchmark = true;
+		else if (strcmp(argv[i], "--resolve-benchmark") == 0)
+			resolve_benchmark = true;
+		else if (strcmp(argv[i], "--denoise-benchmark") == 0)
+			denoise_benchmark = true;
+		else if (strcmp(argv[i], "--math-benchmark") == 0)
+			math_benchmark_elements = has_value && argv[i + 1][0] != '-' ? (uint32_t)std::max(atoi(argv[++i]), 1) : 1u << 20;
+		else if (strcmp(argv[i], "--bvh-benchmark") == 0 && has_value)
+			bvh_benchmark_spheres = (uint32_t)std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "--convergence") == 0 && has_value)
+			convergence.golden_directory = argv[++i];
+		else if (strcmp(argv[i], "--roulette-benchmark") == 0 && has_value)
+		{
+			roulette_benchmark = true;
+			convergence.golden_directory = argv[++i];
+		}
+		else if (strcmp(argv[i], "--sampler-benchmark") == 0 && has_value)
+		{
+			sampler_benchmark = true;
+			convergence.golden_directory = argv[++i];
+		}
+		else if (strcmp(argv[i], "--reference-samples") == 0 && has_value)
+			convergence.reference_samples = (uint32_t)std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "--seconds") == 0 && has_value)
+			convergence.seconds = std::max((float)atof(argv[++i]), 0.1f);
+		else if (strcmp(argv[i], "--tolerance") == 0 && has_value)
+			convergence.tolerance = std::max((float)atof(argv[++i]), 0.0f);
+		else if (strcmp(argv[i], "--update-baseline") == 0)
+			convergence.update_baseline = true;
+		else if (strcmp(argv[i], "--workers") == 0 && has_value)
+			options.worker_count = (uint32_t)std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "--samples") == 0 && has_value)
+			options.samples = (uint32_t)std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "--output") == 0 && has_value)
+			options.output = argv[++i];
+		else if (strcmp(argv[i], "--no-spawn") == 0)
+			options.spawn_workers = false;
+		else if (strcmp(argv[i], "--split-regions") == 0)
+			options.split_regions = true;
+		else
+		{
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (worker_address)
+		return run_worker(worker_address, worker_threads);
+	if (coordinator)
+		return run_coordinator(argv[0], options);
+	if (sequence_frames > 0)
+		return run_sequence(sequence_frames, options.samples, options.output);
+	if (numa_benchmark)
+		return run_numa_benchmark(options.samples);
+	if (resolve_benchmark)
+		return run_resolve_benchmark(options.samples);
+	if (denoise_benchmark)
+		return run_denoise_benchmark(options.samples);
+	if (math_benchmark_elements > 0)
+		return run_math_benchmark(math_benchmark_elements);
+	if (bvh_benchmark_spheres > 0)
+		return run_bvh_benchmark(bvh_benchmark_spheres, options.samples);
+	if (roulette_benchmark)
+		return run_roulette_benchmark(convergence);
+	if (sampler_benchmark)
+		return run_sampler_benchmark(convergence, options.samples);
+	if (!convergence.golden_directory.empty())
+		return run_convergence(convergence);
+
 	App app;
 	app.run();
 	return 0;